@@ -0,0 +1,67 @@
+//============================================================================
+// Name        : arena_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/arena_bench.out
+// Description : Heap bytes per key, insert time and clone (copy constructor)
+// time of AvlTree<string> with DirectKeys versus ArenaKeys.
+// Usage: bench/arena_bench.out [words] [extra letters per word]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+#include <malloc.h>
+#include <sstream>
+
+size_t heap_in_use(){
+  return mallinfo2().uordblks;
+}
+
+template <typename Tree>
+string run(const char* name, const vector<string>& words){
+  size_t before = heap_in_use();
+  Stopwatch clock;
+  Tree *t = new Tree;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t->insert(words[i]);
+  double insert_secs = clock.seconds();
+  size_t bytes = heap_in_use() - before;
+
+  clock.reset();
+  Tree *copy = new Tree(*t);
+  double clone_secs = clock.seconds();
+  size_t clone_bytes = heap_in_use() - before - bytes;
+
+  cout << left << setw(12) << name
+       << " bytes/key = " << setw(8) << (double)bytes / words.size()
+       << " insert ns/key = " << setw(8) << insert_secs * 1e9 / words.size()
+       << " clone ms = " << setw(8) << clone_secs * 1e3
+       << " clone bytes/key = " << (double)clone_bytes / words.size() << endl;
+
+  ostringstream out;
+  delete t;
+  copy->display(out);
+  delete copy;
+  return out.str();
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  int extra = argc > 2 ? atoi(argv[2]) : 12;
+  vector<string> words = make_words(n);
+  double letters = 0;
+  for(unsigned int i = 0; i < words.size(); i++){
+    words[i] += string(extra, 'x');
+    letters += words[i].size();
+  }
+  cout << n << " words, average length " << letters / n << endl;
+  string direct = run<AvlTree<string> >("DirectKeys", words);
+  string arena = run<AvlTree<string, AvlBalance, ArenaKeys> >("ArenaKeys", words);
+  if(direct != arena){
+    cout << "ERROR: trees differ" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+//=============================================================
+// Name:  BENCHUTIL.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by the programs in bench/
+// Version: 1.0
+// Description: Small helpers shared by the benchmarks: a repeatable word
+// generator, a Zipf sampler and a wall clock timer.
+//
+//============================================================
+
+#ifndef BENCH_UTIL_H_INCLUDED
+#define BENCH_UTIL_H_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Returns n distinct lowercase words of 3 to 12 letters, in random order.
+ */
+inline vector<string> make_words(int n, unsigned seed = 335){
+  mt19937 rng(seed);
+  uniform_int_distribution<int> len(3, 12);
+  uniform_int_distribution<int> letter('a', 'z');
+  vector<string> words;
+  words.reserve(n);
+  for(int i = 0; i < n; i++){
+    string w;
+    int l = len(rng);
+    for(int j = 0; j < l; j++)
+      w += (char)letter(rng);
+    // the index suffix keeps the words distinct
+    w += to_string(i);
+    words.push_back(w);
+  }
+  shuffle(words.begin(), words.end(), rng);
+  return words;
+}
+
+/**
+ * Draws ranks in [0, n) with P(rank k) proportional to 1 / (k + 1)^s.
+ */
+class ZipfSampler
+{
+ public:
+ ZipfSampler(int n, double s, unsigned seed = 42):rng(seed),cdf(n)
+    {
+      double sum = 0;
+      for(int k = 0; k < n; k++){
+	sum += 1.0 / pow(k + 1.0, s);
+	cdf[k] = sum;
+      }
+      for(int k = 0; k < n; k++)
+	cdf[k] /= sum;
+    }
+
+  int next(){
+    double u = uniform(rng);
+    return lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+  }
+
+ private:
+  mt19937 rng;
+  uniform_real_distribution<double> uniform;
+  vector<double> cdf;
+};
+
+/**
+ * Wall clock stopwatch; seconds() is the time since construction or reset().
+ */
+class Stopwatch
+{
+ public:
+ Stopwatch( ):start(chrono::steady_clock::now()){}
+
+  void reset(){
+    start = chrono::steady_clock::now();
+  }
+
+  double seconds() const{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+
+ private:
+  chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,99 @@
+//============================================================================
+// Name        : bf_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/bf_bench.out
+// Description : AvlTree (a 4 byte height in every node) against BfAvlTree
+// (a one byte balance factor): node size, heap bytes per key as malloc
+// counts them (mallinfo2), inserts per second into an empty tree, a churn
+// of removes and reinserts, finds, and the cost of height(), which
+// BfAvlTree computes by walking down the taller side. Both trees are
+// checked afterwards and must end up the same shape.
+// Usage: bench/bf_bench.out [words]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "../bfavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+#include <malloc.h>
+
+struct Result
+{
+  int node;
+  double heap_per_key, inserts, churn, finds, height_ns;
+  long long path_length;
+  bool ok;
+};
+
+template <typename Tree>
+Result run(Tree & t, int node, const vector<string> & words){
+  Result r;
+  r.node = node;
+  long long heap = mallinfo2().uordblks;
+  Stopwatch clock;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.insert(words[i]);
+  r.inserts = words.size() / clock.seconds();
+  r.heap_per_key = (double)(mallinfo2().uordblks - heap) / words.size();
+
+  clock.reset();
+  for(unsigned int i = 0; i < words.size(); i += 2)
+    t.remove(words[i]);
+  for(unsigned int i = 0; i < words.size(); i += 4)
+    t.insert(words[i]);
+  r.churn = (words.size() / 2 + words.size() / 4) / clock.seconds();
+
+  clock.reset();
+  int freq = 0;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.find(words[i], freq);
+  r.finds = words.size() / clock.seconds();
+
+  const int calls = 100000;
+  long long heights = 0;
+  clock.reset();
+  Tree * volatile tree = &t;    // read anew each time, so height() is not hoisted
+  for(int i = 0; i < calls; i++)
+    heights += tree->height();
+  asm volatile("" : : "r"(heights) : "memory");    // nor moved past the clock
+  r.height_ns = clock.seconds() * 1e9 / calls;
+
+  r.path_length = t.int_path_length();
+  r.ok = t.check(cerr);
+  t.make_empty();
+  return r;
+}
+
+void print(const char *name, const Result & r){
+  cout << "  " << left << setw(10) << name << right << fixed << setprecision(0)
+       << setw(6) << r.node << setw(13) << setprecision(1) << r.heap_per_key
+       << setw(12) << setprecision(0) << r.inserts << setw(12) << r.churn << setw(12) << r.finds
+       << setw(12) << setprecision(1) << r.height_ns << (r.ok ? "" : "  BROKEN") << endl;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  vector<string> words = make_words(n);
+  cout << n << " random words; churn removes every other word, then reinserts half of those" << endl;
+  cout << "  tree        node  heap B/key   inserts/s     churn/s     finds/s  height() ns" << endl;
+  Result avl, bf;
+  {
+    AvlTree<string> t;
+    t.insert(words[0]);
+    int node = t.memory_usage().node_bytes;
+    t.make_empty();
+    avl = run(t, node, words);
+  }
+  {
+    BfAvlTree<string> t;
+    bf = run(t, BfAvlTree<string>::node_bytes(), words);
+  }
+  print("AvlTree", avl);
+  print("BfAvlTree", bf);
+  bool same = avl.path_length == bf.path_length;
+  cout << "internal path lengths " << avl.path_length << " and " << bf.path_length
+       << (same ? ": same shape" : ": SHAPES DIFFER") << endl;
+  return avl.ok && bf.ok && same ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+//============================================================================
+// Name        : bplus_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/bplus_bench.out
+// Description : Nodes visited and ns per find for AvlTree<string>, BTree and
+// BPlusTree with 1, 2 and 4 cache lines of prefixes per node, with the AVX2
+// prefix search on and off, plus the time to display the whole tree.
+// Usage: bench/bplus_bench.out [words] [finds]
+//============================================================================
+
+#include "../eavlengine.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+template <typename Tree>
+void run(const char* name, const vector<string>& words, const vector<string>& probes){
+  Tree t;
+  Stopwatch clock;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.insert(words[i]);
+  double insert_secs = clock.seconds();
+  int freq;
+  long found = 0;
+  clock.reset();
+  for(unsigned int i = 0; i < probes.size(); i++){
+    freq = 0;
+    t.find(probes[i], freq);
+    found += freq;
+  }
+  double find_secs = clock.seconds();
+  ostringstream out;
+  clock.reset();
+  t.display(out);
+  double display_secs = clock.seconds();
+  cout << left << setw(22) << name << right << fixed
+       << " height = " << setw(2) << t.height()
+       << "  avg nodes visited = " << setprecision(2) << setw(5) << t.avge_node_visits()
+       << "  ns/find = " << setprecision(0) << setw(4) << find_secs * 1e9 / probes.size()
+       << "  ns/insert = " << setw(4) << insert_secs * 1e9 / words.size()
+       << "  display ms = " << setw(4) << display_secs * 1e3
+       << (found == (long)probes.size() ? "" : "  ERROR: missed keys") << endl;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  int finds = argc > 2 ? atoi(argv[2]) : 2000000;
+  vector<string> words = make_words(n);
+  vector<string> probes;
+  mt19937 rng(3);
+  for(int i = 0; i < finds; i++)
+    probes.push_back(words[rng() % n]);
+  cout << n << " keys, " << finds << " random finds" << endl;
+
+  run<AvlTree<string> >("AvlTree", words, probes);
+  run<BTree<string> >("BTree (256 B keys)", words, probes);
+  bool avx2 = BPlusTree<string>::simd_enabled();
+  for(int simd = avx2 ? 1 : 0; simd >= 0; simd--){
+    BPlusTree<string>::set_simd(simd);
+    cout << (simd ? "AVX2 prefix search" : "scalar prefix search") << endl;
+    run<BPlusTree<string, 1> >("  BPlusTree 1 line", words, probes);
+    run<BPlusTree<string, 2> >("  BPlusTree 2 lines", words, probes);
+    run<BPlusTree<string, 4> >("  BPlusTree 4 lines", words, probes);
+  }
+  return 0;
+}
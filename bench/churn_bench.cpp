@@ -0,0 +1,55 @@
+//============================================================================
+// Name        : churn_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/churn_bench.out
+// Description : Insert/remove churn (with some finds) on AvlTree<string> with
+// eager deletion versus lazy deletion at several tombstone fractions.
+// Usage: bench/churn_bench.out [live keys] [churn operations]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+
+void run(double fraction, const vector<string>& words, int live, int ops){
+  AvlTree<string> t;
+  t.set_lazy_delete(fraction);
+  for(int i = 0; i < live; i++)
+    t.insert(words[i]);
+  mt19937 rng(11);
+  int freq;
+  int compactions = 0;
+  Stopwatch clock;
+  // Each round removes a random live key and inserts a random key from the
+  // whole vocabulary, so the live set keeps its size but moves around.
+  for(int i = 0; i < ops; i++){
+    const string & out = words[rng() % words.size()];
+    const string & in = words[rng() % words.size()];
+    int before = t.tombstone_count();
+    t.remove(out);
+    if(t.tombstone_count() < before)
+      compactions++;
+    t.insert(in);
+    t.find(words[rng() % words.size()], freq);
+  }
+  double secs = clock.seconds();
+  cout << (fraction > 0 ? "lazy " : "eager") << " " << setw(5) << fraction
+       << "  ops/s = " << setw(9) << (long)(3 * ops / secs)
+       << "  size = " << t.size() << "  tombstones = " << setw(7) << t.tombstone_count()
+       << "  compactions = " << setw(4) << compactions
+       << "  height = " << t.height()
+       << "  avg visits = " << t.avge_node_visits() << endl;
+}
+
+int main(int argc, char* argv[]){
+  int live = argc > 1 ? atoi(argv[1]) : 200000;
+  int ops = argc > 2 ? atoi(argv[2]) : 1000000;
+  vector<string> words = make_words(2 * live);
+  cout << live << " keys of " << 2 * live << ", " << ops << " remove+insert+find rounds" << endl;
+  double fractions[] = { 0, 0.05, 0.1, 0.25, 0.5 };
+  for(int i = 0; i < 5; i++)
+    run(fractions[i], words, live, ops);
+  return 0;
+}
@@ -0,0 +1,108 @@
+//============================================================================
+// Name        : concurrent_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/concurrent_bench.out
+// Description : Scalability of ConcurrentAvlTree against AvlTree behind one
+// mutex, on 1 to 64 threads. Each tree starts with half of the keys; every
+// thread then runs its share of the operations with keys drawn uniformly
+// from all of them, for a read-mostly mix (9% insert, 1% remove, 90% find)
+// and an update-heavy one (20% insert, 10% remove, 70% find), as in
+// Bronson et al. Prints operations per second for each thread count.
+// Usage: bench/concurrent_bench.out [keys] [operations] [max threads]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "../cavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+/**
+ * AvlTree made safe for threads the simple way: every operation (find
+ * included, since it updates statistics) holds one lock.
+ */
+class LockedAvlTree
+{
+ public:
+  int insert(const string & x){
+    lock_guard<mutex> hold(lock);
+    return tree.insert(x);
+  }
+
+  int remove(const string & x){
+    lock_guard<mutex> hold(lock);
+    return tree.remove(x);
+  }
+
+  int find(const string & x, int & freq){
+    lock_guard<mutex> hold(lock);
+    return tree.find(x, freq);
+  }
+
+ private:
+  mutex lock;
+  AvlTree<string> tree;
+};
+
+/**
+ * Runs ops operations split over threads threads on t and returns the
+ * operations per second. inserts and removes are percentages.
+ */
+template <typename Tree>
+double run(Tree & t, const vector<string> & words, long ops, int threads, int inserts, int removes){
+  vector<thread> workers;
+  long share = ops / threads;
+  Stopwatch clock;
+  for(int w = 0; w < threads; w++)
+    workers.push_back(thread([&, w](){
+	  mt19937 rng(77 + w);
+	  for(long i = 0; i < share; i++){
+	    const string & k = words[rng() % words.size()];
+	    int op = rng() % 100;
+	    if(op < inserts)
+	      t.insert(k);
+	    else if(op < inserts + removes)
+	      t.remove(k);
+	    else{
+	      int freq = 0;
+	      t.find(k, freq);
+	    }
+	  }
+	}));
+  for(int w = 0; w < threads; w++)
+    workers[w].join();
+  return share * threads / clock.seconds();
+}
+
+template <typename Tree>
+double measure(const vector<string> & words, long ops, int threads, int inserts, int removes){
+  Tree t;
+  for(unsigned int i = 0; i < words.size(); i += 2)
+    t.insert(words[i]);
+  return run(t, words, ops, threads, inserts, removes);
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 200000;
+  long ops = argc > 2 ? atol(argv[2]) : 2000000;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 64;
+  vector<string> words = make_words(n);
+  int mixes[][2] = { { 9, 1 }, { 20, 10 } };
+  cout << n << " keys, " << ops << " operations per run, "
+       << thread::hardware_concurrency() << " hardware threads" << endl;
+  for(int m = 0; m < 2; m++){
+    cout << mixes[m][0] << "% insert, " << mixes[m][1] << "% remove, "
+	 << 100 - mixes[m][0] - mixes[m][1] << "% find (ops/s)" << endl;
+    cout << "  threads   mutex AvlTree   ConcurrentAvlTree" << endl;
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+      double locked = measure<LockedAvlTree>(words, ops, threads, mixes[m][0], mixes[m][1]);
+      double concurrent = measure<ConcurrentAvlTree<string> >(words, ops, threads, mixes[m][0], mixes[m][1]);
+      cout << "  " << setw(7) << threads << "   " << setw(13) << (long)locked
+	   << "   " << setw(17) << (long)concurrent << endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+//============================================================================
+// Name        : concurrent_stress.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/concurrent_stress.out
+// Description : Stress test for ConcurrentAvlTree. Threads insert, remove
+// and find random keys from a small shared range, so they collide on the
+// same nodes and rotations constantly. Each thread counts its successful
+// inserts and removes per key; after every round the tree must hold, for
+// each key, the total inserts minus removes, and pass check() (order,
+// parent links, heights, strict balance once quiescent). Later rounds
+// remove more than they insert so routing nodes get unlinked, and the
+// unlinked nodes still waiting to be freed must stay within a few reclaim
+// batches however many were unlinked. Exits non-zero on the first mismatch.
+// Usage: bench/concurrent_stress.out [threads] [ops per thread] [keys]
+//============================================================================
+
+#include "../cavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+int main(int argc, char* argv[]){
+  int threads = argc > 1 ? atoi(argv[1]) : 8;
+  int ops = argc > 2 ? atoi(argv[2]) : 200000;
+  int n = argc > 3 ? atoi(argv[3]) : 2000;
+  vector<string> words = make_words(n);
+  ConcurrentAvlTree<string> tree;
+  vector<long long> expected(n, 0);
+  // percent of operations that insert, then remove; the rest find
+  int mix[][2] = { { 60, 20 }, { 40, 40 }, { 20, 60 }, { 5, 90 } };
+  int failures = 0;
+  for(int round = 0; round < 4; round++){
+    vector<vector<long long> > net(threads, vector<long long>(n, 0));
+    vector<thread> workers;
+    Stopwatch clock;
+    for(int w = 0; w < threads; w++)
+      workers.push_back(thread([&, w](){
+	    mt19937 rng(1000 * round + w);
+	    for(int i = 0; i < ops; i++){
+	      int k = rng() % n;
+	      int op = rng() % 100;
+	      if(op < mix[round][0]){
+		if(tree.insert(words[k]) < 1)
+		  failures++;
+		net[w][k]++;
+	      }else if(op < mix[round][0] + mix[round][1]){
+		if(tree.remove(words[k]) >= 0)
+		  net[w][k]--;
+	      }else{
+		int freq = 0;
+		tree.find(words[k], freq);
+		if(freq < 0)
+		  failures++;
+	      }
+	    }
+	  }));
+    for(int w = 0; w < threads; w++)
+      workers[w].join();
+    double secs = clock.seconds();
+
+    int present = 0, wrong = 0;
+    for(int k = 0; k < n; k++){
+      for(int w = 0; w < threads; w++)
+	expected[k] += net[w][k];
+      int freq = 0;
+      tree.find(words[k], freq);
+      if(freq != expected[k])
+	wrong++;
+      if(expected[k] > 0)
+	present++;
+    }
+    bool shaped = tree.check(cerr);
+    bool bounded = tree.unreclaimed() <= 4 * ConcurrentAvlTree<string>::RECLAIM_BATCH;
+    cout << "round " << round << ": " << threads << " threads x " << ops << " ops ("
+	 << mix[round][0] << "% insert, " << mix[round][1] << "% remove) in " << secs << " s, size "
+	 << tree.size() << ", height " << tree.height() << ", wrong frequencies " << wrong
+	 << ", unreclaimed " << tree.unreclaimed() << (shaped ? "" : ", BAD SHAPE")
+	 << (bounded ? "" : ", UNBOUNDED") << endl;
+    if(wrong > 0 || !shaped || !bounded || tree.size() != present)
+      failures++;
+  }
+  tree.make_empty();
+  cout << (failures == 0 ? "concurrent tree consistent" : "concurrent tree INCONSISTENT") << endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+//============================================================================
+// Name        : copy_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/copy_bench.out
+// Description : Counts key copies and moves made by AvlTree on its hot paths
+// (insert of an rvalue, emplace, duplicate insert, find, remove) using a
+// heavy key type that counts its own copy and move constructions/assignments.
+// Exits non-zero if any hot path copied a key.
+// Usage: bench/copy_bench.out [keys]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+
+/**
+ * String key padded to a heavy payload, counting copies and moves.
+ */
+struct CountedKey
+{
+  static long copies;
+  static long moves;
+  string text;
+  char payload[256];
+
+  explicit CountedKey(const string & s):text(s){}
+ CountedKey(const CountedKey & rhs):text(rhs.text){ copies++; }
+ CountedKey(CountedKey && rhs):text(std::move(rhs.text)){ moves++; }
+  CountedKey & operator=(const CountedKey & rhs){ text = rhs.text; copies++; return *this; }
+  CountedKey & operator=(CountedKey && rhs){ text = std::move(rhs.text); moves++; return *this; }
+};
+
+long CountedKey::copies = 0;
+long CountedKey::moves = 0;
+
+bool operator==(const CountedKey & a, const CountedKey & b){ return a.text == b.text; }
+bool operator<(const CountedKey & a, const CountedKey & b){ return a.text < b.text; }
+bool operator>(const CountedKey & a, const CountedKey & b){ return a.text > b.text; }
+
+namespace std {
+  template <>
+  struct hash<CountedKey>
+  {
+    size_t operator()(const CountedKey & k) const{
+      return hash<string>()(k.text);
+    }
+  };
+}
+
+bool hot_paths_clean = true;
+
+/**
+ * Prints copies/moves made since the last call and checks the copy budget.
+ */
+void phase(const char *name, int ops, long allowed_copies){
+  static long last_copies = 0, last_moves = 0;
+  long c = CountedKey::copies - last_copies;
+  long m = CountedKey::moves - last_moves;
+  last_copies = CountedKey::copies;
+  last_moves = CountedKey::moves;
+  cout << left << setw(28) << name << " ops = " << setw(8) << ops
+       << " copies = " << setw(8) << c << " moves = " << m << endl;
+  if(c > allowed_copies)
+    hot_paths_clean = false;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 200000;
+  vector<string> words = make_words(n);
+  AvlTree<CountedKey> t;
+  int freq;
+
+  vector<CountedKey> keys;
+  keys.reserve(n);
+  for(int i = 0; i < n / 2; i++)
+    keys.push_back(CountedKey(words[i]));
+  phase("(setup)", 0, n);
+
+  for(int i = 0; i < n / 2; i++)
+    t.insert(std::move(keys[i]));
+  phase("insert(Comparable&&)", n / 2, 0);
+
+  for(int i = n / 2; i < n; i++)
+    t.emplace(words[i]);
+  phase("emplace(string)", n - n / 2, 0);
+
+  for(int i = 0; i < n; i++)
+    t.emplace(words[i]);
+  phase("emplace duplicate", n, 0);
+
+  for(int i = 0; i < n; i++){
+    CountedKey probe(words[i]);
+    t.find(probe, freq);
+  }
+  phase("find", n, 0);
+
+  for(int i = 0; i < n; i++){
+    CountedKey probe(words[i]);
+    t.remove(probe);
+    t.remove(probe);
+  }
+  phase("remove (incl. two children)", 2 * n, 0);
+
+  for(int i = 0; i < n / 4; i++){
+    CountedKey k(words[i]);
+    t.insert(k);
+  }
+  phase("insert(const Comparable&)", n / 4, n / 4);
+
+  cout << (hot_paths_clean ? "no key copies on hot paths" : "ERROR: hot path copied keys") << endl;
+  return hot_paths_clean ? 0 : 1;
+}
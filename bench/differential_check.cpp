@@ -0,0 +1,346 @@
+//============================================================================
+// Name        : differential_check.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/differential_check.out (make check runs it)
+// Description : Differential test of AvlTree against std::map<string, int>.
+// Each configuration (plain, lazy deletion, relaxed balance, finger search,
+// hot-key cache, task pool, arena keys, frequency balance with and without
+// finger search, 64 bit frequencies) runs the same seeded stream of inserts, removes and finds,
+// which must return exactly what the map predicts. After every batch the
+// tree must pass check() (order, heights, balance, size, tombstones, memory
+// accounting), display the map's keys, report the map's size and the find
+// average seen here, and its internal path length and height must equal
+// the depths lookup() finds for the map's keys. An export runs alongside:
+// after every operation export_next() must go on in increasing key order,
+// with the map's frequencies. The phases of the stream alternately grow
+// and shrink the tree. On the first mismatch the
+// operations so far are written to differential_failure.txt as a driver
+// command file, so ./eavl.out replays the failure deterministically. The
+// finger configurations then insert every key in sorted order, finding the
+// last few after each insert, and the lazy one removes keys from both ends
+// checking find_min and find_max.
+// Exits non-zero on failure.
+// Usage: bench/differential_check.out [operations per configuration] [keys] [seed]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+const char *FAILURE_FILE = "differential_failure.txt";
+// Operations between invariant checks
+const int BATCH = 10000;
+// percent of operations that insert, then remove, per phase; the rest find
+const int MIX[][2] = { { 50, 20 }, { 40, 30 }, { 20, 55 }, { 45, 25 } };
+
+struct Op
+{
+  char cmd;    // 'i'nsert, 'r'emove, 'f'ind or 's'ettle
+  int key;
+};
+
+/**
+ * Writes ops as driver commands to FAILURE_FILE and says how to replay it.
+ * flags are the driver options matching the configuration, or NULL when
+ * the driver has none (it always runs AvlTree<string>).
+ */
+void write_replay(const vector<Op> & ops, const vector<string> & words, const char *flags){
+  ofstream out(FAILURE_FILE);
+  for(unsigned int i = 0; i < ops.size(); i++){
+    if(ops[i].cmd == 's'){
+      out << "settle" << endl;
+      continue;
+    }
+    out << (ops[i].cmd == 'i' ? "insert " : ops[i].cmd == 'r' ? "remove " : "find ") << words[ops[i].key] << endl;
+  }
+  out << "check" << endl << "report" << endl << "quit" << endl;
+  cerr << ops.size() << " operations written to " << FAILURE_FILE << "; replay with ./eavl.out ";
+  if(flags != NULL)
+    cerr << flags << (*flags != '\0' ? " " : "") << FAILURE_FILE << endl;
+  else
+    cerr << FAILURE_FILE << " (the driver's AvlTree<string> differs from this configuration)" << endl;
+}
+
+/**
+ * Returns report()'s line starting with attribute, or "" if there is none.
+ */
+string report_line(const string & report, const string & attribute){
+  string::size_type at = report.find(attribute + " = ");
+  if(at == string::npos)
+    return "";
+  return report.substr(at, report.find('\n', at) - at);
+}
+
+string key_string(const string & key){
+  return key;
+}
+
+string key_string(const ArenaString & key){
+  return string(key.view());
+}
+
+template <typename Value>
+string expect_line(const string & attribute, Value v){
+  ostringstream line;
+  line << attribute << " = " << v;
+  return line.str();
+}
+
+/**
+ * Checks t against ref after a batch. Returns "" or what is wrong.
+ */
+template <typename Tree>
+string check_batch(Tree & t, const map<string, int> & ref, unsigned long long finds, unsigned long long visits, bool cached){
+  ostringstream problem;
+  if(!t.check(problem))
+    return problem.str().substr(0, problem.str().find('\n'));
+  if(t.size() != (int)ref.size())
+    return expect_line("size", t.size()) + ", map holds " + to_string(ref.size());
+
+  ostringstream shown, expected;
+  t.display(shown);
+  for(map<string, int>::const_iterator it = ref.begin(); it != ref.end(); ++it)
+    expected << it->first << endl;
+  if(shown.str() != expected.str())
+    return "display differs from the map";
+  if(!ref.empty() && key_string(t.find_min()) != ref.begin()->first)
+    return "find_min gives " + key_string(t.find_min()) + ", map starts at " + ref.begin()->first;
+  if(!ref.empty() && key_string(t.find_max()) != ref.rbegin()->first)
+    return "find_max gives " + key_string(t.find_max()) + ", map ends at " + ref.rbegin()->first;
+
+  // Every live key's depth is what lookup() visits to find it.
+  long long depths = 0;
+  int deepest = 0;
+  for(map<string, int>::const_iterator it = ref.begin(); it != ref.end(); ++it){
+    typename Tree::freq_type freq = -7;
+    int depth = t.lookup(it->first, freq);
+    if(freq != it->second)
+      return "lookup " + it->first + " gives " + to_string((long long)freq) + ", map has " + to_string(it->second);
+    depths += depth;
+    deepest = max(deepest, depth);
+  }
+  if(t.tombstone_count() == 0){
+    if(t.int_path_length() != depths)
+      return expect_line("internal path length", t.int_path_length()) + ", depths add to " + to_string(depths);
+    if(t.height() != deepest)
+      return expect_line("height", t.height()) + ", deepest key at " + to_string(deepest);
+  }
+
+  ostringstream report;
+  streambuf *out = cout.rdbuf(report.rdbuf());
+  t.report();
+  cout.rdbuf(out);
+  vector<string> want;
+  want.push_back(expect_line("size", ref.size()));
+  want.push_back(expect_line("height", t.height()));
+  want.push_back(expect_line("internal path length", t.int_path_length()));
+  if(!cached)    // cache hits are not averaged in
+    want.push_back(expect_line("average number of nodes visited", (finds > 0 && visits > 0) ? (float)((double)visits / finds) : 0));
+  for(unsigned int i = 0; i < want.size(); i++){
+    string got = report_line(report.str(), want[i].substr(0, want[i].find(" = ")));
+    if(got != want[i])
+      return "report prints \"" + got + "\", expected \"" + want[i] + "\"";
+  }
+  return "";
+}
+
+/**
+ * Runs ops seeded operations on t (set up as configuration name) and the
+ * map, checking after every batch. The relaxed configuration settles every
+ * fourth batch. Returns true if t agreed throughout.
+ */
+template <typename Tree>
+bool differential(const string & name, const char *flags, Tree & t, const vector<string> & words, long ops, unsigned seed,
+		  bool cached = false, bool settles = false){
+  typedef typename Tree::freq_type Freq;
+  mt19937 rng(seed);
+  map<string, int> ref;
+  vector<Op> log;
+  unsigned long long finds = 0, visits = 0;
+  int n = words.size();
+  int hot = max(1, n / 100);
+  string problem;
+  string exported;    // the last key the export passed
+  Stopwatch clock;
+  for(long i = 0; i < ops && problem.empty(); i++){
+    const int *mix = MIX[(i / BATCH) % 4];
+    // a third of the operations go to the hottest 1% of the keys
+    int k = rng() % 3 == 0 ? rng() % hot : rng() % n;
+    int op = rng() % 100;
+    const string & key = words[k];
+    if(op < mix[0]){
+      log.push_back(Op{ 'i', k });
+      Freq got = t.insert(key);
+      if(got != ++ref[key])
+	problem = "insert " + key + " returns " + to_string((long long)got) + ", expected " + to_string(ref[key]);
+    }else if(op < mix[0] + mix[1]){
+      log.push_back(Op{ 'r', k });
+      Freq got = t.remove(key);
+      map<string, int>::iterator it = ref.find(key);
+      long long expected = it == ref.end() ? -1 : --it->second;
+      if(it != ref.end() && it->second == 0)
+	ref.erase(it);
+      if(got != expected)
+	problem = "remove " + key + " returns " + to_string((long long)got) + ", expected " + to_string(expected);
+    }else{
+      log.push_back(Op{ 'f', k });
+      Freq freq = -7;
+      int visited = t.find(key, freq);
+      map<string, int>::iterator it = ref.find(key);
+      long long expected = it == ref.end() ? -7 : it->second;
+      finds++;
+      visits += visited;
+      if(freq != expected)
+	problem = "find " + key + " gives frequency " + to_string((long long)freq) + ", expected " + to_string(expected);
+      else if(visited < 0 || visited > n)
+	problem = "find " + key + " visits " + to_string(visited) + " nodes";
+    }
+    if(problem.empty()){
+      if(!t.exporting()){
+	t.export_begin();
+	exported.clear();
+      }
+      t.export_next(2, [&](const typename Tree::key_type & k, Freq freq){
+	  string key = key_string(k);
+	  map<string, int>::iterator it = ref.find(key);
+	  if(!exported.empty() && !(exported < key))
+	    problem = "export gives " + key + " after " + exported;
+	  else if(it == ref.end() || it->second != freq)
+	    problem = "export gives " + key + " with frequency " + to_string((long long)freq);
+	  exported = key;
+	});
+    }
+    if(problem.empty() && (i + 1) % BATCH == 0){
+      if(settles && (i + 1) % (4 * BATCH) == 0){
+	log.push_back(Op{ 's', 0 });
+	t.settle();
+      }
+      problem = check_batch(t, ref, finds, visits, cached);
+    }
+  }
+  if(problem.empty())
+    problem = check_batch(t, ref, finds, visits, cached);
+  if(!problem.empty()){
+    cerr << name << ": FAILED after " << log.size() << " operations (seed " << seed << "): " << problem << endl;
+    write_replay(log, words, flags);
+    return false;
+  }
+  cout << name << ": " << ops << " operations agree with std::map in " << clock.seconds()
+       << " s, size " << t.size() << ", height " << t.height() << endl;
+  return true;
+}
+
+/**
+ * Inserts words in sorted order, finding the last few keys after each
+ * insert, so the tree rotates under a finger that keeps pointing near the
+ * newest key. Every find must see frequency 1. Returns true if it did.
+ */
+template <typename Tree>
+bool sorted_stream(const string & name, Tree & t, vector<string> words){
+  sort(words.begin(), words.end());
+  words.erase(unique(words.begin(), words.end()), words.end());
+  for(unsigned int i = 0; i < words.size(); i++){
+    t.insert(words[i]);
+    for(unsigned int j = i - min(i, 20u); j <= i; j += 5){
+      typename Tree::freq_type freq = -7;
+      t.find(words[j], freq);
+      if(freq != 1){
+	cerr << name << ": FAILED on sorted inserts: find " << words[j] << " after insert " << words[i]
+	     << " gives frequency " << (long long)freq << ", expected 1" << endl;
+	return false;
+      }
+    }
+  }
+  cout << name << ": " << words.size() << " sorted inserts found again" << endl;
+  return true;
+}
+
+/**
+ * Inserts every word once, then removes the smallest and the largest key
+ * in turn until t is empty. find_min and find_max must always give the
+ * smallest and largest key still present, whatever tombstones the removes
+ * leave. Returns true if they did.
+ */
+template <typename Tree>
+bool drain_ends(const string & name, Tree & t, vector<string> words){
+  sort(words.begin(), words.end());
+  words.erase(unique(words.begin(), words.end()), words.end());
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.insert(words[i]);
+  for(unsigned int lo = 0, hi = words.size(); lo < hi; ){
+    if(key_string(t.find_min()) != words[lo] || key_string(t.find_max()) != words[hi - 1]){
+      cerr << name << ": FAILED draining the ends: find_min gives " << key_string(t.find_min()) << ", find_max "
+	   << key_string(t.find_max()) << ", expected " << words[lo] << " and " << words[hi - 1] << endl;
+      return false;
+    }
+    t.remove((lo + hi) % 2 ? words[lo++] : words[--hi]);
+  }
+  cout << name << ": find_min and find_max followed " << words.size() << " removes from the ends" << endl;
+  return true;
+}
+
+int main(int argc, char* argv[]){
+  long ops = argc > 1 ? atol(argv[1]) : 1000000;
+  int n = argc > 2 ? atoi(argv[2]) : 20000;
+  unsigned seed = argc > 3 ? strtoul(argv[3], NULL, 10) : 2014;
+  vector<string> words = make_words(n, seed);
+  bool ok = true;
+  {
+    AvlTree<string> t;
+    ok = differential("plain", "", t, words, ops, seed) && ok;
+  }
+  {
+    AvlTree<string> t;
+    t.set_lazy_delete(0.25);
+    ok = differential("lazy", "--lazy", t, words, ops, seed) && ok;
+    t.make_empty();
+    ok = drain_ends("lazy", t, words) && ok;
+  }
+  {
+    AvlTree<string> t;
+    t.set_relaxed(2);
+    ok = differential("relaxed", "--relaxed", t, words, ops, seed, false, true) && ok;
+  }
+  {
+    AvlTree<string> t;
+    t.set_finger(true);
+    ok = differential("finger", "--finger", t, words, ops, seed) && ok;
+    t.make_empty();
+    ok = sorted_stream("finger", t, words) && ok;
+  }
+  {
+    AvlTree<string> t;
+    t.set_cache_size(1024);
+    ok = differential("cache", "--cache", t, words, ops, seed, true) && ok;
+  }
+  {
+    TaskPool pool(4);
+    AvlTree<string> t;
+    t.set_task_pool(&pool);
+    ok = differential("task pool", "--threads=4", t, words, ops, seed) && ok;
+  }
+  {
+    AvlTree<string, AvlBalance, ArenaKeys> t;
+    ok = differential("arena keys", NULL, t, words, ops, seed) && ok;
+  }
+  {
+    AvlTree<string, FrequencyBalance> t;
+    ok = differential("frequency balance", NULL, t, words, ops, seed) && ok;
+  }
+  {
+    AvlTree<string, FrequencyBalance> t;
+    t.set_finger(true);
+    ok = differential("frequency balance + finger", NULL, t, words, ops, seed) && ok;
+    t.make_empty();
+    ok = sorted_stream("frequency balance + finger", t, words) && ok;
+  }
+  {
+    AvlTree<string, AvlBalance, DirectKeys<string>, long long> t;
+    ok = differential("long long frequencies", NULL, t, words, ops, seed) && ok;
+  }
+  cout << (ok ? "all configurations agree" : "MISMATCH") << endl;
+  return ok ? 0 : 1;
+}
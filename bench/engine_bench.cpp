@@ -0,0 +1,124 @@
+//============================================================================
+// Name        : engine_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/engine_bench.out
+// Description : Replays the same commands on every tree engine (avl, rb,
+// wavl, bf, btree, bplus) and compares time, shape and rebalancing work.
+// Commands come from driver command files given on the command line, or from three
+// generated workloads (insert heavy, insert/remove churn, find heavy).
+// Built with the EAVL_STATS counters so rotations can be compared.
+// Usage: bench/engine_bench.out [command files...]
+//============================================================================
+
+#define EAVL_STATS
+#include "../eavlengine.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+struct Command
+{
+  char op;       // i(nsert), r(emove), f(ind) or d(isplay)
+  string key;
+};
+
+struct Workload
+{
+  string name;
+  vector<Command> commands;
+};
+
+// Reads a driver command file; lines eavl_driver would reject are skipped.
+Workload read_commands(const string & path){
+  Workload w;
+  w.name = path;
+  ifstream in(path.c_str());
+  string line, cmd, key;
+  while(getline(in, line)){
+    stringstream ss(line);
+    if(!(ss >> cmd))
+      continue;
+    if(cmd == "display")
+      w.commands.push_back(Command{'d', ""});
+    else if((cmd == "insert" || cmd == "remove" || cmd == "find") && ss >> key)
+      w.commands.push_back(Command{cmd[0], key});
+  }
+  return w;
+}
+
+vector<Workload> generate(int n){
+  vector<string> words = make_words(n);
+  mt19937 rng(5);
+  vector<Workload> loads(3);
+  loads[0].name = "insert heavy";
+  for(int i = 0; i < 2 * n; i++)
+    loads[0].commands.push_back(Command{'i', words[rng() % n]});
+  loads[1].name = "churn";
+  for(int i = 0; i < n / 2; i++)
+    loads[1].commands.push_back(Command{'i', words[i]});
+  for(int i = 0; i < 2 * n; i++)
+    loads[1].commands.push_back(Command{i % 2 ? 'r' : 'i', words[rng() % n]});
+  loads[2].name = "find heavy";
+  for(int i = 0; i < n; i++)
+    loads[2].commands.push_back(Command{'i', words[i]});
+  for(int i = 0; i < 4 * n; i++)
+    loads[2].commands.push_back(Command{rng() % 10 ? 'f' : 'i', words[rng() % n]});
+  return loads;
+}
+
+// Runs w on e; returns what a final display prints.
+string replay(TreeEngine<string> & e, const Workload & w, double & secs){
+  ostringstream shown;
+  int freq;
+  Stopwatch clock;
+  for(unsigned int i = 0; i < w.commands.size(); i++){
+    const Command & c = w.commands[i];
+    if(c.op == 'i')
+      e.insert(c.key);
+    else if(c.op == 'r')
+      e.remove(c.key);
+    else if(c.op == 'f')
+      e.find(c.key, freq);
+    else
+      e.display(shown);
+  }
+  secs = clock.seconds();
+  e.display(shown);
+  return shown.str();
+}
+
+int main(int argc, char* argv[]){
+  vector<Workload> loads;
+  for(int i = 1; i < argc; i++)
+    loads.push_back(read_commands(argv[i]));
+  if(loads.empty())
+    loads = generate(500000);
+  const char *names[] = { "avl", "rb", "wavl", "bf", "btree", "bplus" };
+  bool same = true;
+  for(unsigned int l = 0; l < loads.size(); l++){
+    cout << loads[l].name << ": " << loads[l].commands.size() << " commands" << endl;
+    string expected;
+    for(int k = 0; k < 6; k++){
+      TreeEngine<string> *e = make_engine<string>(names[k]);
+      double secs;
+      string shown = replay(*e, loads[l], secs);
+      const AvlStats & s = e->stats();
+      cout << "  " << left << setw(6) << names[k] << right << fixed << setprecision(1)
+	   << " ms = " << setw(7) << secs * 1e3
+	   << "  size = " << setw(7) << e->size()
+	   << "  height = " << setw(2) << e->height()
+	   << "  avg visits = " << setprecision(2) << setw(5) << e->avge_node_visits()
+	   << "  rotations = " << setw(8) << s.rotations()
+	   << "  height/rank/color/split changes = " << setw(8) << s.height_changes << endl;
+      if(k == 0)
+	expected = shown;
+      else if(shown != expected)
+	same = false;
+      delete e;
+    }
+  }
+  cout << (same ? "all engines hold the same keys" : "ERROR: engines disagree") << endl;
+  return same ? 0 : 1;
+}
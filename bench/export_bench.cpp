@@ -0,0 +1,59 @@
+//============================================================================
+// Name        : export_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/export_bench.out
+// Description : How long a full dump of AvlTree<string> holds up other
+// commands. display() writes every key in one call; export_next() writes
+// them a chunk at a time, with a find and an insert run between chunks as
+// the driver's --export mode does. Prints the total time of the dump and
+// the longest wait a command between chunks sees (one chunk), for several
+// chunk sizes. Keys go to /dev/null.
+// Usage: bench/export_bench.out [keys]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 2000000;
+  vector<string> words = make_words(n);
+  AvlTree<string> t;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.insert(words[i]);
+  ofstream out("/dev/null");
+  cout << n << " keys" << endl;
+
+  Stopwatch clock;
+  t.display(out);
+  double whole = clock.seconds();
+  cout << "  display           total = " << fixed << setprecision(3) << setw(7) << whole
+       << " s  longest wait = " << setw(9) << whole * 1e3 << " ms" << endl;
+
+  int chunks[] = { 100, 1000, 10000, 100000 };
+  for(int c = 0; c < 4; c++){
+    t.export_begin();
+    double longest = 0;
+    long long exported = 0;
+    int commands = 0;
+    Stopwatch total;
+    while(t.exporting()){
+      Stopwatch chunk;
+      exported += t.export_next(chunks[c], [&](const string & key, int){ out << key << '\n'; });
+      longest = max(longest, chunk.seconds());
+      // the commands the chunk held up; each insert is removed again
+      int freq = 0;
+      const string & w = words[commands++ % words.size()];
+      t.find(w, freq);
+      t.insert(w + "~");
+      t.remove(w + "~");
+    }
+    cout << "  export_next(" << setw(6) << chunks[c] << ") total = " << setw(7) << total.seconds()
+	 << " s  longest wait = " << setw(9) << longest * 1e3 << " ms  (" << exported << " keys, "
+	 << commands << " commands between chunks)" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+//============================================================================
+// Name        : finger_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/finger_bench.out
+// Description : Root search against finger search (AvlTree::set_finger) on
+// key streams of different sortedness: sorted, sorted with every key moved
+// up to 16 places, eight sorted runs interleaved, and random. Each stream is
+// inserted and then found again in the same order; reports nodes visited
+// per find and ns per insert and per find.
+// Usage: bench/finger_bench.out [words]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+
+void run(const char* name, const vector<string>& keys){
+  cout << name << endl;
+  for(int finger = 0; finger <= 1; finger++){
+    AvlTree<string> t;
+    t.set_finger(finger);
+    Stopwatch clock;
+    for(unsigned int i = 0; i < keys.size(); i++)
+      t.insert(keys[i]);
+    double insert_secs = clock.seconds();
+    int freq;
+    long found = 0;
+    clock.reset();
+    for(unsigned int i = 0; i < keys.size(); i++){
+      freq = 0;
+      t.find(keys[i], freq);
+      found += freq;
+    }
+    double find_secs = clock.seconds();
+    cout << "  " << left << setw(7) << (finger ? "finger" : "root") << right << fixed
+	 << " avg nodes visited = " << setprecision(2) << setw(5) << t.avge_node_visits()
+	 << "  ns/insert = " << setprecision(0) << setw(4) << insert_secs * 1e9 / keys.size()
+	 << "  ns/find = " << setw(4) << find_secs * 1e9 / keys.size()
+	 << (found == (long)keys.size() ? "" : "  ERROR: missed keys") << endl;
+  }
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 2000000;
+  vector<string> words = make_words(n);
+  sort(words.begin(), words.end());
+  cout << n << " keys" << endl;
+  run("sorted", words);
+
+  vector<string> nearly = words;
+  mt19937 rng(7);
+  for(int i = 0; i + 16 <= n; i += 16)
+    shuffle(nearly.begin() + i, nearly.begin() + i + 16, rng);
+  run("sorted within 16 places", nearly);
+
+  vector<string> runs;
+  runs.reserve(n);
+  for(int i = 0; i < n / 8; i++)
+    for(int r = 0; r < 8; r++)
+      runs.push_back(words[r * (n / 8) + i]);
+  run("8 interleaved sorted runs", runs);
+
+  shuffle(words.begin(), words.end(), rng);
+  run("random", words);
+  return 0;
+}
@@ -0,0 +1,86 @@
+//============================================================================
+// Name        : map_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/map_bench.out
+// Description : Keeping per-key data next to the frequency: AvlTree<string>
+// plus a side unordered_map (two lookups per occurrence) against
+// AvlMap<string, Posting> (one), with std::map for reference. The workload
+// counts every occurrence of a Zipf-distributed word stream and records the
+// position it was last seen at.
+// Usage: bench/map_bench.out [words] [occurrences]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "../eavlmap.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <unordered_map>
+
+struct Posting
+{
+  int count;
+  int last;
+Posting( ):count(0),last(-1){}
+};
+
+void print(const char* name, double secs, int n, long check){
+  cout << left << setw(28) << name << right << fixed << setprecision(0)
+       << " ns/occurrence = " << setw(4) << secs * 1e9 / n
+       << "  checksum = " << check << endl;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 200000;
+  int occurrences = argc > 2 ? atoi(argv[2]) : 3000000;
+  vector<string> words = make_words(n);
+  ZipfSampler zipf(n, 1.0);
+  vector<int> stream(occurrences);
+  for(int i = 0; i < occurrences; i++)
+    stream[i] = zipf.next();
+  cout << n << " words, " << occurrences << " Zipf occurrences" << endl;
+
+  {
+    AvlTree<string> t;
+    unordered_map<string, int> last;
+    Stopwatch clock;
+    for(int i = 0; i < occurrences; i++){
+      t.insert(words[stream[i]]);
+      last[words[stream[i]]] = i;
+    }
+    double secs = clock.seconds();
+    long check = 0;
+    t.in_order([&](const string & w, int freq){ check += freq + last[w]; });
+    print("AvlTree + unordered_map", secs, occurrences, check);
+  }
+  {
+    AvlMap<string, Posting> m;
+    Stopwatch clock;
+    for(int i = 0; i < occurrences; i++){
+      Posting & p = m[words[stream[i]]];
+      p.count++;
+      p.last = i;
+    }
+    double secs = clock.seconds();
+    long check = 0;
+    m.in_order([&](const string &, const Posting & p){ check += p.count + p.last; });
+    print("AvlMap<string, Posting>", secs, occurrences, check);
+  }
+  {
+    map<string, Posting> m;
+    Stopwatch clock;
+    for(int i = 0; i < occurrences; i++){
+      Posting & p = m[words[stream[i]]];
+      p.count++;
+      p.last = i;
+    }
+    double secs = clock.seconds();
+    long check = 0;
+    for(map<string, Posting>::const_iterator it = m.begin(); it != m.end(); ++it)
+      check += it->second.count + it->second.last;
+    print("std::map<string, Posting>", secs, occurrences, check);
+  }
+  return 0;
+}
@@ -0,0 +1,84 @@
+//============================================================================
+// Name        : memory_check.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/memory_check.out
+// Description : Checks AvlTree's memory accounting (memory_usage()) against
+// what malloc reports (mallinfo2: bytes in use) and against the resident
+// set size, as a tree of words is built, half emptied, copied and emptied
+// (the resident set only grows once malloc has pages to reuse).
+// Exits non-zero if the accounting is off by more than 1% (plus 64 KiB)
+// of what malloc saw.
+// Usage: bench/memory_check.out [words]
+//============================================================================
+
+#include "benchutil.h"
+#include "../eavltree.cpp"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <unistd.h>
+
+long long heap_in_use(){
+  return mallinfo2().uordblks;
+}
+
+long long resident_bytes(){
+  long long pages = 0, resident = 0;
+  ifstream statm("/proc/self/statm");
+  statm >> pages >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+int failures = 0;
+
+/**
+ * Compares what the tree accounts for with the change in malloc's bytes
+ * in use since heap_before (plus the resident set when rss_before >= 0).
+ */
+void check(const string & step, unsigned long long accounted, long long heap_before, long long rss_before = -1){
+  long long seen = heap_in_use() - heap_before;
+  long long off = (long long)accounted - seen;
+  bool ok = llabs(off) <= llabs(seen) / 100 + 64 * 1024;
+  cout << left << setw(28) << step << " accounted " << setw(11) << accounted << " mallinfo2 " << setw(11) << seen;
+  if(rss_before >= 0)
+    cout << " rss " << setw(11) << resident_bytes() - rss_before;
+  cout << (ok ? "" : "  MISMATCH") << endl;
+  if(!ok)
+    failures++;
+}
+
+template <typename Tree>
+void run(const string & name, const vector<string> & words){
+  cout << name << ":" << endl;
+  long long heap = heap_in_use(), rss = resident_bytes();
+  Tree *t = new Tree;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t->insert(words[i]);
+  check("  insert all", t->memory_bytes(), heap, rss);
+  for(unsigned int i = 0; i < words.size(); i += 2)
+    t->remove(words[i]);
+  check("  remove every other", t->memory_bytes(), heap);
+  long long before_copy = heap_in_use();
+  Tree *copy = new Tree(*t);
+  // a copy shares the key arena (ArenaKeys), so only its nodes are new
+  check("  copy", copy->memory_usage().total(), before_copy);
+  copy->make_empty();
+  delete copy;
+  cout << "  per node: " << (double)t->memory_bytes() / t->memory_usage().nodes << " bytes" << endl;
+  t->report_memory(cout);
+  t->make_empty();
+  check("  make_empty", t->memory_bytes(), heap);
+  delete t;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  vector<string> words = make_words(n);
+  run<AvlTree<string> >("AvlTree<string>", words);
+  run<AvlTree<string, AvlBalance, ArenaKeys> >("AvlTree<string, AvlBalance, ArenaKeys>", words);
+  cout << (failures == 0 ? "memory accounting matches malloc" : "memory accounting MISMATCH") << endl;
+  return failures == 0 ? 0 : 1;
+}
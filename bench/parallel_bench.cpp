@@ -0,0 +1,76 @@
+//============================================================================
+// Name        : parallel_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/parallel_bench.out
+// Description : Times clone, print_tree, int_path_length and make_empty of a
+// large AvlTree<string> sequentially and on TaskPools of 1 to 32 threads,
+// checking that the parallel results match the sequential ones.
+// Usage: bench/parallel_bench.out [words] [max threads]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+struct Times
+{
+  double clone, print, path, empty;
+};
+
+Times run(AvlTree<string> & t, TaskPool *pool, string & printed, long long & path){
+  Times r;
+  t.set_task_pool(pool);
+  Stopwatch clock;
+  AvlTree<string> *copy = new AvlTree<string>(t);
+  r.clone = clock.seconds();
+  ostringstream out;
+  clock.reset();
+  copy->print_tree(out);
+  r.print = clock.seconds();
+  clock.reset();
+  path = copy->int_path_length();
+  r.path = clock.seconds();
+  clock.reset();
+  copy->make_empty();
+  r.empty = clock.seconds();
+  delete copy;
+  printed = out.str();
+  t.set_task_pool(NULL);
+  return r;
+}
+
+void show(const string & name, const Times & r, const Times & base){
+  cout << setw(12) << name << fixed << setprecision(1)
+       << "  clone " << setw(7) << r.clone * 1e3 << " ms (x" << setprecision(2) << base.clone / r.clone << ")"
+       << setprecision(1) << "  print " << setw(7) << r.print * 1e3 << " ms (x" << setprecision(2) << base.print / r.print << ")"
+       << setprecision(1) << "  path " << setw(6) << r.path * 1e3 << " ms (x" << setprecision(2) << base.path / r.path << ")"
+       << setprecision(1) << "  empty " << setw(7) << r.empty * 1e3 << " ms (x" << setprecision(2) << base.empty / r.empty << ")"
+       << endl;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 2000000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : 32;
+  vector<string> words = make_words(n);
+  AvlTree<string> t;
+  for(int i = 0; i < n; i++)
+    t.insert(words[i]);
+  cout << n << " keys, " << thread::hardware_concurrency() << " hardware threads" << endl;
+
+  string expected, printed;
+  long long expected_path, path;
+  Times base = run(t, NULL, expected, expected_path);
+  show("sequential", base, base);
+  bool ok = true;
+  for(int threads = 1; threads <= max_threads; threads *= 2){
+    TaskPool pool(threads);
+    Times r = run(t, &pool, printed, path);
+    show(to_string(threads) + " threads", r, base);
+    ok = ok && printed == expected && path == expected_path;
+  }
+  cout << (ok ? "parallel output matches" : "ERROR: parallel output differs") << endl;
+  return ok ? 0 : 1;
+}
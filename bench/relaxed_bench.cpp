@@ -0,0 +1,51 @@
+//============================================================================
+// Name        : relaxed_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/relaxed_bench.out
+// Description : Write bursts on AvlTree<string> with strict AVL balance
+// versus relaxed balance (set_relaxed) at several allowed imbalances: the
+// burst's inserts and removes, in random and in sorted order, then the cost
+// of settling the deferred paths, with the tree's height after each.
+// Usage: bench/relaxed_bench.out [keys]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+
+void run(int imbalance, const string & order, const vector<string>& words){
+  AvlTree<string> t;
+  t.set_relaxed(imbalance);
+  Stopwatch clock;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.insert(words[i]);
+  for(unsigned int i = 0; i < words.size(); i += 3)
+    t.remove(words[i]);
+  double burst = clock.seconds();
+  int height = t.height();
+  int queued = t.unsettled_count();
+  Stopwatch settling;
+  int rotations = t.settle();
+  double settle = settling.seconds();
+  cout << setw(7) << order << "  imbalance " << imbalance
+       << "  burst ops/s = " << setw(9) << (long)((words.size() + words.size() / 3) / burst)
+       << "  height = " << setw(2) << height
+       << "  queued = " << setw(6) << queued
+       << "  settle = " << fixed << setprecision(3) << settle << " s (" << rotations << " rotations)"
+       << "  height = " << t.height() << endl;
+  t.make_empty();
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  vector<string> words = make_words(n);
+  cout << n << " inserts, then every third key removed" << endl;
+  for(int k = 1; k <= 3; k++)
+    run(k, "random", words);
+  sort(words.begin(), words.end());
+  for(int k = 1; k <= 3; k++)
+    run(k, "sorted", words);
+  return 0;
+}
@@ -0,0 +1,193 @@
+//============================================================================
+// Name        : serve_client.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/serve_client.out
+// Description : Load generator for the driver's server mode
+// (eavl.out --serve=PATH). Opens clients connections; each first inserts
+// its share of words, then runs requests commands, 9 finds to 1 insert
+// over all the words, keeping up to depth of them in flight. Prints the
+// requests per second of the mixed phase and the tail of the request
+// latency (time from queueing a command to reading its response).
+// Usage: bench/serve_client.out PATH [requests] [clients] [depth] [--binary]
+//============================================================================
+
+#include "benchutil.h"
+#include "../eavlcodec.h"
+#include "../eavlstats.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef chrono::steady_clock::time_point Stamp;
+
+struct Connection
+{
+  int fd;
+  long issued;         // commands queued so far this phase
+  long answered;
+  string out;          // queued, not yet sent
+  string in;           // partial response
+  deque<Stamp> sent;   // queue time of each command in flight
+};
+
+int connect_unix(const string & path){
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0){
+    cerr << "ERROR: cannot connect to " << path << ": " << strerror(errno) << endl;
+    exit(1);
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+void queue_command(Connection & c, bool binary, char op, const string & key){
+  if(binary)
+    encode_command(c.out, op, key);
+  else {
+    c.out += op == 'i' ? "insert " : "find ";
+    c.out += key;
+    c.out += '\n';
+  }
+  c.sent.push_back(chrono::steady_clock::now());
+  c.issued++;
+}
+
+/**
+ * Runs one phase: command(i, c) names the i-th command of connection c;
+ * each connection runs quota of them with up to depth in flight.
+ */
+template <typename Command>
+void run_phase(vector<Connection> & conns, bool binary, long quota, int depth,
+	       LatencyHistogram & latency, Command command){
+  int clients = conns.size();
+  for(int i = 0; i < clients; i++)
+    conns[i].issued = conns[i].answered = 0;
+  vector<pollfd> fds(clients);
+  char buf[64 * 1024];
+  int open = clients;
+  while(open > 0){
+    for(int i = 0; i < clients; i++){
+      Connection & c = conns[i];
+      while(c.issued < quota && c.issued - c.answered < depth){
+	char op;
+	string key;
+	command(c.issued, i, op, key);
+	queue_command(c, binary, op, key);
+      }
+      fds[i].fd = c.answered < quota ? c.fd : -1;
+      fds[i].events = POLLIN | (c.out.empty() ? 0 : POLLOUT);
+      fds[i].revents = 0;
+    }
+    poll(&fds[0], clients, -1);
+    for(int i = 0; i < clients; i++){
+      Connection & c = conns[i];
+      if((fds[i].revents & POLLOUT) && !c.out.empty()){
+	ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+	if(n > 0)
+	  c.out.erase(0, n);
+      }
+      if(!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+	continue;
+      ssize_t n = read(c.fd, buf, sizeof(buf));
+      if(n <= 0){
+	if(n == 0 || (errno != EAGAIN && errno != EINTR)){
+	  cerr << "ERROR: server closed client " << i << endl;
+	  exit(1);
+	}
+	continue;
+      }
+      c.in.append(buf, n);
+      size_t used = 0;
+      Stamp now = chrono::steady_clock::now();
+      for(;;){
+	size_t end;
+	if(binary)
+	  end = c.in.size() - used >= (size_t)RESULT_BYTES ? used + RESULT_BYTES : string::npos;
+	else {
+	  end = c.in.find('\n', used);
+	  if(end != string::npos)
+	    end++;
+	}
+	if(end == string::npos)
+	  break;
+	used = end;
+	latency.record(chrono::duration_cast<chrono::nanoseconds>(now - c.sent.front()).count());
+	c.sent.pop_front();
+	if(++c.answered == quota)
+	  open--;
+      }
+      c.in.erase(0, used);
+    }
+  }
+}
+
+void print_latency(const string & phase, long requests, double secs, const LatencyHistogram & h){
+  cout << phase << ": " << requests << " requests in " << fixed << setprecision(3) << secs << " s = "
+       << setprecision(0) << requests / secs << " requests/s; latency (us) p50 " << setprecision(1)
+       << h.percentile(50) / 1000.0 << ", p99 " << h.percentile(99) / 1000.0 << ", p99.9 "
+       << h.percentile(99.9) / 1000.0 << ", max " << h.max() / 1000.0 << endl;
+}
+
+int main(int argc, char* argv[]){
+  vector<string> args;
+  bool binary = false;
+  for(int i = 1; i < argc; i++){
+    if(string(argv[i]) == "--binary")
+      binary = true;
+    else
+      args.push_back(argv[i]);
+  }
+  if(args.empty()){
+    cerr << "usage: " << argv[0] << " PATH [requests] [clients] [depth] [--binary]" << endl;
+    return 1;
+  }
+  long requests = args.size() > 1 ? atol(args[1].c_str()) : 1000000;
+  int clients = args.size() > 2 ? atoi(args[2].c_str()) : 4;
+  int depth = args.size() > 3 ? atoi(args[3].c_str()) : 32;
+  int n = requests / 10 > 0 ? requests / 10 : 1;
+  vector<string> words = make_words(n);
+
+  vector<Connection> conns(clients);
+  for(int i = 0; i < clients; i++){
+    conns[i].fd = connect_unix(args[0]);
+    if(binary)
+      conns[i].out += (char)BINARY_HELLO;
+  }
+  long share = (n + clients - 1) / clients;
+  LatencyHistogram load;
+  Stopwatch clock;
+  run_phase(conns, binary, share, depth, load, [&](long i, int c, char & op, string & key){
+      op = 'i';
+      key = words[(c * share + i) % n];
+    });
+  print_latency("insert", share * clients, clock.seconds(), load);
+
+  long quota = requests / clients;
+  vector<mt19937> rngs;
+  for(int i = 0; i < clients; i++)
+    rngs.push_back(mt19937(11 + i));
+  LatencyHistogram mixed;
+  Stopwatch mixed_clock;
+  run_phase(conns, binary, quota, depth, mixed, [&](long, int c, char & op, string & key){
+      op = rngs[c]() % 10 ? 'f' : 'i';
+      key = words[rngs[c]() % n];
+    });
+  cout << clients << " client(s), depth " << depth << (binary ? ", binary" : ", text") << endl;
+  print_latency("90% find", quota * clients, mixed_clock.seconds(), mixed);
+  for(int i = 0; i < clients; i++)
+    close(conns[i].fd);
+  return 0;
+}
@@ -0,0 +1,58 @@
+//============================================================================
+// Name        : snapshot_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/snapshot_bench.out
+// Description : Cost of taking a consistent copy of the tree: AvlTree's deep
+// copy versus PersistentAvlTree::snapshot(), plus insert throughput of both
+// and a reader thread displaying a snapshot while the writer keeps inserting.
+// Usage: bench/snapshot_bench.out [words]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "../pavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  vector<string> words = make_words(n + n / 5);
+
+  AvlTree<string> avl;
+  PersistentAvlTree<string> pavl;
+  Stopwatch clock;
+  for(int i = 0; i < n; i++)
+    avl.insert(words[i]);
+  cout << "AvlTree            insert ns/op = " << clock.seconds() * 1e9 / n << endl;
+  clock.reset();
+  for(int i = 0; i < n; i++)
+    pavl.insert(words[i]);
+  cout << "PersistentAvlTree  insert ns/op = " << clock.seconds() * 1e9 / n << endl;
+
+  clock.reset();
+  AvlTree<string> copy(avl);
+  cout << "AvlTree            deep copy ms = " << clock.seconds() * 1e3 << endl;
+  clock.reset();
+  PersistentAvlTree<string> snap = pavl.snapshot();
+  cout << "PersistentAvlTree  snapshot ms = " << clock.seconds() * 1e3 << endl;
+
+  // Display the snapshot on another thread while this one keeps writing.
+  ostringstream shown;
+  thread reader([&](){ snap.display(shown); });
+  clock.reset();
+  for(int i = n; i < n + n / 5; i++)
+    pavl.insert(words[i]);
+  for(int i = 0; i < n / 5; i++)
+    pavl.remove(words[i]);
+  double write_secs = clock.seconds();
+  reader.join();
+
+  string s = shown.str();
+  long lines = count(s.begin(), s.end(), '\n');
+  cout << "writes during display: " << 2 * (n / 5) << " in " << write_secs * 1e3 << " ms" << endl;
+  cout << "snapshot displayed " << lines << " keys (snapshot size " << snap.size()
+       << ", live tree size " << pavl.size() << ")" << endl;
+  return lines == snap.size() ? 0 : 1;
+}
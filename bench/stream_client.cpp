@@ -0,0 +1,128 @@
+//============================================================================
+// Name        : stream_client.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/stream_client.out
+// Description : Load generator for the driver's socket mode
+// (eavl.out --socket=PATH). Opens clients connections, pipelines the
+// commands of a command file, or a generated insert/find mix over words,
+// on each of them, closes the sending side and reads the responses to the
+// end. Prints commands per second and response lines per client.
+// Usage: bench/stream_client.out PATH [command file | commands] [clients]
+//============================================================================
+
+#include "benchutil.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct Connection
+{
+  int fd;
+  size_t sent;
+  bool done;
+  long lines;
+};
+
+int connect_unix(const string & path){
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0){
+    cerr << "ERROR: cannot connect to " << path << ": " << strerror(errno) << endl;
+    exit(1);
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+// 9 finds for every insert, over n words, after inserting all of them
+string generate(int commands){
+  int n = commands / 10 > 0 ? commands / 10 : 1;
+  vector<string> words = make_words(n);
+  mt19937 rng(11);
+  string text;
+  for(int i = 0; i < commands; i++){
+    text += i < n ? "insert " : (rng() % 10 ? "find " : "insert ");
+    text += words[i < n ? i : rng() % n];
+    text += '\n';
+  }
+  return text;
+}
+
+int main(int argc, char* argv[]){
+  if(argc < 2){
+    cerr << "usage: " << argv[0] << " PATH [command file | commands] [clients]" << endl;
+    return 1;
+  }
+  string what = argc > 2 ? argv[2] : "1000000";
+  int clients = argc > 3 ? atoi(argv[3]) : 1;
+  string text;
+  ifstream file(what.c_str());
+  if(file.is_open()){
+    ostringstream all;
+    all << file.rdbuf();
+    text = all.str();
+  } else
+    text = generate(atoi(what.c_str()));
+  long commands = count(text.begin(), text.end(), '\n');
+
+  vector<Connection> conns(clients);
+  for(int i = 0; i < clients; i++){
+    conns[i].fd = connect_unix(argv[1]);
+    conns[i].sent = 0;
+    conns[i].done = false;
+    conns[i].lines = 0;
+  }
+  Stopwatch clock;
+  int open = clients;
+  vector<pollfd> fds(clients);
+  char buf[64 * 1024];
+  while(open > 0){
+    for(int i = 0; i < clients; i++){
+      fds[i].fd = conns[i].done ? -1 : conns[i].fd;
+      fds[i].events = POLLIN | (conns[i].sent < text.size() ? POLLOUT : 0);
+      fds[i].revents = 0;
+    }
+    poll(&fds[0], clients, -1);
+    for(int i = 0; i < clients; i++){
+      Connection & c = conns[i];
+      if(c.done)
+	continue;
+      if((fds[i].revents & POLLOUT) && c.sent < text.size()){
+	ssize_t n = send(c.fd, text.data() + c.sent, text.size() - c.sent, MSG_NOSIGNAL);
+	if(n > 0)
+	  c.sent += n;
+	if(c.sent == text.size())
+	  shutdown(c.fd, SHUT_WR);    // the server answers the rest, then closes
+      }
+      if(fds[i].revents & (POLLIN | POLLHUP | POLLERR)){
+	ssize_t n = read(c.fd, buf, sizeof(buf));
+	if(n > 0)
+	  c.lines += count(buf, buf + n, '\n');
+	else if(n == 0 || (errno != EAGAIN && errno != EINTR)){
+	  c.done = true;
+	  close(c.fd);
+	  open--;
+	}
+      }
+    }
+  }
+  double secs = clock.seconds();
+  cout << clients << " client(s) x " << commands << " commands in " << fixed << setprecision(3)
+       << secs << " s = " << setprecision(0) << clients * commands / secs << " commands/s" << endl;
+  for(int i = 0; i < clients; i++)
+    cout << "  client " << i << ": " << conns[i].lines << " response lines" << endl;
+  return 0;
+}
@@ -0,0 +1,62 @@
+//============================================================================
+// Name        : wal_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/wal_bench.out
+// Description : Insert/remove throughput of an AvlTree<string> with the
+// write-ahead log for a range of group commit sizes, against no log at all.
+// Usage: bench/wal_bench.out [directory] [mutations]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "../eavlwal.h"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+
+void run(const string & dir, int group, const vector<string>& words, int ops){
+  string db = dir + "/wal_bench_" + to_string(group);
+  unlink((db + "/wal").c_str());
+  unlink((db + "/snapshot").c_str());
+  AvlTree<string> t;
+  TreeLog<AvlTree<string> > *wal = NULL;
+  if(group > 0){
+    wal = new TreeLog<AvlTree<string> >(db, group, 0);
+    ostringstream ignore;
+    wal->recover(t, ignore);
+  }
+  Stopwatch clock;
+  for(int i = 0; i < ops; i++){
+    const string & w = words[i % words.size()];
+    bool insert = (i % 4) != 3;
+    if(wal != NULL)
+      wal->record(insert ? 'i' : 'r', w);
+    if(insert)
+      t.insert(w);
+    else
+      t.remove(w);
+    if(wal != NULL)
+      wal->applied(t);
+  }
+  if(wal != NULL)
+    wal->commit();
+  double secs = clock.seconds();
+  cout << "group " << setw(6) << (group > 0 ? to_string(group) : string("no log"))
+       << "  ops/s = " << setw(10) << (long)(ops / secs)
+       << "  fdatasyncs = " << (wal != NULL ? wal->sync_count() : 0) << endl;
+  delete wal;
+  unlink((db + "/wal").c_str());
+  rmdir(db.c_str());
+}
+
+int main(int argc, char* argv[]){
+  string dir = argc > 1 ? argv[1] : ".";
+  int ops = argc > 2 ? atoi(argv[2]) : 20000;
+  vector<string> words = make_words(5000);
+  cout << ops << " mutations, log under " << dir << endl;
+  run(dir, 0, words, ops);
+  int groups[] = { 1, 8, 64, 512, 4096 };
+  for(int i = 0; i < 5; i++)
+    run(dir, groups[i], words, ops);
+  return 0;
+}
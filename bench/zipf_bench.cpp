@@ -0,0 +1,46 @@
+//============================================================================
+// Name        : zipf_bench.cpp
+// Author      : William Widmer
+// Created     : March 2014
+// Build       : make bench/zipf_bench.out
+// Description : Compares the average number of nodes visited per find for the
+// strict AVL policy and the FrequencyBalance policy on Zipf-distributed finds.
+// Usage: bench/zipf_bench.out [words] [finds] [zipf exponent]
+//============================================================================
+
+#include "../eavltree.cpp"
+#include "benchutil.h"
+#include <cstdlib>
+#include <iomanip>
+
+template <typename Tree>
+void run(const char* name, const vector<string>& words, int finds, double s){
+  Tree t;
+  for(unsigned int i = 0; i < words.size(); i++)
+    t.insert(words[i]);
+  // Popularity is independent of insertion order, otherwise the hot keys
+  // are the early inserts, which AVL already keeps near the root.
+  vector<string> by_rank(words);
+  shuffle(by_rank.begin(), by_rank.end(), mt19937(7));
+  ZipfSampler zipf(words.size(), s);
+  int freq;
+  Stopwatch clock;
+  for(int i = 0; i < finds; i++)
+    t.find(by_rank[zipf.next()], freq);
+  double secs = clock.seconds();
+  cout << left << setw(18) << name
+       << " avg nodes visited = " << setw(9) << t.avge_node_visits()
+       << " height = " << setw(4) << t.height()
+       << " ns/find = " << secs * 1e9 / finds << endl;
+}
+
+int main(int argc, char* argv[]){
+  int n = argc > 1 ? atoi(argv[1]) : 100000;
+  int finds = argc > 2 ? atoi(argv[2]) : 2000000;
+  double s = argc > 3 ? atof(argv[3]) : 1.0;
+  vector<string> words = make_words(n);
+  cout << n << " words, " << finds << " finds, zipf s = " << s << endl;
+  run<AvlTree<string> >("AvlBalance", words, finds, s);
+  run<AvlTree<string, FrequencyBalance> >("FrequencyBalance", words, finds, s);
+  return 0;
+}
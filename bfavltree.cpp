@@ -0,0 +1,407 @@
+//=============================================================
+// Name:  BFAVLTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "bfavltree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the balance factor AVL tree engine.
+// Like AvlTree, insert and remove recurse down and repair the tree on the
+// way back up, but each level reports whether its subtree's height changed
+// and the retracing stops at the first level where it did not.
+//
+//============================================================
+
+#include "bfavltree.h"
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable>
+bool BfAvlTree<Comparable>::contains( const Comparable & x ) const
+{
+  BfNode *t = root;
+  while(t != NULL){
+    if(x < t->element)
+      t = t->left;
+    else if(t->element < x)
+      t = t->right;
+    else
+      return true;
+  }
+  return false;
+}
+
+template <typename Comparable>
+bool BfAvlTree<Comparable>::is_empty( ) const
+{
+  return root == NULL;
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+  EAVL_STAT(counters.report(cout));
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::height(){
+  if(root == NULL)
+    return 0;
+  int h = 0;
+  // A balanced node's children are equally tall, so either side will do.
+  for(BfNode *t = root->balance > 0 ? root->right : root->left; t != NULL; t = t->balance > 0 ? t->right : t->left)
+    h++;
+  return h;
+}
+
+template <typename Comparable>
+long long BfAvlTree<Comparable>::int_path_length(){
+  return int_path_length(root, 0);
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::size(){
+  return size_t;
+}
+
+template <typename Comparable>
+float BfAvlTree<Comparable>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+#ifdef EAVL_STATS
+template <typename Comparable>
+const AvlStats & BfAvlTree<Comparable>::stats() const{
+  return counters;
+}
+#endif
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::display(ostream& os){
+  if(is_empty())
+    os << "Empty tree" << endl;
+  else
+    print_tree(root, os);
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::find(const Comparable &x, int &freq){
+  finds++;
+  EAVL_STAT(counters.finds++);
+  int visited = 0;
+  BfNode *t = root;
+  while(t != NULL){
+    if(t->element == x){
+      freq = t->freq;
+      break;
+    }else if(t->element > x){
+      t = t->left;
+    }else{
+      t = t->right;
+    }
+    visited++;
+  }
+  nodes_visited += visited;
+  EAVL_STAT(counters.find_visits += visited);
+  return visited;
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::make_empty(){
+  make_empty(root);
+  size_t = 0;
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::insert(const Comparable &x){
+  EAVL_STAT(counters.inserts++);
+  bool grew;
+  return insert(x, root, grew);
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::remove(const Comparable &x){
+  EAVL_STAT(counters.removes++);
+  bool shrank;
+  return remove(x, root, shrank);
+}
+
+template <typename Comparable>
+bool BfAvlTree<Comparable>::check(ostream & err) const{
+  return check(root, NULL, NULL, err) != -2;
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable>
+int BfAvlTree<Comparable>::insert(const Comparable &x, BfNode *&t, bool &grew){
+  if(t == NULL){
+    t = new BfNode(x, NULL, NULL);
+    size_t++;
+    grew = true;
+    return 1;
+  }
+  EAVL_STAT(counters.insert_visits++);
+  int freq;
+  if(x < t->element){
+    freq = insert(x, t->left, grew);
+    if(grew)
+      grew = left_grew(t);
+  }else if(t->element < x){
+    freq = insert(x, t->right, grew);
+    if(grew)
+      grew = right_grew(t);
+  }else{
+    grew = false;
+    freq = ++t->freq;
+  }
+  return freq;
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::remove(const Comparable &x, BfNode *&t, bool &shrank){
+  shrank = false;
+  if(t == NULL)
+    return -1;    // Item not found; do nothing
+  EAVL_STAT(counters.remove_visits++);
+  int freq;
+  if(x < t->element){
+    freq = remove(x, t->left, shrank);
+    if(shrank)
+      shrank = left_shrank(t);
+  }else if(t->element < x){
+    freq = remove(x, t->right, shrank);
+    if(shrank)
+      shrank = right_shrank(t);
+  }else {
+    freq = --t->freq;
+    if(freq < 1){
+      BfNode *old_node = t;
+      if(t->left != NULL && t->right != NULL){
+	// Relink the successor node in t's place, keeping t's balance factor.
+	bool right_shorter;
+	BfNode *successor = detach_min(t->right, right_shorter);
+	successor->left = t->left;
+	successor->right = t->right;
+	successor->balance = t->balance;
+	t = successor;
+	shrank = right_shorter && right_shrank(t);
+      } else {
+	t = (t->left != NULL) ? t->left : t->right;
+	shrank = true;
+      }
+      delete old_node;
+      size_t--;
+    }
+  }
+  return freq;
+}
+
+template <typename Comparable>
+typename BfAvlTree<Comparable>::BfNode * BfAvlTree<Comparable>::detach_min(BfNode *&t, bool &shrank){
+  EAVL_STAT(counters.remove_visits++);
+  if(t->left == NULL){
+    BfNode *min = t;
+    t = t->right;
+    shrank = true;
+    return min;
+  }
+  BfNode *min = detach_min(t->left, shrank);
+  if(shrank)
+    shrank = left_shrank(t);
+  return min;
+}
+
+template <typename Comparable>
+bool BfAvlTree<Comparable>::left_grew(BfNode *&t){
+  if(t->balance > 0){
+    t->balance = 0;
+    return false;
+  }
+  if(t->balance == 0){
+    t->balance = -1;
+    EAVL_STAT(counters.height_changes++);
+    return true;
+  }
+  if(t->left->balance < 0){
+    EAVL_STAT(counters.single_left++);     // case 1
+    rotate_with_left_child(t);
+    t->balance = 0;
+    t->right->balance = 0;
+  } else {
+    EAVL_STAT(counters.double_left++);     // case 2
+    double_with_left_child(t);
+  }
+  return false;
+}
+
+template <typename Comparable>
+bool BfAvlTree<Comparable>::right_grew(BfNode *&t){
+  if(t->balance < 0){
+    t->balance = 0;
+    return false;
+  }
+  if(t->balance == 0){
+    t->balance = 1;
+    EAVL_STAT(counters.height_changes++);
+    return true;
+  }
+  if(t->right->balance > 0){
+    EAVL_STAT(counters.single_right++);    // case 4
+    rotate_with_right_child(t);
+    t->balance = 0;
+    t->left->balance = 0;
+  } else {
+    EAVL_STAT(counters.double_right++);    // case 3
+    double_with_right_child(t);
+  }
+  return false;
+}
+
+template <typename Comparable>
+bool BfAvlTree<Comparable>::left_shrank(BfNode *&t){
+  if(t->balance < 0){
+    t->balance = 0;
+    EAVL_STAT(counters.height_changes++);
+    return true;
+  }
+  if(t->balance == 0){
+    t->balance = 1;
+    return false;
+  }
+  int right = t->right->balance;
+  if(right < 0){
+    EAVL_STAT(counters.double_right++);    // case 3
+    double_with_right_child(t);
+    return true;
+  }
+  EAVL_STAT(counters.single_right++);      // case 4
+  rotate_with_right_child(t);
+  if(right == 0){    // the rotation keeps the subtree's height
+    t->balance = -1;
+    t->left->balance = 1;
+    return false;
+  }
+  t->balance = 0;
+  t->left->balance = 0;
+  return true;
+}
+
+template <typename Comparable>
+bool BfAvlTree<Comparable>::right_shrank(BfNode *&t){
+  if(t->balance > 0){
+    t->balance = 0;
+    EAVL_STAT(counters.height_changes++);
+    return true;
+  }
+  if(t->balance == 0){
+    t->balance = -1;
+    return false;
+  }
+  int left = t->left->balance;
+  if(left > 0){
+    EAVL_STAT(counters.double_left++);     // case 2
+    double_with_left_child(t);
+    return true;
+  }
+  EAVL_STAT(counters.single_left++);       // case 1
+  rotate_with_left_child(t);
+  if(left == 0){
+    t->balance = 1;
+    t->right->balance = -1;
+    return false;
+  }
+  t->balance = 0;
+  t->right->balance = 0;
+  return true;
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::double_with_left_child(BfNode *&k3){
+  rotate_with_right_child(k3->left);
+  rotate_with_left_child(k3);
+  k3->left->balance = k3->balance > 0 ? -1 : 0;
+  k3->right->balance = k3->balance < 0 ? 1 : 0;
+  k3->balance = 0;
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::double_with_right_child(BfNode *&k1){
+  rotate_with_left_child(k1->right);
+  rotate_with_right_child(k1);
+  k1->left->balance = k1->balance > 0 ? -1 : 0;
+  k1->right->balance = k1->balance < 0 ? 1 : 0;
+  k1->balance = 0;
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::rotate_with_left_child(BfNode *&k2){
+  BfNode *k1 = k2->left;
+  k2->left = k1->right;
+  k1->right = k2;
+  k2 = k1;
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::rotate_with_right_child(BfNode *&k1){
+  BfNode *k2 = k1->right;
+  k1->right = k2->left;
+  k2->left = k1;
+  k1 = k2;
+}
+
+template <typename Comparable>
+long long BfAvlTree<Comparable>::int_path_length(BfNode *t, int val){
+  if(t == NULL)
+    return 0;
+  return val + int_path_length(t->left, val + 1) + int_path_length(t->right, val + 1);
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::print_tree(BfNode *t, ostream& os) const{
+  if(t != NULL){
+    print_tree(t->left, os);
+    os << t->element << endl;
+    print_tree(t->right, os);
+  }
+}
+
+template <typename Comparable>
+void BfAvlTree<Comparable>::make_empty(BfNode *&t){
+  if(t != NULL){
+    make_empty(t->left);
+    make_empty(t->right);
+    delete t;
+  }
+  t = NULL;
+}
+
+template <typename Comparable>
+int BfAvlTree<Comparable>::check(const BfNode *t, const Comparable *lo, const Comparable *hi, ostream & err) const{
+  if(t == NULL)
+    return -1;
+  if((lo != NULL && !(*lo < t->element)) || (hi != NULL && !(t->element < *hi))){
+    err << "key " << t->element << " out of order" << endl;
+    return -2;
+  }
+  int lh = check(t->left, lo, &t->element, err);
+  int rh = lh == -2 ? -2 : check(t->right, &t->element, hi, err);
+  if(rh == -2)
+    return -2;
+  if(t->balance != rh - lh || t->balance < -1 || t->balance > 1){
+    err << "key " << t->element << " has balance factor " << (int)t->balance
+	<< ", left height " << lh << ", right height " << rh << endl;
+    return -2;
+  }
+  return (lh > rh ? lh : rh) + 1;
+}
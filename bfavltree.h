@@ -0,0 +1,196 @@
+//=============================================================
+// Name:  BFAVLTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through bfavltree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for an AVL tree whose nodes keep a balance
+// factor (-1, 0 or 1: right height minus left height, two bits of
+// information in one byte) instead of a height, with the enhanced AVL Tree
+// API and frequency counting. The byte shares the word freq leaves padded,
+// so a node is 8 bytes smaller than AvlTree's. Inserts and removes retrace
+// on balance factors alone, stopping at the first node whose height does
+// not change; height() walks down the taller side of each node.
+// Functions are implemented in bfavltree.cpp.
+//
+//============================================================
+
+#ifndef BFAVL_TREE_H_INCLUDED
+#define BFAVL_TREE_H_INCLUDED
+
+#include <iostream>
+#include "eavlstats.h"
+
+using namespace std;
+
+// BfAvlTree class
+//
+// CONSTRUCTION: zero parameter
+//
+// ******************PUBLIC OPERATIONS*********************
+// int insert( x )        --> Insert x, returns its frequency
+// int remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )    --> Returns nodes visited, sets freq
+// bool contains( x )     --> Return true if x is present
+// void report( )         --> Print size, height, path length, average visits
+// void display( os )     --> Print tree in sorted order
+// bool check( err )      --> Verify order and balance factors
+// void make_empty( )     --> Remove all items
+//
+// With EAVL_STATS, rotations are counted by AVL case and height_changes
+// counts the nodes whose height changed while retracing.
+
+template <typename Comparable>
+class BfAvlTree
+{
+ public:
+ BfAvlTree( ):root(NULL),size_t(0),finds(0),nodes_visited(0){}
+
+  ~BfAvlTree( ){
+    make_empty();
+  }
+
+  bool contains( const Comparable & x ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  /**
+   * Returns the height of the tree: the length of the path that always
+   * steps to the taller child, O(log n) with no heights stored.
+   */
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+#ifdef EAVL_STATS
+  const AvlStats & stats() const;
+#endif
+
+  /**
+   * Displays the tree in order from lowest to highest.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if found.
+   */
+  int find(const Comparable &x, int &freq);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   */
+  int insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   */
+  int remove(const Comparable &x);
+
+  /**
+   * Checks keys are in order and every balance factor is the node's real
+   * right minus left height, within one. Describes the first problem on err.
+   */
+  bool check(ostream & err) const;
+
+  /**
+   * Bytes of one node (key included), for comparison with AvlTree's.
+   */
+  static int node_bytes(){
+    return sizeof(BfNode);
+  }
+
+ private:
+  struct BfNode
+  {
+    Comparable element;
+    BfNode *left;
+    BfNode *right;
+    int freq;
+    signed char balance;    // right height minus left height
+
+  BfNode(const Comparable &ele, BfNode *lt, BfNode *rt, int q = 1)
+  :element(ele),left(lt),right(rt),freq(q),balance(0){}
+  };
+
+  BfNode *root;
+  int size_t;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+#ifdef EAVL_STATS
+  AvlStats counters;
+#endif
+
+  /**
+   * Inserts x into subtree t; grew is set if t got taller. Returns x's frequency.
+   */
+  int insert(const Comparable &x, BfNode *&t, bool &grew);
+
+  /**
+   * Removes x from subtree t; shrank is set if t got shorter.
+   * Returns x's remaining frequency or -1 if x is not in t.
+   */
+  int remove(const Comparable &x, BfNode *&t, bool &shrank);
+
+  /**
+   * Unlinks the smallest node of subtree t, retracing on the way back up,
+   * and returns it; shrank is set if t got shorter. t must not be NULL.
+   */
+  BfNode * detach_min(BfNode *&t, bool &shrank);
+
+  /**
+   * Retracing after t's left (right) subtree got one taller: updates t's
+   * balance factor, rotating if it would reach 2. Returns true if t's
+   * subtree got taller too.
+   */
+  bool left_grew(BfNode *&t);
+
+  bool right_grew(BfNode *&t);
+
+  /**
+   * Retracing after t's left (right) subtree got one shorter. Returns true
+   * if t's subtree got shorter too.
+   */
+  bool left_shrank(BfNode *&t);
+
+  bool right_shrank(BfNode *&t);
+
+  /**
+   * Double rotations leave the middle node on top, balanced; the nodes
+   * either side take their balance factors from its old one.
+   */
+  void double_with_left_child(BfNode *&k3);
+
+  void double_with_right_child(BfNode *&k1);
+
+  void rotate_with_left_child(BfNode *&k2);
+
+  void rotate_with_right_child(BfNode *&k1);
+
+  long long int_path_length(BfNode *t, int val);
+
+  void print_tree(BfNode *t, ostream& os) const;
+
+  void make_empty(BfNode *&t);
+
+  /**
+   * check() for subtree t, keys strictly between lo and hi (NULL is
+   * unbounded). Returns t's height, or -2 on a problem.
+   */
+  int check(const BfNode *t, const Comparable *lo, const Comparable *hi, ostream & err) const;
+
+  BfAvlTree( const BfAvlTree & );
+  BfAvlTree & operator=( const BfAvlTree & );
+};
+#endif
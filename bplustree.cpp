@@ -0,0 +1,459 @@
+//=============================================================
+// Name:  BPLUSTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "bplustree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the B+ tree engine.
+//
+//============================================================
+
+#include "bplustree.h"
+
+/**
+ * Whether BPlusTree searches prefixes with AVX2; one setting shared by
+ * every BPlusTree instantiation.
+ */
+inline bool & prefix_simd(){
+#if defined(__x86_64__)
+  static bool on = __builtin_cpu_supports("avx2");
+#else
+  static bool on = false;
+#endif
+  return on;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/**
+ * AVX2 count of prefix[0, n) below p: 4 unsigned 64 bit compares per step
+ * (signed compare after flipping the sign bits). Reads whole groups of 4,
+ * so prefix must have room for n rounded up to a multiple of 4.
+ */
+__attribute__((target("avx2")))
+inline int prefix_count_less_avx2(const uint64_t *prefix, int n, uint64_t p){
+  const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+  const __m256i key = _mm256_xor_si256(_mm256_set1_epi64x((long long)p), bias);
+  int count = 0;
+  for(int i = 0; i < n; i += 4){
+    __m256i v = _mm256_xor_si256(_mm256_load_si256((const __m256i *)(prefix + i)), bias);
+    unsigned int m = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, v)));
+    if(n - i < 4)
+      m &= (1u << (n - i)) - 1;
+    count += __builtin_popcount(m);
+  }
+  return count;
+}
+#endif
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable, int NodeLines>
+bool BPlusTree<Comparable, NodeLines>::contains( const Comparable & x ) const
+{
+  if(root == NULL)
+    return false;
+  uint64_t p = KeyPrefix<Comparable>::of(x);
+  BNode *t = root;
+  while(!t->leaf)
+    t = as_inner(t)->child[child_position(t, x, p)];
+  int i = leaf_position(t, x, p);
+  return i < t->n && t->keys[i] == x;
+}
+
+template <typename Comparable, int NodeLines>
+bool BPlusTree<Comparable, NodeLines>::is_empty( ) const
+{
+  return root == NULL;
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+  EAVL_STAT(counters.report(cout));
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::height(){
+  int h = 0;
+  for(BNode *t = root; t != NULL && !t->leaf; t = as_inner(t)->child[0])
+    h++;
+  return h;
+}
+
+template <typename Comparable, int NodeLines>
+long long BPlusTree<Comparable, NodeLines>::int_path_length(){
+  return (long long)height() * size_t;    // every key is in a leaf
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::size(){
+  return size_t;
+}
+
+template <typename Comparable, int NodeLines>
+float BPlusTree<Comparable, NodeLines>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+#ifdef EAVL_STATS
+template <typename Comparable, int NodeLines>
+const AvlStats & BPlusTree<Comparable, NodeLines>::stats() const{
+  return counters;
+}
+#endif
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::display(ostream& os){
+  if(is_empty()){
+    os << "Empty tree" << endl;
+    return;
+  }
+  BNode *t = root;
+  while(!t->leaf)
+    t = as_inner(t)->child[0];
+  for(BLeaf *l = as_leaf(t); l != NULL; l = l->next)
+    for(int i = 0; i < l->n; i++)
+      os << l->keys[i] << endl;
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::find(const Comparable &x, int &freq){
+  finds++;
+  EAVL_STAT(counters.finds++);
+  int visited = 0;
+  if(root != NULL){
+    uint64_t p = KeyPrefix<Comparable>::of(x);
+    BNode *t = root;
+    while(!t->leaf){
+      t = as_inner(t)->child[child_position(t, x, p)];
+      visited++;
+    }
+    int i = leaf_position(t, x, p);
+    if(i < t->n && t->keys[i] == x)
+      freq = as_leaf(t)->freq[i];
+    else
+      visited++;    // the leaf was searched too
+  }
+  nodes_visited += visited;
+  EAVL_STAT(counters.find_visits += visited);
+  return visited;
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::make_empty(){
+  make_empty(root);
+  root = NULL;
+  size_t = 0;
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::insert(const Comparable &x){
+  EAVL_STAT(counters.inserts++);
+  if(root == NULL)
+    root = new BLeaf();
+  int freq = 1;
+  Comparable sep;
+  uint64_t sep_prefix;
+  BNode *right = insert(x, KeyPrefix<Comparable>::of(x), root, freq, sep, sep_prefix);
+  if(right != NULL){
+    BInner *r = new BInner();
+    r->keys[0] = std::move(sep);
+    r->prefix[0] = sep_prefix;
+    r->child[0] = root;
+    r->child[1] = right;
+    r->n = 1;
+    root = r;
+  }
+  return freq;
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::remove(const Comparable &x){
+  EAVL_STAT(counters.removes++);
+  if(root == NULL)
+    return -1;
+  int freq = remove(x, KeyPrefix<Comparable>::of(x), root);
+  if(root->n == 0){
+    BNode *old_root = root;
+    root = root->leaf ? NULL : as_inner(root)->child[0];
+    free_node(old_root);
+  }
+  return freq;
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::set_simd(bool on){
+#if defined(__x86_64__)
+  prefix_simd() = on && __builtin_cpu_supports("avx2");
+#else
+  prefix_simd() = false;
+#endif
+}
+
+template <typename Comparable, int NodeLines>
+bool BPlusTree<Comparable, NodeLines>::simd_enabled(){
+  return prefix_simd();
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::count_less(const uint64_t *prefix, int n, uint64_t p){
+#if defined(__x86_64__)
+  if(prefix_simd())
+    return prefix_count_less_avx2(prefix, n, p);
+#endif
+  int i = 0;
+  while(i < n && prefix[i] < p)
+    i++;
+  return i;
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::leaf_position(const BNode *t, const Comparable &x, uint64_t p){
+  int i = count_less(t->prefix, t->n, p);
+  while(i < t->n && t->prefix[i] == p && t->keys[i] < x)
+    i++;
+  return i;
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::child_position(const BNode *t, const Comparable &x, uint64_t p){
+  // Separator i is the smallest key of child i + 1, so x goes right of every separator <= x.
+  int i = count_less(t->prefix, t->n, p);
+  while(i < t->n && t->prefix[i] == p && !(x < t->keys[i]))
+    i++;
+  return i;
+}
+
+template <typename Comparable, int NodeLines>
+typename BPlusTree<Comparable, NodeLines>::BNode *
+BPlusTree<Comparable, NodeLines>::insert(const Comparable &x, uint64_t p, BNode *t, int &freq, Comparable &sep, uint64_t &sep_prefix){
+  EAVL_STAT(counters.insert_visits++);
+  if(t->leaf){
+    BLeaf *l = as_leaf(t);
+    int i = leaf_position(l, x, p);
+    if(i < l->n && l->keys[i] == x){
+      freq = ++l->freq[i];
+      return NULL;
+    }
+    freq = 1;
+    size_t++;
+    BLeaf *target = l;
+    BLeaf *right = NULL;
+    if(l->n == FANOUT){
+      // Split in half and chain the new leaf after l.
+      EAVL_STAT(counters.height_changes++);
+      right = new BLeaf();
+      int half = FANOUT / 2;
+      for(int j = half; j < FANOUT; j++)
+	move_slot(right, j - half, l, j);
+      right->n = FANOUT - half;
+      l->n = half;
+      right->next = l->next;
+      l->next = right;
+      if(i > half){
+	target = right;
+	i -= half;
+      }
+    }
+    open_slot(target, i);
+    target->keys[i] = x;
+    target->prefix[i] = p;
+    target->freq[i] = 1;
+    target->n++;
+    if(right != NULL){
+      sep = right->keys[0];
+      sep_prefix = right->prefix[0];
+    }
+    return right;
+  }
+
+  BInner *in = as_inner(t);
+  int i = child_position(in, x, p);
+  Comparable child_sep;
+  uint64_t child_prefix;
+  BNode *child_right = insert(x, p, in->child[i], freq, child_sep, child_prefix);
+  if(child_right == NULL)
+    return NULL;
+  BInner *target = in;
+  BInner *right = NULL;
+  if(in->n == FANOUT){
+    // Split around separator mid, which moves up to the parent.
+    EAVL_STAT(counters.height_changes++);
+    right = new BInner();
+    int mid = FANOUT / 2;
+    for(int j = mid + 1; j < FANOUT; j++)
+      move_slot(right, j - mid - 1, in, j);
+    for(int j = mid + 1; j <= FANOUT; j++)
+      right->child[j - mid - 1] = in->child[j];
+    right->n = FANOUT - mid - 1;
+    sep = std::move(in->keys[mid]);
+    sep_prefix = in->prefix[mid];
+    in->n = mid;
+    if(i > mid){
+      target = right;
+      i -= mid + 1;
+    }
+  }
+  open_slot(target, i);
+  for(int j = target->n + 1; j > i + 1; j--)
+    target->child[j] = target->child[j - 1];
+  target->keys[i] = std::move(child_sep);
+  target->prefix[i] = child_prefix;
+  target->child[i + 1] = child_right;
+  target->n++;
+  return right;
+}
+
+template <typename Comparable, int NodeLines>
+int BPlusTree<Comparable, NodeLines>::remove(const Comparable &x, uint64_t p, BNode *t){
+  EAVL_STAT(counters.remove_visits++);
+  if(t->leaf){
+    int i = leaf_position(t, x, p);
+    if(i >= t->n || !(t->keys[i] == x))
+      return -1;    // Item not found; do nothing
+    int freq = --as_leaf(t)->freq[i];
+    if(freq < 1){
+      close_slot(t, i);
+      t->n--;
+      size_t--;
+    }
+    return freq;
+  }
+  BInner *in = as_inner(t);
+  int i = child_position(in, x, p);
+  int freq = remove(x, p, in->child[i]);
+  BNode *c = in->child[i];
+  if(freq == 0 && c->n < (c->leaf ? MIN_LEAF : MIN_INNER))
+    fill_child(in, i);
+  return freq;
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::fill_child(BInner *p, int i){
+  BNode *c = p->child[i];
+  int min = c->leaf ? MIN_LEAF : MIN_INNER;
+  if(i > 0 && p->child[i - 1]->n > min){
+    EAVL_STAT(counters.single_left++);
+    BNode *s = p->child[i - 1];
+    open_slot(c, 0);
+    if(c->leaf){
+      // Take s's last key; it becomes c's smallest, and so the separator.
+      move_slot(c, 0, s, s->n - 1);
+      p->keys[i - 1] = c->keys[0];
+      p->prefix[i - 1] = c->prefix[0];
+    } else {
+      // Rotate through the parent: separator down, s's last separator up.
+      BInner *ci = as_inner(c), *si = as_inner(s);
+      for(int j = c->n + 1; j > 0; j--)
+	ci->child[j] = ci->child[j - 1];
+      ci->child[0] = si->child[s->n];
+      move_slot(c, 0, p, i - 1);
+      move_slot(p, i - 1, s, s->n - 1);
+    }
+    s->n--;
+    c->n++;
+    return;
+  }
+  if(i < p->n && p->child[i + 1]->n > min){
+    EAVL_STAT(counters.single_right++);
+    BNode *s = p->child[i + 1];
+    if(c->leaf){
+      move_slot(c, c->n, s, 0);
+      close_slot(s, 0);
+      p->keys[i] = s->keys[0];
+      p->prefix[i] = s->prefix[0];
+    } else {
+      BInner *ci = as_inner(c), *si = as_inner(s);
+      move_slot(c, c->n, p, i);
+      ci->child[c->n + 1] = si->child[0];
+      move_slot(p, i, s, 0);
+      close_slot(s, 0);
+      for(int j = 0; j < s->n; j++)
+	si->child[j] = si->child[j + 1];
+    }
+    s->n--;
+    c->n++;
+    return;
+  }
+  merge_children(p, i < p->n ? i : i - 1);
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::merge_children(BInner *p, int i){
+  EAVL_STAT(counters.height_changes++);
+  BNode *l = p->child[i];
+  BNode *r = p->child[i + 1];
+  if(l->leaf){
+    for(int j = 0; j < r->n; j++)
+      move_slot(l, l->n + j, r, j);
+    l->n += r->n;
+    as_leaf(l)->next = as_leaf(r)->next;
+  } else {
+    // The separator between them comes down.
+    BInner *li = as_inner(l), *ri = as_inner(r);
+    move_slot(l, l->n, p, i);
+    for(int j = 0; j < r->n; j++)
+      move_slot(l, l->n + 1 + j, r, j);
+    for(int j = 0; j <= r->n; j++)
+      li->child[l->n + 1 + j] = ri->child[j];
+    l->n += r->n + 1;
+  }
+  close_slot(p, i);
+  for(int j = i + 1; j < p->n; j++)
+    p->child[j] = p->child[j + 1];
+  p->n--;
+  free_node(r);
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::move_slot(BNode *to, int j, BNode *from, int k){
+  to->keys[j] = std::move(from->keys[k]);
+  to->prefix[j] = from->prefix[k];
+  if(to->leaf)    // slots only move between two leaves or two inner nodes
+    as_leaf(to)->freq[j] = as_leaf(from)->freq[k];
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::open_slot(BNode *t, int i){
+  for(int j = t->n; j > i; j--)
+    move_slot(t, j, t, j - 1);
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::close_slot(BNode *t, int i){
+  for(int j = i; j < t->n - 1; j++)
+    move_slot(t, j, t, j + 1);
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::make_empty(BNode *t){
+  if(t != NULL){
+    if(!t->leaf)
+      for(int i = 0; i <= t->n; i++)
+	make_empty(as_inner(t)->child[i]);
+    free_node(t);
+  }
+}
+
+template <typename Comparable, int NodeLines>
+void BPlusTree<Comparable, NodeLines>::free_node(BNode *t){
+  if(t->leaf)
+    delete as_leaf(t);
+  else
+    delete as_inner(t);
+}
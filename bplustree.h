@@ -0,0 +1,256 @@
+//=============================================================
+// Name:  BPLUSTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through bplustree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for a B+ tree with the enhanced AVL Tree API and
+// frequency counting. Every node starts with a cache-line aligned array of
+// fixed-width 8 byte key prefixes (NodeLines cache lines of them), which is
+// searched 4 prefixes per instruction with AVX2 when the CPU has it; the
+// full keys are only compared when prefixes tie. The keys follow, so a node
+// spans more lines than its prefixes. Keys and frequencies live in the
+// leaves, which are chained for in-order display; inner nodes hold
+// separators and child pointers.
+// Functions are implemented in bplustree.cpp.
+//
+//============================================================
+
+#ifndef BPLUS_TREE_H_INCLUDED
+#define BPLUS_TREE_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "eavlstats.h"
+
+using namespace std;
+
+/**
+ * Order-preserving 8 byte prefix of a key: a < b implies
+ * KeyPrefix::of(a) <= KeyPrefix::of(b). Keys whose prefixes tie are
+ * compared in full. The default maps every key to 0, so only the full
+ * comparisons order them.
+ */
+template <typename Comparable, typename Enable = void>
+struct KeyPrefix
+{
+  static uint64_t of(const Comparable &){
+    return 0;
+  }
+};
+
+// Strings: the first 8 bytes, big-endian and zero padded.
+template <>
+struct KeyPrefix<string>
+{
+  static uint64_t of(const string &s){
+    uint64_t p = 0;
+    for(unsigned int i = 0; i < 8; i++)
+      p = (p << 8) | (i < s.size() ? (unsigned char)s[i] : 0);
+    return p;
+  }
+};
+
+// Integers: the value itself, with the sign bit flipped for signed types.
+template <typename Comparable>
+struct KeyPrefix<Comparable, typename enable_if<is_integral<Comparable>::value>::type>
+{
+  static uint64_t of(const Comparable &x){
+    uint64_t p = (uint64_t)(long long)x;
+    return is_signed<Comparable>::value ? p ^ 0x8000000000000000ULL : p;
+  }
+};
+
+// BPlusTree class
+//
+// CONSTRUCTION: zero parameter
+// NodeLines:     cache lines of prefixes per node (1 to 4), so a node holds
+//                up to 8 * NodeLines keys. The keys, and the frequencies
+//                (leaves) or child pointers (inner nodes), come after them.
+//
+// ******************PUBLIC OPERATIONS*********************
+// int insert( x )        --> Insert x, returns its frequency
+// int remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )    --> Returns nodes visited, sets freq
+// bool contains( x )     --> Return true if x is present
+// void report( )         --> Print size, height, path length, average visits
+// void display( os )     --> Print tree in sorted order, along the leaf chain
+// void make_empty( )     --> Remove all items
+//
+// report() counts nodes as BTree does. Every key is in a leaf, so a find
+// that hits always visits height() nodes before the leaf.
+// With EAVL_STATS, moving a key from a left (right) sibling counts as a
+// single left (right) rotation, and height_changes counts splits and merges.
+
+template <typename Comparable, int NodeLines = 2>
+class BPlusTree
+{
+ public:
+  static_assert(NodeLines >= 1 && NodeLines <= 4, "BPlusTree nodes have 1 to 4 cache lines of prefixes");
+  static const int FANOUT = NodeLines * 8;
+  // Fewest keys in a leaf, and separators in an inner node, other than the root
+  static const int MIN_LEAF = FANOUT / 2;
+  static const int MIN_INNER = (FANOUT - 1) / 2;
+
+ BPlusTree( ):root(NULL),size_t(0),finds(0),nodes_visited(0){}
+
+  ~BPlusTree( ){
+    make_empty();
+  }
+
+  bool contains( const Comparable & x ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+#ifdef EAVL_STATS
+  const AvlStats & stats() const;
+#endif
+
+  /**
+   * Displays the tree in order from lowest to highest by walking the leaf chain.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if found.
+   */
+  int find(const Comparable &x, int &freq);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   */
+  int insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   */
+  int remove(const Comparable &x);
+
+  /**
+   * Turns the AVX2 prefix search on or off for every BPlusTree (for
+   * benchmarking). It starts on when the CPU supports AVX2.
+   */
+  static void set_simd(bool on);
+
+  static bool simd_enabled();
+
+ private:
+  // What leaves and inner nodes share; a BNode is always one of the two
+  // below, told apart by leaf.
+  struct BNode
+  {
+    alignas(64) uint64_t prefix[FANOUT];
+    int n;
+    bool leaf;
+    Comparable keys[FANOUT];   // leaves: keys; inner nodes: separators
+
+  explicit BNode(bool is_leaf):n(0),leaf(is_leaf)
+    {
+      memset(prefix, 0, sizeof(prefix));
+    }
+  };
+
+  struct BLeaf : BNode
+  {
+    int freq[FANOUT];
+    BLeaf *next;               // next leaf in key order
+
+  BLeaf( ):BNode(true),next(NULL){}
+  };
+
+  struct BInner : BNode
+  {
+    BNode *child[FANOUT + 1];
+
+  BInner( ):BNode(false){}
+  };
+
+  static BLeaf * as_leaf(BNode *t){
+    return static_cast<BLeaf*>(t);
+  }
+
+  static BInner * as_inner(BNode *t){
+    return static_cast<BInner*>(t);
+  }
+
+  BNode *root;
+  int size_t;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+#ifdef EAVL_STATS
+  AvlStats counters;
+#endif
+
+  /**
+   * Number of prefixes among prefix[0, n) that are less than p.
+   */
+  static int count_less(const uint64_t *prefix, int n, uint64_t p);
+
+  /**
+   * Index of the first key in leaf t that is not less than x.
+   */
+  static int leaf_position(const BNode *t, const Comparable &x, uint64_t p);
+
+  /**
+   * Index of the child of inner node t whose subtree holds x.
+   */
+  static int child_position(const BNode *t, const Comparable &x, uint64_t p);
+
+  /**
+   * Inserts x below t. If t had to split, returns the new right half and
+   * sets sep to the separator that goes into t's parent; otherwise NULL.
+   */
+  BNode * insert(const Comparable &x, uint64_t p, BNode *t, int &freq, Comparable &sep, uint64_t &sep_prefix);
+
+  /**
+   * Removes x below t and tops up any child left with too few keys.
+   * Returns x's remaining frequency or -1 if x is not in t.
+   */
+  int remove(const Comparable &x, uint64_t p, BNode *t);
+
+  /**
+   * Gives p's child i (which has one key too few) a key from a sibling,
+   * or merges it with one.
+   */
+  void fill_child(BInner *p, int i);
+
+  void merge_children(BInner *p, int i);
+
+  // Moves slot k of from to slot j of to (key, prefix and, in leaves, freq).
+  static void move_slot(BNode *to, int j, BNode *from, int k);
+
+  // Opens slot i of t (keys, prefixes, freqs); t->n is unchanged.
+  static void open_slot(BNode *t, int i);
+
+  // Closes slot i of t; t->n is unchanged.
+  static void close_slot(BNode *t, int i);
+
+  void make_empty(BNode *t);
+
+  // Deletes t as the leaf or inner node it is.
+  static void free_node(BNode *t);
+
+  BPlusTree( const BPlusTree & );
+  BPlusTree & operator=( const BPlusTree & );
+};
+#endif
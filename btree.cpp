@@ -0,0 +1,362 @@
+//=============================================================
+// Name:  BTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "btree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the B-tree engine.
+//
+//============================================================
+
+#include "btree.h"
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable, int NodeBytes>
+bool BTree<Comparable, NodeBytes>::contains( const Comparable & x ) const
+{
+  BNode *t = root;
+  while(t != NULL){
+    int i = position(t, x);
+    if(i < t->n && t->keys[i] == x)
+      return true;
+    t = t->leaf ? NULL : t->child[i];
+  }
+  return false;
+}
+
+template <typename Comparable, int NodeBytes>
+bool BTree<Comparable, NodeBytes>::is_empty( ) const
+{
+  return root == NULL;
+}
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+  EAVL_STAT(counters.report(cout));
+}
+
+template <typename Comparable, int NodeBytes>
+int BTree<Comparable, NodeBytes>::height(){
+  int h = 0;
+  for(BNode *t = root; t != NULL && !t->leaf; t = t->child[0])
+    h++;
+  return h;
+}
+
+template <typename Comparable, int NodeBytes>
+long long BTree<Comparable, NodeBytes>::int_path_length(){
+  return int_path_length(root, 0);
+}
+
+template <typename Comparable, int NodeBytes>
+int BTree<Comparable, NodeBytes>::size(){
+  return size_t;
+}
+
+template <typename Comparable, int NodeBytes>
+float BTree<Comparable, NodeBytes>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+#ifdef EAVL_STATS
+template <typename Comparable, int NodeBytes>
+const AvlStats & BTree<Comparable, NodeBytes>::stats() const{
+  return counters;
+}
+#endif
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::display(ostream& os){
+  if(is_empty())
+    os << "Empty tree" << endl;
+  else
+    print_tree(root, os);
+}
+
+template <typename Comparable, int NodeBytes>
+int BTree<Comparable, NodeBytes>::find(const Comparable &x, int &freq){
+  finds++;
+  EAVL_STAT(counters.finds++);
+  int visited = 0;
+  BNode *t = root;
+  while(t != NULL){
+    int i = position(t, x);
+    if(i < t->n && t->keys[i] == x){
+      freq = t->freq[i];
+      break;
+    }
+    t = t->leaf ? NULL : t->child[i];
+    visited++;
+  }
+  nodes_visited += visited;
+  EAVL_STAT(counters.find_visits += visited);
+  return visited;
+}
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::make_empty(){
+  make_empty(root);
+  root = NULL;
+  size_t = 0;
+}
+
+template <typename Comparable, int NodeBytes>
+int BTree<Comparable, NodeBytes>::insert(const Comparable &x){
+  EAVL_STAT(counters.inserts++);
+  if(root == NULL)
+    root = new BNode(true);
+  else if(root->n == MAX_KEYS){
+    BNode *s = new BNode(false);
+    s->child[0] = root;
+    root = s;
+    split_child(s, 0);
+  }
+  BNode *t = root;
+  while(true){
+    EAVL_STAT(counters.insert_visits++);
+    int i = position(t, x);
+    if(i < t->n && t->keys[i] == x)
+      return ++t->freq[i];
+    if(t->leaf){
+      for(int j = t->n; j > i; j--){
+	t->keys[j] = std::move(t->keys[j - 1]);
+	t->freq[j] = t->freq[j - 1];
+      }
+      t->keys[i] = x;
+      t->freq[i] = 1;
+      t->n++;
+      size_t++;
+      return 1;
+    }
+    if(t->child[i]->n == MAX_KEYS){
+      split_child(t, i);
+      if(t->keys[i] == x)
+	return ++t->freq[i];
+      if(t->keys[i] < x)
+	i++;
+    }
+    t = t->child[i];
+  }
+}
+
+template <typename Comparable, int NodeBytes>
+int BTree<Comparable, NodeBytes>::remove(const Comparable &x){
+  EAVL_STAT(counters.removes++);
+  BNode *t = root;
+  while(t != NULL){
+    EAVL_STAT(counters.remove_visits++);
+    int i = position(t, x);
+    if(i < t->n && t->keys[i] == x){
+      if(t->freq[i] > 1)
+	return --t->freq[i];
+      break;
+    }
+    t = t->leaf ? NULL : t->child[i];
+  }
+  if(t == NULL)
+    return -1;    // Item not found; do nothing
+  remove_key(root, x);
+  if(root->n == 0){
+    BNode *old_root = root;
+    root = root->leaf ? NULL : root->child[0];
+    delete old_root;
+  }
+  size_t--;
+  return 0;
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::split_child(BNode *p, int i){
+  EAVL_STAT(counters.height_changes++);
+  const int T = MIN_DEGREE;
+  BNode *y = p->child[i];
+  BNode *z = new BNode(y->leaf);
+  z->n = T - 1;
+  for(int j = 0; j < T - 1; j++){
+    z->keys[j] = std::move(y->keys[j + T]);
+    z->freq[j] = y->freq[j + T];
+  }
+  if(!y->leaf)
+    for(int j = 0; j < T; j++)
+      z->child[j] = y->child[j + T];
+  y->n = T - 1;
+  for(int j = p->n; j > i; j--){
+    p->keys[j] = std::move(p->keys[j - 1]);
+    p->freq[j] = p->freq[j - 1];
+    p->child[j + 1] = p->child[j];
+  }
+  p->keys[i] = std::move(y->keys[T - 1]);
+  p->freq[i] = y->freq[T - 1];
+  p->child[i + 1] = z;
+  p->n++;
+}
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::merge_children(BNode *p, int i){
+  EAVL_STAT(counters.height_changes++);
+  BNode *l = p->child[i];
+  BNode *r = p->child[i + 1];
+  l->keys[l->n] = std::move(p->keys[i]);
+  l->freq[l->n] = p->freq[i];
+  for(int j = 0; j < r->n; j++){
+    l->keys[l->n + 1 + j] = std::move(r->keys[j]);
+    l->freq[l->n + 1 + j] = r->freq[j];
+  }
+  if(!l->leaf)
+    for(int j = 0; j <= r->n; j++)
+      l->child[l->n + 1 + j] = r->child[j];
+  l->n += r->n + 1;
+  for(int j = i; j < p->n - 1; j++){
+    p->keys[j] = std::move(p->keys[j + 1]);
+    p->freq[j] = p->freq[j + 1];
+    p->child[j + 1] = p->child[j + 2];
+  }
+  p->n--;
+  delete r;
+}
+
+template <typename Comparable, int NodeBytes>
+int BTree<Comparable, NodeBytes>::fill_child(BNode *p, int i){
+  BNode *c = p->child[i];
+  if(i > 0 && p->child[i - 1]->n >= MIN_DEGREE){
+    // Borrow through the parent from the left sibling.
+    EAVL_STAT(counters.single_left++);
+    BNode *s = p->child[i - 1];
+    for(int j = c->n; j > 0; j--){
+      c->keys[j] = std::move(c->keys[j - 1]);
+      c->freq[j] = c->freq[j - 1];
+    }
+    if(!c->leaf)
+      for(int j = c->n + 1; j > 0; j--)
+	c->child[j] = c->child[j - 1];
+    c->keys[0] = std::move(p->keys[i - 1]);
+    c->freq[0] = p->freq[i - 1];
+    if(!c->leaf)
+      c->child[0] = s->child[s->n];
+    p->keys[i - 1] = std::move(s->keys[s->n - 1]);
+    p->freq[i - 1] = s->freq[s->n - 1];
+    s->n--;
+    c->n++;
+    return i;
+  }
+  if(i < p->n && p->child[i + 1]->n >= MIN_DEGREE){
+    // Borrow through the parent from the right sibling.
+    EAVL_STAT(counters.single_right++);
+    BNode *s = p->child[i + 1];
+    c->keys[c->n] = std::move(p->keys[i]);
+    c->freq[c->n] = p->freq[i];
+    if(!c->leaf)
+      c->child[c->n + 1] = s->child[0];
+    p->keys[i] = std::move(s->keys[0]);
+    p->freq[i] = s->freq[0];
+    for(int j = 0; j < s->n - 1; j++){
+      s->keys[j] = std::move(s->keys[j + 1]);
+      s->freq[j] = s->freq[j + 1];
+    }
+    if(!s->leaf)
+      for(int j = 0; j < s->n; j++)
+	s->child[j] = s->child[j + 1];
+    s->n--;
+    c->n++;
+    return i;
+  }
+  if(i < p->n){
+    merge_children(p, i);
+    return i;
+  }
+  merge_children(p, i - 1);
+  return i - 1;
+}
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::remove_key(BNode *t, Comparable x){
+  const int T = MIN_DEGREE;
+  while(true){
+    int i = position(t, x);
+    if(i < t->n && t->keys[i] == x){
+      if(t->leaf){
+	for(int j = i; j < t->n - 1; j++){
+	  t->keys[j] = std::move(t->keys[j + 1]);
+	  t->freq[j] = t->freq[j + 1];
+	}
+	t->n--;
+	return;
+      }
+      if(t->child[i]->n >= T){
+	// Replace x by its predecessor, then remove that from the left subtree.
+	BNode *p = t->child[i];
+	while(!p->leaf)
+	  p = p->child[p->n];
+	t->keys[i] = p->keys[p->n - 1];
+	t->freq[i] = p->freq[p->n - 1];
+	x = t->keys[i];
+	t = t->child[i];
+      } else if(t->child[i + 1]->n >= T){
+	// Likewise with the successor and the right subtree.
+	BNode *s = t->child[i + 1];
+	while(!s->leaf)
+	  s = s->child[0];
+	t->keys[i] = s->keys[0];
+	t->freq[i] = s->freq[0];
+	x = t->keys[i];
+	t = t->child[i + 1];
+      } else {
+	merge_children(t, i);
+	t = t->child[i];
+      }
+    } else {
+      if(t->leaf)
+	return;
+      if(t->child[i]->n < T)
+	i = fill_child(t, i);
+      t = t->child[i];
+    }
+  }
+}
+
+template <typename Comparable, int NodeBytes>
+long long BTree<Comparable, NodeBytes>::int_path_length(BNode *t, int depth){
+  if(t == NULL)
+    return 0;
+  long long total = (long long)depth * t->n;
+  if(!t->leaf)
+    for(int i = 0; i <= t->n; i++)
+      total += int_path_length(t->child[i], depth + 1);
+  return total;
+}
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::print_tree(BNode *t, ostream& os) const{
+  for(int i = 0; i < t->n; i++){
+    if(!t->leaf)
+      print_tree(t->child[i], os);
+    os << t->keys[i] << endl;
+  }
+  if(!t->leaf)
+    print_tree(t->child[t->n], os);
+}
+
+template <typename Comparable, int NodeBytes>
+void BTree<Comparable, NodeBytes>::make_empty(BNode *t){
+  if(t != NULL){
+    if(!t->leaf)
+      for(int i = 0; i <= t->n; i++)
+	make_empty(t->child[i]);
+    delete t;
+  }
+}
@@ -0,0 +1,171 @@
+//=============================================================
+// Name:  BTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through btree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for a B-tree (Cormen et al., keys in every
+// node) with the enhanced AVL Tree API and frequency counting. A node's key
+// array is sized to about NodeBytes (4 cache lines by default), so one
+// cache miss brings in several keys to compare instead of one.
+// Functions are implemented in btree.cpp.
+//
+//============================================================
+
+#ifndef B_TREE_H_INCLUDED
+#define B_TREE_H_INCLUDED
+
+#include <iostream>
+#include <utility>
+#include "eavlstats.h"
+
+using namespace std;
+
+// BTree class
+//
+// CONSTRUCTION: zero parameter
+// NodeBytes:     target size of a node's key array; the minimum degree is
+//                chosen so that a full node's keys take about that much
+//
+// ******************PUBLIC OPERATIONS*********************
+// int insert( x )        --> Insert x, returns its frequency
+// int remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )    --> Returns nodes visited, sets freq
+// bool contains( x )     --> Return true if x is present
+// void report( )         --> Print size, height, path length, average visits
+// void display( os )     --> Print tree in sorted order
+// void make_empty( )     --> Remove all items
+//
+// report() counts nodes, not keys: height is the number of levels below the
+// root, the internal path length sums the depth of every key's node, and a
+// find visits the nodes it searches before the one holding the key.
+// With EAVL_STATS, moving a key through the parent from a left (right)
+// sibling counts as a single left (right) rotation, and height_changes
+// counts node splits and merges.
+
+template <typename Comparable, int NodeBytes = 256>
+class BTree
+{
+ public:
+  // Minimum degree: every node but the root holds MIN_DEGREE - 1 to
+  // MAX_KEYS keys.
+  static const int MIN_DEGREE = (int)(NodeBytes / sizeof(Comparable) + 1) / 2 < 2 ? 2 : (int)(NodeBytes / sizeof(Comparable) + 1) / 2;
+  static const int MAX_KEYS = 2 * MIN_DEGREE - 1;
+
+ BTree( ):root(NULL),size_t(0),finds(0),nodes_visited(0){}
+
+  ~BTree( ){
+    make_empty();
+  }
+
+  bool contains( const Comparable & x ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+#ifdef EAVL_STATS
+  const AvlStats & stats() const;
+#endif
+
+  /**
+   * Displays the tree in order from lowest to highest.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if found.
+   */
+  int find(const Comparable &x, int &freq);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   * Full nodes are split on the way down, so no pass back up is needed.
+   */
+  int insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   * When the last copy goes, nodes on the way down are topped up (by
+   * borrowing from a sibling or merging) so the key can be taken out in a
+   * single pass.
+   */
+  int remove(const Comparable &x);
+
+ private:
+  struct BNode
+  {
+    int n;
+    bool leaf;
+    Comparable keys[MAX_KEYS];
+    int freq[MAX_KEYS];
+    BNode *child[MAX_KEYS + 1];
+
+  explicit BNode(bool is_leaf):n(0),leaf(is_leaf){}
+  };
+
+  BNode *root;
+  int size_t;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+#ifdef EAVL_STATS
+  AvlStats counters;
+#endif
+
+  /**
+   * Index of the first key in t that is not less than x.
+   */
+  static int position(const BNode *t, const Comparable &x){
+    int i = 0;
+    while(i < t->n && t->keys[i] < x)
+      i++;
+    return i;
+  }
+
+  /**
+   * Splits p's full child i around its middle key, which moves up into p.
+   */
+  void split_child(BNode *p, int i);
+
+  /**
+   * Merges p's children i and i + 1 around key i of p.
+   */
+  void merge_children(BNode *p, int i);
+
+  /**
+   * Makes sure p's child i has at least MIN_DEGREE keys, borrowing from a
+   * sibling or merging with one. Returns the index of the child to descend
+   * into, which is i - 1 after a merge with the left sibling.
+   */
+  int fill_child(BNode *p, int i);
+
+  /**
+   * Removes x, which must be in subtree t, with t holding at least
+   * MIN_DEGREE keys unless it is the root.
+   */
+  void remove_key(BNode *t, Comparable x);
+
+  long long int_path_length(BNode *t, int depth);
+
+  void print_tree(BNode *t, ostream& os) const;
+
+  void make_empty(BNode *t);
+
+  BTree( const BTree & );
+  BTree & operator=( const BTree & );
+};
+#endif
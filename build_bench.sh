@@ -0,0 +1,43 @@
+#! /bin/bash
+# Times the driver's builds (make eavl.out, release, lto, pgo) on two random
+# command files: a skewed mix like the PGO training commands but from
+# another seed, and a uniform one the profile has not seen. Each build runs
+# each file five times; the best time is reported with its speedup over
+# the unoptimized eavl.out.
+# Usage: ./build_bench.sh [commands per file]
+
+commands=${1:-1000000}
+work=$(mktemp -d)
+trap 'rm -rf $work' EXIT
+
+make -s eavl.out eavl_release.out eavl_lto.out eavl_pgo.out || exit 1
+
+awk -v n=$commands 'BEGIN { srand(335); for (i = 0; i < n; i++) {
+       r = rand(); w = "w" int(rand() * rand() * 100000);
+       if (r < 0.4) print "insert " w; else if (r < 0.55) print "remove " w; else print "find " w }
+     print "report" }' > $work/skewed
+awk -v n=$commands 'BEGIN { srand(336); for (i = 0; i < n; i++) {
+       r = rand(); w = "u" int(rand() * 200000);
+       if (r < 0.3) print "insert " w; else if (r < 0.4) print "remove " w; else print "find " w }
+     print "report" }' > $work/uniform
+
+# Best of five wall clock seconds for $1 on file $2
+best() {
+    for run in 1 2 3 4 5; do
+	start=$(date +%s.%N)
+	./$1 $2 > /dev/null 2>&1
+	echo $start $(date +%s.%N)
+    done | awk '{ s = $2 - $1; if (NR == 1 || s < best) best = s } END { print best }'
+}
+
+for input in skewed uniform; do
+    echo "$input: $commands commands"
+    printf "  %-18s %10s %12s %9s\n" build seconds "commands/s" speedup
+    base=""
+    for build in eavl.out eavl_release.out eavl_lto.out eavl_pgo.out; do
+	secs=$(best $build $work/$input)
+	[ -z "$base" ] && base=$secs
+	awk -v b=$build -v s=$secs -v n=$commands -v base=$base \
+	    'BEGIN { printf "  %-18s %10.3f %12.0f %8.2fx\n", b, s, n / s, base / s }'
+    done
+done
@@ -0,0 +1,641 @@
+//=============================================================
+// Name:  CAVLTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "cavltree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the concurrent enhanced AVL Tree.
+// Locks are always taken top down (parent before child), so updates
+// cannot deadlock. A rotation marks every node that moves down as
+// shrinking while it relinks them and bumps their versions afterwards.
+// Unlinked nodes are freed by epoch based reclamation (Fraser, "Practical
+// lock-freedom", 2004).
+//
+//============================================================
+
+#include "cavltree.h"
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable, typename Freq>
+bool ConcurrentAvlTree<Comparable, Freq>::contains( const Comparable & x )
+{
+  Freq freq = 0;
+  find(x, freq);
+  return freq > 0;
+}
+
+template <typename Comparable, typename Freq>
+bool ConcurrentAvlTree<Comparable, Freq>::is_empty( ) const
+{
+  return live.load() == 0;
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+}
+
+template <typename Comparable, typename Freq>
+int ConcurrentAvlTree<Comparable, Freq>::height(){
+  // stored heights count a leaf as 1; AvlTree counts it as 0
+  CNode *root = holder.right.load();
+  return root == NULL ? 0 : root->height.load() - 1;
+}
+
+template <typename Comparable, typename Freq>
+long long ConcurrentAvlTree<Comparable, Freq>::int_path_length(){
+  return int_path_length(holder.right.load(), 0);
+}
+
+template <typename Comparable, typename Freq>
+int ConcurrentAvlTree<Comparable, Freq>::size(){
+  return live.load();
+}
+
+template <typename Comparable, typename Freq>
+float ConcurrentAvlTree<Comparable, Freq>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::display(ostream& os){
+  if(is_empty())
+    os << "Empty tree" << endl;
+  else
+    print_tree(holder.right.load(), os);
+}
+
+template <typename Comparable, typename Freq>
+int ConcurrentAvlTree<Comparable, Freq>::find(const Comparable &x, Freq &freq){
+  int visited = 0;
+  Freq f;
+  EpochGuard announced(this);
+  do{
+    f = attempt_find(x, &holder, RIGHT, 0, visited);
+  }while(f == RETRY);
+  if(f > 0)
+    freq = f;
+  return visited;
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::count_finds(unsigned long long n, unsigned long long visited){
+  finds += n;
+  nodes_visited += visited;
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::make_empty(){
+  free_tree(holder.right.load());
+  holder.right = NULL;
+  for(unsigned int i = 0; i < retired.size(); i++)
+    delete retired[i].first;
+  retired.clear();
+  retired_count = 0;
+  live = 0;
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::insert(const Comparable &x){
+  Freq freq;
+  {
+    EpochGuard announced(this);
+    do{
+      freq = attempt_insert(x, &holder, RIGHT, 0);
+    }while(freq == RETRY);
+  }
+  if(retired_count.load(memory_order_relaxed) >= RECLAIM_BATCH)
+    reclaim();    // rebalancing may unlink routing nodes too
+  return freq;
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::remove(const Comparable &x){
+  Freq freq;
+  {
+    EpochGuard announced(this);
+    do{
+      freq = attempt_remove(x, &holder, RIGHT, 0);
+    }while(freq == RETRY);
+  }
+  if(retired_count.load(memory_order_relaxed) >= RECLAIM_BATCH)
+    reclaim();
+  return freq;
+}
+
+template <typename Comparable, typename Freq>
+bool ConcurrentAvlTree<Comparable, Freq>::check(ostream & err){
+  if(holder.left.load() != NULL || holder.version.load() != 0){
+    err << "root holder changed" << endl;
+    return false;
+  }
+  return check(holder.right.load(), &holder, NULL, NULL, err) >= 0;
+}
+
+template <typename Comparable, typename Freq>
+int ConcurrentAvlTree<Comparable, Freq>::unreclaimed() const{
+  return retired_count.load();
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::wait_until_not_changing(CNode *n){
+  version_type v = n->version.load();
+  if(v & SHRINKING){
+    for(int i = 0; i < SPIN_COUNT; i++)
+      if(n->version.load() != v)
+	return;
+    lock_guard<NodeLock> hold(n->lock);
+  }
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::attempt_find(const Comparable &x, CNode *node, int dir, version_type ovl, int &visited){
+  for(;;){
+    CNode *child = node->child(dir);
+    if(node->version.load() != ovl)
+      return RETRY;    // also ends the loop once node is unlinked
+    if(child == NULL)
+      return 0;
+    int next = compare(x, child->element);
+    if(next == 0)
+      return child->freq.load();
+    visited++;
+    version_type cv = child->version.load();
+    if(cv & SHRINKING)
+      wait_until_not_changing(child);
+    else if(!(cv & UNLINKED) && child == node->child(dir)){
+      // child was node's child while node was still at ovl
+      if(node->version.load() != ovl)
+	return RETRY;
+      Freq f = attempt_find(x, child, next, cv, visited);
+      if(f != RETRY)
+	return f;
+    }
+  }
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::attempt_insert(const Comparable &x, CNode *node, int dir, version_type ovl){
+  for(;;){
+    CNode *child = node->child(dir);
+    if(node->version.load() != ovl)
+      return RETRY;
+    Freq f = RETRY;
+    if(child == NULL)
+      f = attach(x, node, dir, ovl);
+    else{
+      int next = compare(x, child->element);
+      if(next == 0)
+	f = increment(child);
+      else{
+	version_type cv = child->version.load();
+	if(cv & SHRINKING)
+	  wait_until_not_changing(child);
+	else if(!(cv & UNLINKED) && child == node->child(dir)){
+	  if(node->version.load() != ovl)
+	    return RETRY;
+	  f = attempt_insert(x, child, next, cv);
+	}
+      }
+    }
+    if(f != RETRY)
+      return f;
+  }
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::attempt_remove(const Comparable &x, CNode *node, int dir, version_type ovl){
+  for(;;){
+    CNode *child = node->child(dir);
+    if(node->version.load() != ovl)
+      return RETRY;
+    if(child == NULL)
+      return -1;
+    Freq f = RETRY;
+    int next = compare(x, child->element);
+    if(next == 0)
+      f = decrement(node, child);
+    else{
+      version_type cv = child->version.load();
+      if(cv & SHRINKING)
+	wait_until_not_changing(child);
+      else if(!(cv & UNLINKED) && child == node->child(dir)){
+	if(node->version.load() != ovl)
+	  return RETRY;
+	f = attempt_remove(x, child, next, cv);
+      }
+    }
+    if(f != RETRY)
+      return f;
+  }
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::attach(const Comparable &x, CNode *node, int dir, version_type ovl){
+  {
+    lock_guard<NodeLock> hold(node->lock);
+    if(node->version.load() != ovl || node->child(dir) != NULL)
+      return RETRY;
+    node->set_child(dir, new CNode(x, 1, node));
+  }
+  live++;
+  fix_height_and_rebalance(node);
+  return 1;
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::increment(CNode *n){
+  lock_guard<NodeLock> hold(n->lock);
+  if(n->version.load() & UNLINKED)
+    return RETRY;
+  Freq f = n->freq.load() + 1;
+  n->freq = f;
+  if(f == 1)
+    live++;    // a routing node revived
+  return f;
+}
+
+template <typename Comparable, typename Freq>
+Freq ConcurrentAvlTree<Comparable, Freq>::decrement(CNode *parent, CNode *n){
+  {
+    lock_guard<NodeLock> hold(n->lock);
+    if(n->version.load() & UNLINKED)
+      return RETRY;
+    Freq f = n->freq.load();
+    if(f == 0)
+      return -1;
+    if(f > 1 || !can_unlink(n)){
+      // n stays linked; with two children it becomes a routing node
+      n->freq = f - 1;
+      if(f == 1)
+	live--;
+      return f - 1;
+    }
+  }
+  {
+    lock_guard<NodeLock> hold_parent(parent->lock);
+    if((parent->version.load() & UNLINKED) || n->parent.load() != parent)
+      return RETRY;
+    lock_guard<NodeLock> hold(n->lock);
+    Freq f = n->freq.load();
+    if((n->version.load() & UNLINKED) || f > 1 || !can_unlink(n))
+      return RETRY;    // changed since the first look; decide again
+    if(f == 0)
+      return -1;
+    n->freq = 0;
+    live--;
+    unlink(parent, n);
+  }
+  fix_height_and_rebalance(parent);
+  return 0;
+}
+
+template <typename Comparable, typename Freq>
+bool ConcurrentAvlTree<Comparable, Freq>::unlink(CNode *parent, CNode *n){
+  CNode *parent_left = parent->left.load();
+  if(parent_left != n && parent->right.load() != n)
+    return false;
+  CNode *left = n->left.load(), *right = n->right.load();
+  if(left != NULL && right != NULL)
+    return false;
+  CNode *splice = left != NULL ? left : right;
+  NodeGuard hold(splice);
+  if(parent_left == n)
+    parent->left = splice;
+  else
+    parent->right = splice;
+  if(splice != NULL)
+    splice->parent = parent;
+  n->version = UNLINKED;
+  retire(n);
+  return true;
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::retire(CNode *n){
+  lock_guard<mutex> hold(retired_lock);
+  retired.push_back(make_pair(n, epoch.load()));
+  retired_count++;
+}
+
+template <typename Comparable, typename Freq>
+typename ConcurrentAvlTree<Comparable, Freq>::EpochSlot *
+ConcurrentAvlTree<Comparable, Freq>::enter(){
+  int i = hash<thread::id>()(this_thread::get_id()) % EPOCH_SLOTS;
+  for(;;){
+    unsigned long e = epoch.load();
+    unsigned long free_slot = 0;
+    if(slots[i].value.compare_exchange_strong(free_slot, e << 1 | 1)){
+      // An advance that scanned this slot while it was free may have moved
+      // the epoch on; announce again until the epoch holds still.
+      unsigned long now;
+      while((now = epoch.load()) != e){
+	e = now;
+	slots[i].value.store(e << 1 | 1);
+      }
+      return &slots[i];
+    }
+    if(++i == EPOCH_SLOTS){
+      i = 0;
+      this_thread::yield();
+    }
+  }
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::reclaim(){
+  unique_lock<mutex> hold(retired_lock, try_to_lock);
+  if(!hold.owns_lock())
+    return;
+  // Operations run in the current epoch or the one before, so a node
+  // unlinked in epoch u is out of every operation's reach once the epoch
+  // reaches u + 2.
+  unsigned long e = epoch.load();
+  bool all_current = true;
+  for(int i = 0; i < EPOCH_SLOTS && all_current; i++){
+    unsigned long v = slots[i].value.load();
+    all_current = v == 0 || v >> 1 == e;
+  }
+  if(all_current && epoch.compare_exchange_strong(e, e + 1))
+    e++;
+  unsigned int kept = 0;
+  for(unsigned int i = 0; i < retired.size(); i++)
+    if(retired[i].second + 2 <= e)
+      delete retired[i].first;
+    else
+      retired[kept++] = retired[i];
+  retired.resize(kept);
+  retired_count = kept;
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::fix_height_and_rebalance(CNode *node){
+  vector<CNode*> pending;    // walks to resume, from rotations that left work below
+  for(;;){
+    if(node == NULL || node->parent.load() == NULL || (node->version.load() & UNLINKED)){
+      // an unlinked node's height is its unlinker's to hand on
+      if(pending.empty())
+	return;
+      node = pending.back();
+      pending.pop_back();
+      continue;
+    }
+    int c = node_condition(node);
+    CNode *next = node;
+    if(c != UNLINK_REQUIRED && c != REBALANCE_REQUIRED){
+      // decided under the lock: a height fixed here unlocked could be
+      // overwritten by a fix_height that read the child before it changed
+      lock_guard<NodeLock> hold(node->lock);
+      if(!(node->version.load() & UNLINKED))
+	next = fix_height(node);
+    }else{
+      CNode *parent = node->parent.load();
+      lock_guard<NodeLock> hold_parent(parent->lock);
+      if(!(parent->version.load() & UNLINKED) && node->parent.load() == parent){
+	// an unlinked node keeps its old parent link, so check it again here
+	lock_guard<NodeLock> hold(node->lock);
+	if(!(node->version.load() & UNLINKED))
+	  next = rebalance(parent, node, pending);
+      }
+    }
+    node = next;
+  }
+}
+
+template <typename Comparable, typename Freq>
+int ConcurrentAvlTree<Comparable, Freq>::node_condition(CNode *n){
+  CNode *nL = n->left.load(), *nR = n->right.load();
+  if((nL == NULL || nR == NULL) && n->freq.load() == 0)
+    return UNLINK_REQUIRED;
+  int hN = n->height.load(), hL0 = height(nL), hR0 = height(nR);
+  int hNRepl = 1 + max(hL0, hR0);
+  int bal = hL0 - hR0;
+  if(bal < -1 || bal > 1)
+    return REBALANCE_REQUIRED;
+  return hN != hNRepl ? hNRepl : NOTHING_REQUIRED;
+}
+
+template <typename Comparable, typename Freq>
+typename ConcurrentAvlTree<Comparable, Freq>::CNode *
+ConcurrentAvlTree<Comparable, Freq>::fix_height(CNode *n){
+  int c = node_condition(n);
+  if(c == REBALANCE_REQUIRED || c == UNLINK_REQUIRED)
+    return n;
+  if(c == NOTHING_REQUIRED)
+    return NULL;
+  n->height = c;
+  return n->parent.load();
+}
+
+template <typename Comparable, typename Freq>
+typename ConcurrentAvlTree<Comparable, Freq>::CNode *
+ConcurrentAvlTree<Comparable, Freq>::rebalance(CNode *parent, CNode *n, vector<CNode*> & pending){
+  CNode *nL = n->left.load(), *nR = n->right.load();
+  if((nL == NULL || nR == NULL) && n->freq.load() == 0)
+    return unlink(parent, n) ? fix_height(parent) : n;
+  int hN = n->height.load(), hL0 = height(nL), hR0 = height(nR);
+  int hNRepl = 1 + max(hL0, hR0);
+  int bal = hL0 - hR0;
+  if(bal > 1)
+    return rebalance_toward(parent, n, nL, hR0, LEFT, pending);
+  if(bal < -1)
+    return rebalance_toward(parent, n, nR, hL0, RIGHT, pending);
+  if(hNRepl != hN){
+    n->height = hNRepl;
+    return fix_height(parent);
+  }
+  return NULL;
+}
+
+template <typename Comparable, typename Freq>
+typename ConcurrentAvlTree<Comparable, Freq>::CNode *
+ConcurrentAvlTree<Comparable, Freq>::rebalance_toward(CNode *parent, CNode *n, CNode *nS, int hO0, int dir, vector<CNode*> & pending){
+  lock_guard<NodeLock> hold(nS->lock);
+  int hS = nS->height.load();
+  if(hS - hO0 <= 1)
+    return n;    // nS shrank meanwhile; look at n again
+  CNode *nSO = nS->child(-dir);    // the inner grandchild
+  int hSS0 = height(nS->child(dir));
+  {
+    // nSO moves in either rotation, and its height must not change meanwhile
+    NodeGuard hold_inner(nSO);
+    int hSO = height(nSO);
+    if(hSS0 >= hSO)
+      return rotate(parent, n, nS, hO0, hSS0, nSO, hSO, dir, pending);
+    // A double rotation can leave nS a routing node with one child; it
+    // comes back from rotate_double to be unlinked. (Bronson et al. rotate
+    // nS first instead, which stops short when nS itself is balanced.)
+    int b = hSS0 - height(nSO->child(dir));
+    if(b >= -1 && b <= 1)
+      return rotate_double(parent, n, nS, hO0, hSS0, nSO, dir, pending);
+  }
+  // only when heights are stale: rotate nS first, then look at n again
+  pending.push_back(n);
+  return rebalance_toward(n, nS, nSO, hSS0, -dir, pending);
+}
+
+template <typename Comparable, typename Freq>
+typename ConcurrentAvlTree<Comparable, Freq>::CNode *
+ConcurrentAvlTree<Comparable, Freq>::rotate(CNode *parent, CNode *n, CNode *nS, int hO, int hSS, CNode *nSO, int hSO, int dir, vector<CNode*> & pending){
+  version_type ovl = n->version.load();
+  CNode *parent_left = parent->left.load();
+  n->version = ovl | SHRINKING;
+  n->set_child(dir, nSO);
+  if(nSO != NULL)
+    nSO->parent = n;
+  nS->set_child(-dir, n);
+  n->parent = nS;
+  if(parent_left == n)
+    parent->left = nS;
+  else
+    parent->right = nS;
+  nS->parent = parent;
+  int hNRepl = 1 + max(hSO, hO);
+  n->height = hNRepl;
+  nS->height = 1 + max(hSS, hNRepl);
+  n->version = ovl + SHRINK_COUNT;
+
+  // parent's height changes now; if a node below still needs work, it is
+  // done first and the walk up from parent afterwards
+  CNode *up = fix_height(parent);
+  CNode *more = NULL;
+  int balN = hSO - hO;
+  int balS = hSS - hNRepl;
+  if(balN < -1 || balN > 1 || ((nSO == NULL || hO == 0) && n->freq.load() == 0))
+    more = n;
+  else if(balS < -1 || balS > 1 || (hSS == 0 && nS->freq.load() == 0))
+    more = nS;
+  if(more == NULL)
+    return up;
+  if(up != NULL)
+    pending.push_back(up);
+  return more;
+}
+
+template <typename Comparable, typename Freq>
+typename ConcurrentAvlTree<Comparable, Freq>::CNode *
+ConcurrentAvlTree<Comparable, Freq>::rotate_double(CNode *parent, CNode *n, CNode *nS, int hO, int hSS, CNode *nSO, int dir, vector<CNode*> & pending){
+  version_type novl = n->version.load(), sovl = nS->version.load();
+  CNode *parent_left = parent->left.load();
+  CNode *nSOS = nSO->child(dir), *nSOO = nSO->child(-dir);
+  NodeGuard hold_inner(nSOS), hold_outer(nSOO);
+  int hSOS = height(nSOS), hSOO = height(nSOO);
+  n->version = novl | SHRINKING;
+  nS->version = sovl | SHRINKING;
+  n->set_child(dir, nSOO);
+  if(nSOO != NULL)
+    nSOO->parent = n;
+  nS->set_child(-dir, nSOS);
+  if(nSOS != NULL)
+    nSOS->parent = nS;
+  nSO->set_child(dir, nS);
+  nS->parent = nSO;
+  nSO->set_child(-dir, n);
+  n->parent = nSO;
+  if(parent_left == n)
+    parent->left = nSO;
+  else
+    parent->right = nSO;
+  nSO->parent = parent;
+  int hNRepl = 1 + max(hSOO, hO);
+  n->height = hNRepl;
+  int hSRepl = 1 + max(hSS, hSOS);
+  nS->height = hSRepl;
+  nSO->height = 1 + max(hSRepl, hNRepl);
+  n->version = novl + SHRINK_COUNT;
+  nS->version = sovl + SHRINK_COUNT;
+
+  CNode *up = fix_height(parent);
+  CNode *more = NULL;
+  int balN = hSOO - hO;
+  int balS = hSS - hSOS;    // nSOS may have changed since the caller looked
+  int balSO = hSRepl - hNRepl;
+  if(balN < -1 || balN > 1 || ((nSOO == NULL || hO == 0) && n->freq.load() == 0))
+    more = n;
+  else if(balS < -1 || balS > 1 || ((hSS == 0 || hSOS == 0) && nS->freq.load() == 0))
+    more = nS;
+  else if(balSO < -1 || balSO > 1)
+    more = nSO;
+  if(more == NULL)
+    return up;
+  if(up != NULL)
+    pending.push_back(up);
+  return more;
+}
+
+template <typename Comparable, typename Freq>
+long long ConcurrentAvlTree<Comparable, Freq>::int_path_length(CNode *t, int val){
+  if(t == NULL)
+    return 0;
+  return val + int_path_length(t->left.load(), val + 1) + int_path_length(t->right.load(), val + 1);
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::print_tree(CNode *t, ostream& os) const{
+  if(t != NULL){
+    print_tree(t->left.load(), os);
+    if(t->freq.load() > 0)
+      os << t->element << endl;
+    print_tree(t->right.load(), os);
+  }
+}
+
+template <typename Comparable, typename Freq>
+void ConcurrentAvlTree<Comparable, Freq>::free_tree(CNode *t){
+  if(t != NULL){
+    free_tree(t->left.load());
+    free_tree(t->right.load());
+    delete t;
+  }
+}
+
+template <typename Comparable, typename Freq>
+int ConcurrentAvlTree<Comparable, Freq>::check(CNode *t, CNode *parent, const Comparable *lo, const Comparable *hi, ostream & err){
+  if(t == NULL)
+    return 0;
+  if(t->parent.load() != parent){
+    err << "bad parent link at " << t->element << endl;
+    return -1;
+  }
+  if((lo != NULL && !(*lo < t->element)) || (hi != NULL && !(t->element < *hi))){
+    err << t->element << " out of order" << endl;
+    return -1;
+  }
+  if(t->version.load() & (UNLINKED | SHRINKING)){
+    err << "linked node " << t->element << " marked unlinked or shrinking" << endl;
+    return -1;
+  }
+  int hL = check(t->left.load(), t, lo, &t->element, err);
+  if(hL < 0)
+    return -1;
+  int hR = check(t->right.load(), t, &t->element, hi, err);
+  if(hR < 0)
+    return -1;
+  if(t->height.load() != 1 + max(hL, hR)){
+    err << "stored height " << t->height.load() << " of " << t->element << " should be " << 1 + max(hL, hR) << endl;
+    return -1;
+  }
+  if(hL - hR > 1 || hR - hL > 1){
+    err << t->element << " out of balance (" << hL << " / " << hR << ")" << endl;
+    return -1;
+  }
+  if(t->freq.load() == 0 && (hL == 0 || hR == 0)){
+    err << "routing node " << t->element << " left with one child" << endl;
+    return -1;
+  }
+  return 1 + max(hL, hR);
+}
@@ -0,0 +1,390 @@
+//=============================================================
+// Name:  CAVLTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through cavltree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for a concurrent enhanced AVL Tree after Bronson,
+// Casper, Chafi and Olukotun, "A Practical Concurrent Binary Search Tree"
+// (PPoPP 2010). Searches take no locks: they validate each step against
+// version numbers and retry from the last valid node if a rotation moved
+// the node they stand on. Updates lock only the nodes they change, so
+// inserts, removes and finds on different parts of the tree run in
+// parallel. Balance is relaxed: heights are repaired bottom up after each
+// update, one locked node at a time, and only where they changed.
+// Functions are implemented in cavltree.cpp.
+//
+//============================================================
+
+#ifndef CAVL_TREE_H_INCLUDED
+#define CAVL_TREE_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// ConcurrentAvlTree class
+//
+// CONSTRUCTION: zero parameter; not copyable. Comparable must be default
+//               constructible (the root holder node carries a blank key).
+//
+// ******************PUBLIC OPERATIONS*********************
+// Freq insert( x )        --> Insert x, returns its frequency
+// Freq remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )     --> Returns nodes visited, sets freq
+// bool contains( x )      --> Return true if x is present
+// int size( )             --> Number of distinct keys present
+// The above may be called from any number of threads at once. The rest
+// need the tree quiescent (no operation running):
+// void report( )          --> Print size, height, path length, average visits
+// void display( os )      --> Print tree in sorted order
+// bool check( err )       --> Verify order, links, heights and balance
+// void make_empty( )      --> Remove all items
+// int unreclaimed( )      --> Unlinked nodes not yet freed
+//
+// Like AvlTree's lazy deletion, removing the last copy of a key whose node
+// has two children leaves it in place with frequency 0 (a routing node);
+// it is unlinked once rebalancing leaves it with one child. Unlinked nodes
+// may still be read by operations in flight, so they are freed by epochs:
+// every operation announces the epoch it started in, an unlinked node is
+// tagged with the epoch it was unlinked in, and once the epoch has moved
+// on twice no operation that could have seen it is left. Memory stays
+// bounded under churn as long as no operation stalls; one that never
+// finishes holds back every node unlinked after it started.
+
+template <typename Comparable, typename Freq = int>
+class ConcurrentAvlTree
+{
+  static_assert(is_integral<Freq>::value && is_signed<Freq>::value, "Freq must be a signed integer type");
+
+ public:
+ ConcurrentAvlTree( ):holder(Comparable(), 0, NULL),live(0),epoch(1),retired_count(0),finds(0),nodes_visited(0){}
+
+  ~ConcurrentAvlTree( ){
+    make_empty();
+  }
+
+  bool contains( const Comparable & x );
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+  /**
+   * Displays the tree in order from lowest to highest.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if
+   * found. Takes no locks and writes nothing shared, so finds are not
+   * counted here: hand the totals to count_finds() to have them reported.
+   */
+  int find(const Comparable &x, Freq &freq);
+
+  /**
+   * Adds n finds that visited visited nodes in all to the find statistics.
+   */
+  void count_finds(unsigned long long n, unsigned long long visited);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   * Locks the node that changes, then repairs heights above it.
+   */
+  Freq insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   */
+  Freq remove(const Comparable &x);
+
+  /**
+   * Checks a quiescent tree: keys in order, parent links, stored heights,
+   * every node within one of balanced and no routing node left with fewer
+   * than two children. Describes the first problem on err.
+   */
+  bool check(ostream & err);
+
+  /**
+   * Unlinked nodes waiting for the operations that may still read them.
+   */
+  int unreclaimed() const;
+
+  // Unlinked nodes gathered before an operation tries to free some
+  static const int RECLAIM_BATCH = 256;
+
+ private:
+  // Version bits: a node's version changes whenever a rotation moves keys
+  // out of its subtree. Searches standing on it then retry.
+  typedef unsigned long version_type;
+  static const version_type UNLINKED = 1;
+  static const version_type SHRINKING = 2;
+  static const version_type SHRINK_COUNT = 4;
+
+  // Returned by the attempt_ functions when the search must back up.
+  static constexpr Freq RETRY = numeric_limits<Freq>::min();
+
+  // node_condition results; other results are the height to store
+  static const int NOTHING_REQUIRED = -1;
+  static const int REBALANCE_REQUIRED = -2;
+  static const int UNLINK_REQUIRED = -3;
+
+  // Spins this many times on a shrinking node before blocking on its lock
+  static const int SPIN_COUNT = 100;
+
+  // Directions, as compare() returns them
+  static const int LEFT = -1;
+  static const int RIGHT = 1;
+
+  // Announcement slots: at most this many operations run at once, the
+  // rest wait for a free slot.
+  static const int EPOCH_SLOTS = 64;
+
+  /**
+   * Test-and-test-and-set lock; nodes are too many for a mutex each. Yields
+   * while held so a waiter never spins out a holder's time slice.
+   */
+  struct NodeLock
+  {
+  NodeLock( ):held(false){}
+
+    void lock(){
+      while(held.exchange(true, memory_order_acquire))
+	while(held.load(memory_order_relaxed))
+	  this_thread::yield();
+    }
+
+    void unlock(){
+      held.store(false, memory_order_release);
+    }
+
+    atomic<bool> held;
+  };
+
+  struct CNode
+  {
+    const Comparable element;
+    atomic<Freq> freq;      // 0: a routing node, x is not present
+    atomic<int> height;     // 1 for a leaf; may lag while rebalancing catches up
+    atomic<version_type> version;
+    atomic<CNode*> parent;
+    atomic<CNode*> left;
+    atomic<CNode*> right;
+    NodeLock lock;          // held to change any field, the parent link included
+
+  CNode(const Comparable &ele, Freq q, CNode *p)
+  :element(ele),freq(q),height(1),version(0),parent(p),left(NULL),right(NULL){}
+
+    CNode *child(int dir) const{
+      return dir < 0 ? left.load() : right.load();
+    }
+
+    void set_child(int dir, CNode *c){
+      if(dir < 0)
+	left = c;
+      else
+	right = c;
+    }
+  };
+
+  /**
+   * One announcement slot on its own cache line: 0 while free, otherwise
+   * the epoch its operation started in, shifted left, with the low bit set.
+   */
+  struct alignas(64) EpochSlot
+  {
+  EpochSlot( ):value(0){}
+
+    atomic<unsigned long> value;
+  };
+
+  /**
+   * Announces an operation in tree's current epoch for its scope, so no
+   * node it may reach is freed under it.
+   */
+  struct EpochGuard
+  {
+  EpochGuard(ConcurrentAvlTree *tree):slot(tree->enter()){}
+
+    ~EpochGuard(){
+      slot->value.store(0, memory_order_release);
+    }
+
+    EpochSlot *slot;
+  };
+
+  /**
+   * Holds n's lock for its scope; n may be NULL.
+   */
+  struct NodeGuard
+  {
+  NodeGuard(CNode *m):n(m){
+      if(n != NULL)
+	n->lock.lock();
+    }
+
+    ~NodeGuard(){
+      if(n != NULL)
+	n->lock.unlock();
+    }
+
+    CNode *n;
+  };
+
+  // Sentinel above the root: the root is its right child. Its version never
+  // changes, so a search can always restart from it.
+  CNode holder;
+  atomic<int> live;
+  atomic<unsigned long> epoch;
+  EpochSlot slots[EPOCH_SLOTS];
+  mutex retired_lock;
+  vector<pair<CNode*, unsigned long> > retired;    // with the epoch each was unlinked in
+  atomic<int> retired_count;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+
+  ConcurrentAvlTree( const ConcurrentAvlTree & );
+  ConcurrentAvlTree & operator=( const ConcurrentAvlTree & );
+
+  static int compare(const Comparable &x, const Comparable &y){
+    return x < y ? LEFT : (y < x ? RIGHT : 0);
+  }
+
+  static int height(const CNode *t){
+    return t == NULL ? 0 : t->height.load();
+  }
+
+  static bool can_unlink(const CNode *n){
+    return n->left.load() == NULL || n->right.load() == NULL;
+  }
+
+  /**
+   * Waits out a rotation in progress at n: spins briefly, then takes n's
+   * lock, which the rotation holds.
+   */
+  static void wait_until_not_changing(CNode *n);
+
+  /**
+   * Searches for x below node, which the caller reached at version ovl,
+   * in direction dir. Returns x's frequency (0 if absent) or RETRY if
+   * node changed; visited counts the nodes compared.
+   */
+  Freq attempt_find(const Comparable &x, CNode *node, int dir, version_type ovl, int &visited);
+
+  Freq attempt_insert(const Comparable &x, CNode *node, int dir, version_type ovl);
+
+  Freq attempt_remove(const Comparable &x, CNode *node, int dir, version_type ovl);
+
+  /**
+   * Hangs a new leaf for x as node's dir child if it is still empty.
+   */
+  Freq attach(const Comparable &x, CNode *node, int dir, version_type ovl);
+
+  Freq increment(CNode *n);
+
+  /**
+   * Decrements n, a child of parent; unlinks it if that was its last copy
+   * and it has at most one child.
+   */
+  Freq decrement(CNode *parent, CNode *n);
+
+  /**
+   * Unlinks n, a routing node with at most one child, from parent. Both
+   * must be locked. Returns false if n is no longer parent's child.
+   */
+  bool unlink(CNode *parent, CNode *n);
+
+  /**
+   * Queues n, just unlinked, to be freed once no operation can reach it.
+   */
+  void retire(CNode *n);
+
+  /**
+   * Claims a free slot and announces the current epoch in it, checking
+   * the epoch did not move meanwhile.
+   */
+  EpochSlot *enter();
+
+  /**
+   * Moves the epoch on if every operation running announced the current
+   * one, then frees the nodes unlinked two or more epochs ago. Does
+   * nothing if another thread is already at it.
+   */
+  void reclaim();
+
+  /**
+   * Walks up from node repairing heights and rotating, one node (or
+   * parent and node) locked at a time, until nothing changes. Decisions
+   * are made under the locks, so a quiescent tree is strictly balanced.
+   */
+  void fix_height_and_rebalance(CNode *node);
+
+  /**
+   * What n needs: NOTHING_REQUIRED, REBALANCE_REQUIRED, UNLINK_REQUIRED,
+   * or else its correct height.
+   */
+  static int node_condition(CNode *n);
+
+  /**
+   * Stores n's height (n locked). Returns the next node to repair: n if it
+   * needs more than a height, its parent, or NULL.
+   */
+  CNode *fix_height(CNode *n);
+
+  /**
+   * Rebalances n (parent and n locked). Returns the next node to repair;
+   * a rotation that leaves work below it also pushes the walk up from its
+   * parent on pending, to be resumed afterwards.
+   */
+  CNode *rebalance(CNode *parent, CNode *n, vector<CNode*> & pending);
+
+  /**
+   * n is too tall on side dir, where nS is; rotates n the other way,
+   * single or double. hO0 is the height of n's other side.
+   */
+  CNode *rebalance_toward(CNode *parent, CNode *n, CNode *nS, int hO0, int dir, vector<CNode*> & pending);
+
+  /**
+   * Rotations: parent, n, nS and nSO locked. Every node whose parent link
+   * changes is locked while it does, so a height fixed under a node's lock
+   * is always handed on to its current parent.
+   */
+  CNode *rotate(CNode *parent, CNode *n, CNode *nS, int hO, int hSS, CNode *nSO, int hSO, int dir, vector<CNode*> & pending);
+
+  CNode *rotate_double(CNode *parent, CNode *n, CNode *nS, int hO, int hSS, CNode *nSO, int dir, vector<CNode*> & pending);
+
+  long long int_path_length(CNode *t, int val);
+
+  void print_tree(CNode *t, ostream& os) const;
+
+  void free_tree(CNode *t);
+
+  /**
+   * check() for subtree t under parent, keys strictly between lo and hi
+   * (NULL is unbounded). Returns t's height or -1 on a problem.
+   */
+  int check(CNode *t, CNode *parent, const Comparable *lo, const Comparable *hi, ostream & err);
+};
+#endif
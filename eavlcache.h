@@ -0,0 +1,145 @@
+//=============================================================
+// Name:  EAVLCACHE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavltree.h
+// Version: 1.0
+// Description: Small 2-way set associative cache of tree nodes keyed by key
+// hash, used by AvlTree to answer repeated finds of popular keys without
+// walking the tree.
+//
+//============================================================
+
+#ifndef EAVL_CACHE_H_INCLUDED
+#define EAVL_CACHE_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Fixed-size 2-way set associative cache mapping a key hash to a node.
+ * A set is 32 bytes and the array is aligned, so a lookup touches exactly
+ * one cache line. Only hashes are stored: the caller must check that the
+ * returned node really holds its key. Replacement within a set is LRU.
+ * A cache with 0 sets is disabled and every lookup misses.
+ */
+template <typename Node>
+class HotKeyCache
+{
+ public:
+ HotKeyCache( ):mask(0),lookups(0),hits(0){}
+
+  /**
+   * Size the cache to at least entries slots (rounded up to a power of two)
+   * and empty it. 0 disables the cache.
+   */
+  void resize(int entries){
+    int n = 0;
+    if(entries > 0){
+      n = 1;
+      while(n * 2 < entries)
+	n *= 2;
+    }
+    sets.assign(n, Set());
+    mask = n > 0 ? n - 1 : 0;
+    lookups = hits = 0;
+  }
+
+  bool enabled() const{
+    return !sets.empty();
+  }
+
+  int capacity() const{
+    return sets.size() * 2;
+  }
+
+  /**
+   * Returns the cached node for hash h, or NULL.
+   */
+  Node * lookup(size_t h){
+    lookups++;
+    Set & s = sets[h & mask];
+    uint32_t tag = tag_of(h);
+    for(int w = 0; w < 2; w++){
+      if(s.node[w] != NULL && s.tag[w] == tag){
+	s.lru = 1 - w;
+	return s.node[w];
+      }
+    }
+    return NULL;
+  }
+
+  /**
+   * Called by the owner when a looked-up node really matched.
+   */
+  void record_hit(){
+    hits++;
+  }
+
+  /**
+   * Caches n under hash h, replacing the least recently used way.
+   */
+  void store(size_t h, Node *n){
+    Set & s = sets[h & mask];
+    uint32_t tag = tag_of(h);
+    int w = s.lru;
+    if(s.node[0] != NULL && s.tag[0] == tag)
+      w = 0;
+    else if(s.node[1] != NULL && s.tag[1] == tag)
+      w = 1;
+    s.node[w] = n;
+    s.tag[w] = tag;
+    s.lru = 1 - w;
+  }
+
+  /**
+   * Drops the entry for node n, if cached under hash h.
+   */
+  void invalidate(size_t h, Node *n){
+    Set & s = sets[h & mask];
+    for(int w = 0; w < 2; w++)
+      if(s.node[w] == n)
+	s.node[w] = NULL;
+  }
+
+  /**
+   * Drops every entry but keeps the size.
+   */
+  void clear(){
+    sets.assign(sets.size(), Set());
+  }
+
+  /**
+   * Fraction of lookups that found their key, 0 if there were none.
+   */
+  float hit_rate() const{
+    return lookups > 0 ? (float)hits / lookups : 0;
+  }
+
+ private:
+  struct alignas(32) Set
+  {
+    Node *node[2];
+    uint32_t tag[2];
+    uint8_t lru;    // way to replace next
+
+  Set( ):lru(0){
+      node[0] = node[1] = NULL;
+      tag[0] = tag[1] = 0;
+    }
+  };
+
+  vector<Set> sets;
+  size_t mask;
+  unsigned long long lookups;
+  unsigned long long hits;
+
+  // The low bits pick the set, so the tag comes from the high bits.
+  static uint32_t tag_of(size_t h){
+    return (uint32_t)(h >> 32) ^ (uint32_t)h;
+  }
+};
+
+#endif
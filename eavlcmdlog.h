@@ -0,0 +1,229 @@
+//=============================================================
+// Name:  EAVLCMDLOG.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by main.cpp (POSIX only)
+// Version: 1.0
+// Description: Binary command logs, a compact form of the driver's text
+// command files for high-rate replay. A log is
+//   magic "EAVLCMD1" | flags (1 byte) | [dictionary] | commands...
+// Without a dictionary each insert, remove or find is an encoded command
+// (eavlcodec.h: opcode, varint key length, key). With one (flags bit
+// LOG_DICTIONARY) the header is followed by the number of distinct keys and
+// each key as a varint length and bytes, and a command is the opcode and
+// the key's index in the dictionary as a varint. Every other line the
+// driver does not ignore (display, report, bad lines...) is kept verbatim
+// as a RAW_LINE command. The reader maps the file and hands out keys as
+// string_views into it, so replay does no tokenizing; with a dictionary a
+// key reaches the tree by reference, never copied per command.
+//
+//============================================================
+
+#ifndef EAVL_CMDLOG_H_INCLUDED
+#define EAVL_CMDLOG_H_INCLUDED
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "eavlcodec.h"
+
+using namespace std;
+
+const char COMMAND_LOG_MAGIC[8] = { 'E', 'A', 'V', 'L', 'C', 'M', 'D', '1' };
+const unsigned char LOG_DICTIONARY = 1;
+
+// Opcode of a text line kept as is; its "key" is the whole line.
+const char RAW_LINE = 'x';
+
+/**
+ * True if the file at path starts with COMMAND_LOG_MAGIC.
+ */
+inline bool is_command_log(const string & path){
+  char head[sizeof(COMMAND_LOG_MAGIC)];
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    return false;
+  bool log = read(fd, head, sizeof(head)) == (ssize_t)sizeof(head)
+    && memcmp(head, COMMAND_LOG_MAGIC, sizeof(head)) == 0;
+  close(fd);
+  return log;
+}
+
+/**
+ * Converts the text commands read from in to a command log in out, with a
+ * key dictionary if dictionary is set. Lines are split on whitespace as
+ * simple_tokenizer splits them; blank lines and lines of three or more
+ * words, which the driver ignores, are dropped. Returns the number of
+ * commands written.
+ */
+inline long convert_commands(istream & in, string & out, bool dictionary){
+  string body, line;
+  unordered_map<string, uint64_t> ids;
+  vector<const string*> keys;   // by id, pointing into ids
+  long commands = 0;
+  while(getline(in, line)){
+    string_view words[3];
+    int n = 0;
+    size_t i = 0;
+    while(n < 3){
+      while(i < line.size() && isspace((unsigned char)line[i]))
+	i++;
+      if(i == line.size())
+	break;
+      size_t j = i;
+      while(j < line.size() && !isspace((unsigned char)line[j]))
+	j++;
+      words[n++] = string_view(line).substr(i, j - i);
+      i = j;
+    }
+    if(n == 0 || n == 3)
+      continue;
+    commands++;
+    if(n == 2 && (words[0] == "insert" || words[0] == "remove" || words[0] == "find")){
+      if(!dictionary){
+	encode_command(body, words[0][0], words[1]);
+	continue;
+      }
+      pair<unordered_map<string, uint64_t>::iterator, bool> slot = ids.emplace(string(words[1]), keys.size());
+      if(slot.second)
+	keys.push_back(&slot.first->first);
+      body += words[0][0];
+      put_varint(body, slot.first->second);
+    } else
+      encode_command(body, RAW_LINE, line);
+  }
+  out.assign(COMMAND_LOG_MAGIC, sizeof(COMMAND_LOG_MAGIC));
+  out += (char)(dictionary ? LOG_DICTIONARY : 0);
+  if(dictionary){
+    put_varint(out, keys.size());
+    for(unsigned int k = 0; k < keys.size(); k++){
+      put_varint(out, keys[k]->size());
+      out += *keys[k];
+    }
+  }
+  out += body;
+  return commands;
+}
+
+/**
+ * A command log mapped read-only into memory. Dictionary keys are loaded
+ * into strings once, so replay can hand them to the tree by reference.
+ */
+class CommandLog
+{
+ public:
+ CommandLog( ):base(NULL),length(0),pos(NULL),end(NULL),dictionary(false),bad(false){}
+
+  ~CommandLog( ){
+    if(base != NULL)
+      munmap((void *)base, length);
+  }
+
+  /**
+   * Maps the log at path and reads its header and dictionary. Returns
+   * false, explaining on err, if it cannot or the log is malformed.
+   */
+  bool open(const string & path, ostream & err){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0){
+      err << "ERROR: cannot open " << path << ": " << strerror(errno) << endl;
+      if(fd >= 0)
+	close(fd);
+      return false;
+    }
+    length = st.st_size;
+    void *p = length > 0 ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(p == MAP_FAILED){
+      err << "ERROR: cannot map " << path << endl;
+      return false;
+    }
+    madvise(p, length, MADV_SEQUENTIAL);
+    base = (const char *)p;
+    end = base + length;
+    pos = base + sizeof(COMMAND_LOG_MAGIC) + 1;
+    if(pos > end || memcmp(base, COMMAND_LOG_MAGIC, sizeof(COMMAND_LOG_MAGIC)) != 0){
+      err << "ERROR: " << path << " is not a command log" << endl;
+      return false;
+    }
+    if(base[sizeof(COMMAND_LOG_MAGIC)] & LOG_DICTIONARY){
+      uint64_t count, len;
+      if(get_varint(pos, end, count) != DECODED || count > (uint64_t)(end - pos)){
+	err << "ERROR: " << path << ": bad dictionary" << endl;
+	return false;
+      }
+      words.reserve(count);
+      for(uint64_t i = 0; i < count; i++){
+	if(get_varint(pos, end, len) != DECODED || (uint64_t)(end - pos) < len){
+	  err << "ERROR: " << path << ": bad dictionary" << endl;
+	  return false;
+	}
+	words.push_back(string(pos, len));
+	pos += len;
+      }
+      dictionary = true;
+    } else
+      dictionary = false;
+    return true;
+  }
+
+  /**
+   * Reads the next command: its opcode and either its key or, for
+   * RAW_LINE, the whole text line. key is valid while the log is open;
+   * word is the dictionary string key views, or NULL without a dictionary
+   * (and for RAW_LINE). Returns false at the end of the log, or at a
+   * truncated command or unknown key index (then with corrupt() true).
+   */
+  bool next(char & op, string_view & key, const string *& word){
+    if(pos >= end)
+      return false;
+    word = NULL;
+    if(!dictionary || *pos == RAW_LINE){
+      if(decode_command(pos, end, op, key, end - pos) != DECODED){
+	bad = true;
+	return false;
+      }
+      return true;
+    }
+    const char *q = pos + 1;
+    uint64_t id;
+    if(get_varint(q, end, id) != DECODED || id >= words.size()){
+      bad = true;
+      return false;
+    }
+    op = *pos;
+    word = &words[id];
+    key = *word;
+    pos = q;
+    return true;
+  }
+
+  bool corrupt() const{
+    return bad;
+  }
+
+ private:
+  const char *base;
+  size_t length;
+  const char *pos;
+  const char *end;
+  bool dictionary;
+  bool bad;
+  vector<string> words;
+
+  CommandLog(const CommandLog &);
+  CommandLog & operator=(const CommandLog &);
+};
+
+#endif
@@ -0,0 +1,112 @@
+//=============================================================
+// Name:  EAVLCODEC.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavlserve.h and the bench clients
+// Version: 1.0
+// Description: Binary encoding of driver commands and their results: a
+// command is an opcode byte ('i'nsert, 'r'emove, 'f'ind) followed by the
+// key length as a varint (7 bits a byte, low bits first) and the key bytes;
+// a result is the frequency and the nodes visited as two 32 bit integers in
+// host byte order (visits is 0 for insert and remove, the frequency -1 for
+// a remove of an absent key).
+//
+//============================================================
+
+#ifndef EAVL_CODEC_H_INCLUDED
+#define EAVL_CODEC_H_INCLUDED
+
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// First byte a client sends to switch its connection to binary commands.
+const unsigned char BINARY_HELLO = 0xEB;
+
+// Bytes in an encoded result.
+const int RESULT_BYTES = 8;
+
+// Longest key a server takes; a longer declared length closes the connection.
+const uint64_t MAX_KEY_BYTES = 1 << 20;
+
+// What get_varint and decode_command found at p.
+enum Decoded { DECODED, INCOMPLETE, MALFORMED };
+
+inline void put_varint(string & out, uint64_t v){
+  while(v >= 0x80){
+    out += (char)(v | 0x80);
+    v >>= 7;
+  }
+  out += (char)v;
+}
+
+/**
+ * Reads a varint at p, advancing p past it. Leaves p unchanged and returns
+ * INCOMPLETE if the varint does not end before end, or MALFORMED if it is
+ * longer than 10 bytes or does not fit in 64 bits; more input cannot mend
+ * that.
+ */
+inline Decoded get_varint(const char *& p, const char *end, uint64_t & v){
+  v = 0;
+  const char *q = p;
+  for(int shift = 0; shift < 70; shift += 7){
+    if(q == end)
+      return INCOMPLETE;
+    unsigned char b = *q++;
+    if(shift == 63 && (b & 0x7f) > 1)
+      return MALFORMED;
+    v |= (uint64_t)(b & 0x7f) << shift;
+    if(b < 0x80){
+      p = q;
+      return DECODED;
+    }
+  }
+  return MALFORMED;
+}
+
+inline void encode_command(string & out, char op, string_view key){
+  out += op;
+  put_varint(out, key.size());
+  out.append(key.data(), key.size());
+}
+
+/**
+ * Decodes the command at p, advancing p past it; key points into the
+ * input. Leaves p unchanged and returns INCOMPLETE if the command is not
+ * all there yet, or MALFORMED if its length is a bad varint or over
+ * max_key.
+ */
+inline Decoded decode_command(const char *& p, const char *end, char & op, string_view & key, uint64_t max_key){
+  const char *q = p;
+  uint64_t len;
+  if(q >= end)
+    return INCOMPLETE;
+  op = *q++;
+  Decoded d = get_varint(q, end, len);
+  if(d != DECODED)
+    return d;
+  if(len > max_key)
+    return MALFORMED;
+  if((uint64_t)(end - q) < len)
+    return INCOMPLETE;
+  key = string_view(q, len);
+  p = q + len;
+  return DECODED;
+}
+
+inline void encode_result(string & out, int32_t freq, int32_t visits){
+  char b[RESULT_BYTES];
+  memcpy(b, &freq, 4);
+  memcpy(b + 4, &visits, 4);
+  out.append(b, RESULT_BYTES);
+}
+
+inline void decode_result(const char *p, int32_t & freq, int32_t & visits){
+  memcpy(&freq, p, 4);
+  memcpy(&visits, p + 4, 4);
+}
+
+#endif
@@ -0,0 +1,34 @@
+//=============================================================
+// Name:  EAVLENGINE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "eavlengine.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Pulls in every tree engine and builds one by name.
+//
+//============================================================
+
+#include "eavlengine.h"
+#include "eavltree.cpp"
+#include "rbtree.cpp"
+#include "wavltree.cpp"
+#include "bfavltree.cpp"
+#include "btree.cpp"
+#include "bplustree.cpp"
+
+template <typename Comparable>
+TreeEngine<Comparable> * make_engine(const string &name){
+  if(name == "avl")
+    return new EngineAdapter<Comparable, AvlTree<Comparable> >("avl");
+  if(name == "rb")
+    return new EngineAdapter<Comparable, RbTree<Comparable> >("rb");
+  if(name == "wavl")
+    return new EngineAdapter<Comparable, WavlTree<Comparable> >("wavl");
+  if(name == "bf")
+    return new EngineAdapter<Comparable, BfAvlTree<Comparable> >("bf");
+  if(name == "btree")
+    return new EngineAdapter<Comparable, BTree<Comparable> >("btree");
+  if(name == "bplus")
+    return new EngineAdapter<Comparable, BPlusTree<Comparable> >("bplus");
+  return NULL;
+}
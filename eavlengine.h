@@ -0,0 +1,145 @@
+//=============================================================
+// Name:  EAVLENGINE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through eavlengine.cpp, which also brings in every engine
+// Version: 1.0
+// Description: Common interface for the balanced search trees the driver can
+// run commands against (AVL, red-black, WAVL, balance factor AVL, B-tree,
+// B+ tree). Every engine keeps the AvlTree frequency semantics and the same
+// report() metrics, so a command file can be replayed on each of them and
+// compared.
+//
+//============================================================
+
+#ifndef EAVL_ENGINE_H_INCLUDED
+#define EAVL_ENGINE_H_INCLUDED
+
+#include <iostream>
+#include <string>
+#include "eavlstats.h"
+
+using namespace std;
+
+/**
+ * The operations eavl_driver uses, with AvlTree's meaning:
+ * insert returns the key's new frequency, remove its remaining frequency
+ * (0 once the key is gone) or -1 if it was absent, and find returns the
+ * number of nodes visited and sets freq when the key is present.
+ */
+template <typename Comparable>
+class TreeEngine
+{
+ public:
+  virtual ~TreeEngine( ){}
+
+  /**
+   * Short name used by --engine (avl, rb, wavl, bf, btree, bplus).
+   */
+  virtual const char * name() const = 0;
+
+  virtual int insert(const Comparable &x) = 0;
+  virtual int remove(const Comparable &x) = 0;
+  virtual int find(const Comparable &x, int &freq) = 0;
+  virtual bool contains(const Comparable &x) const = 0;
+
+  /**
+   * Prints size, height, internal path length and average nodes visited,
+   * one "(attribute) = (number)" per line, plus anything engine specific.
+   */
+  virtual void report() = 0;
+  virtual void display(ostream& os) = 0;
+  virtual void make_empty() = 0;
+
+  virtual int size() = 0;
+  virtual int height() = 0;
+  virtual long long int_path_length() = 0;
+  virtual float avge_node_visits() = 0;
+
+#ifdef EAVL_STATS
+  virtual const AvlStats & stats() const = 0;
+#endif
+};
+
+/**
+ * Wraps a tree class with the AvlTree public API (AvlTree, RbTree,
+ * WavlTree, BfAvlTree, BTree, BPlusTree) as a TreeEngine. The tree is a member,
+ * reachable through tree() for engine specific options.
+ */
+template <typename Comparable, typename Tree>
+class EngineAdapter : public TreeEngine<Comparable>
+{
+ public:
+  explicit EngineAdapter(const char *engine_name):label(engine_name){}
+
+  Tree & tree(){
+    return t;
+  }
+
+  const char * name() const{
+    return label;
+  }
+
+  int insert(const Comparable &x){
+    return t.insert(x);
+  }
+
+  int remove(const Comparable &x){
+    return t.remove(x);
+  }
+
+  int find(const Comparable &x, int &freq){
+    return t.find(x, freq);
+  }
+
+  bool contains(const Comparable &x) const{
+    return t.contains(x);
+  }
+
+  void report(){
+    t.report();
+  }
+
+  void display(ostream& os){
+    t.display(os);
+  }
+
+  void make_empty(){
+    t.make_empty();
+  }
+
+  int size(){
+    return t.size();
+  }
+
+  int height(){
+    return t.height();
+  }
+
+  long long int_path_length(){
+    return t.int_path_length();
+  }
+
+  float avge_node_visits(){
+    return t.avge_node_visits();
+  }
+
+#ifdef EAVL_STATS
+  const AvlStats & stats() const{
+    return t.stats();
+  }
+#endif
+
+ private:
+  Tree t;
+  const char *label;
+};
+
+/**
+ * Returns a new, empty engine called name (avl, rb, wavl, bf, btree or
+ * bplus), or NULL if there is no such engine. Defined in eavlengine.cpp.
+ */
+template <typename Comparable>
+TreeEngine<Comparable> * make_engine(const string &name);
+
+#endif
@@ -0,0 +1,19 @@
+//=============================================================
+// Name:  EAVLINST.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: compiled to eavlinst.o by the makefile and linked into eavl.out
+// Version: 1.0
+// Description: The explicit instantiation of AvlTree<string>, the driver's
+// tree. main.cpp declares it extern, so the tree's member functions are
+// compiled here, apart from the driver: they can be built, optimized and
+// profiled on their own, and the makefile's LTO build can still inline them
+// across the two objects. Member templates (emplace, in_order) are still
+// instantiated where they are used.
+//
+//============================================================
+
+#include "eavltree.cpp"
+#include <string>
+
+template class AvlTree<string>;
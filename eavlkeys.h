@@ -0,0 +1,229 @@
+//=============================================================
+// Name:  EAVLKEYS.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavltree.h
+// Version: 1.0
+// Description: Key storage policies for the enhanced AVL Tree, the third
+// template argument of AvlTree. DirectKeys stores each Comparable in its
+// node. ArenaKeys (strings only) copies the key bytes into an append-only
+// arena owned by the tree and keeps a small view plus an 8 byte prefix in
+// the node.
+//
+//============================================================
+
+#ifndef EAVL_KEYS_H_INCLUDED
+#define EAVL_KEYS_H_INCLUDED
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * The heap buffer a key owns, if any, and its size in bytes (what
+ * MemoryAccount counts as key heap). A string owns one once it outgrows
+ * its inline buffer; other keys, arena keys included, own none.
+ */
+inline const void * key_heap_block(const string & k, size_t & bytes){
+  static const size_t inline_capacity = string().capacity();
+  if(k.capacity() <= inline_capacity)
+    return NULL;
+  bytes = k.capacity() + 1;
+  return k.data();
+}
+
+template <typename Key>
+const void * key_heap_block(const Key &, size_t &){
+  return NULL;
+}
+
+/**
+ * Default key storage: nodes hold a copy of the Comparable itself.
+ * probe() is the form a search key is compared in, make() the form a new
+ * node stores.
+ */
+template <typename Comparable>
+struct DirectKeys
+{
+  typedef Comparable key_type;
+
+  const Comparable & probe(const Comparable & x) const{
+    return x;
+  }
+
+  const Comparable & make(const Comparable & x){
+    return x;
+  }
+
+  Comparable && make(Comparable && x){
+    return std::move(x);
+  }
+
+  void clear(){
+  }
+
+  unsigned long long arena_bytes() const{
+    return 0;
+  }
+};
+
+/**
+ * Append-only storage for key bytes. Bytes are carved out of 64 KiB blocks
+ * (a longer key gets a block of its own) and never move, so views into the
+ * arena stay valid for the arena's lifetime. Nothing is freed before the
+ * arena itself.
+ */
+class StringArena
+{
+ public:
+  static const size_t BLOCK_SIZE = 64 * 1024;
+
+ StringArena( ):used(BLOCK_SIZE),total(0){}
+
+  /**
+   * Copies len bytes from s into the arena and returns where they now live.
+   */
+  const char * append(const char *s, size_t len){
+    total += len;
+    if(len > BLOCK_SIZE / 4){
+      // big keys get a block of their own so the current one keeps filling
+      large.push_back(unique_ptr<char[]>(new char[len]));
+      memcpy(large.back().get(), s, len);
+      return large.back().get();
+    }
+    if(len > BLOCK_SIZE - used){
+      blocks.push_back(unique_ptr<char[]>(new char[BLOCK_SIZE]));
+      used = 0;
+    }
+    char *p = blocks.back().get() + used;
+    memcpy(p, s, len);
+    used += len;
+    return p;
+  }
+
+  /**
+   * Bytes of key data stored so far.
+   */
+  unsigned long long bytes() const{
+    return total;
+  }
+
+ private:
+  vector<unique_ptr<char[]> > blocks;
+  vector<unique_ptr<char[]> > large;
+  size_t used;               // bytes used in blocks.back()
+  unsigned long long total;
+
+  StringArena(const StringArena &);
+  StringArena & operator=(const StringArena &);
+};
+
+/**
+ * A string key living in a StringArena (or, for search probes, in the
+ * caller's string). The first 8 bytes are cached big-endian in prefix so
+ * most comparisons never touch the key bytes. Ordering is the same
+ * unsigned byte-wise ordering std::string uses.
+ */
+struct ArenaString
+{
+  uint64_t prefix;
+  const char *data;
+  uint32_t len;
+
+ ArenaString( ):prefix(0),data(NULL),len(0){}
+
+ ArenaString(const char *s, size_t n):prefix(0),data(s),len((uint32_t)n)
+    {
+      for(size_t i = 0; i < 8; i++)
+	prefix = (prefix << 8) | (i < n ? (unsigned char)s[i] : 0);
+    }
+
+  string_view view() const{
+    return string_view(data, len);
+  }
+
+  int compare(const ArenaString & rhs) const{
+    if(prefix != rhs.prefix)
+      return prefix < rhs.prefix ? -1 : 1;
+    if(len <= 8 && rhs.len <= 8)
+      return len < rhs.len ? -1 : (len > rhs.len ? 1 : 0);
+    return view().compare(rhs.view());
+  }
+};
+
+inline bool operator==(const ArenaString & a, const ArenaString & b){
+  return a.prefix == b.prefix && a.len == b.len && memcmp(a.data, b.data, a.len) == 0;
+}
+
+inline bool operator<(const ArenaString & a, const ArenaString & b){
+  return a.compare(b) < 0;
+}
+
+inline bool operator>(const ArenaString & a, const ArenaString & b){
+  return a.compare(b) > 0;
+}
+
+inline ostream & operator<<(ostream & os, const ArenaString & s){
+  return os.write(s.data, s.len);
+}
+
+namespace std {
+  // Same value as hash<string> for the same characters.
+  template <>
+  struct hash<ArenaString>
+  {
+    size_t operator()(const ArenaString & s) const{
+      return hash<string_view>()(s.view());
+    }
+  };
+}
+
+/**
+ * Key storage for AvlTree<string>: key bytes are interned into an arena
+ * owned by the tree and nodes hold an ArenaString. Copies of the tree share
+ * the arena (it is reference counted and append-only), so cloning never
+ * allocates per key. Removed keys keep their bytes until make_empty().
+ * Not safe for concurrent use by trees sharing an arena.
+ */
+struct ArenaKeys
+{
+  typedef ArenaString key_type;
+
+ ArenaKeys( ):arena(new StringArena){}
+
+  ArenaString probe(const string & x) const{
+    return ArenaString(x.data(), x.size());
+  }
+
+  /**
+   * Interns the bytes of x and returns the stored key.
+   */
+  ArenaString make(const string & x){
+    return ArenaString(arena->append(x.data(), x.size()), x.size());
+  }
+
+  /**
+   * Drops this tree's reference to the arena and starts a fresh one; the
+   * old bytes are freed once no copy of the tree still uses them.
+   */
+  void clear(){
+    arena.reset(new StringArena);
+  }
+
+  unsigned long long arena_bytes() const{
+    return arena->bytes();
+  }
+
+ private:
+  shared_ptr<StringArena> arena;
+};
+
+#endif
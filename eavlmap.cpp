@@ -0,0 +1,279 @@
+//=============================================================
+// Name:  EAVLMAP.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "eavlmap.cpp" (templates), see eavlmap.h
+// Version: 1.0
+// Description: Implementation file for the AvlMap class.
+//
+//============================================================
+
+#include "eavlmap.h"
+
+/**
+ * Public methods
+ */
+template <typename Key, typename Value, typename Compare, typename Alloc>
+Value & AvlMap<Key, Value, Compare, Alloc>::operator[]( const Key & k )
+{
+  bool inserted = false;
+  return emplace(root, inserted, k)->entry.second;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+Value & AvlMap<Key, Value, Compare, Alloc>::operator[]( Key && k )
+{
+  bool inserted = false;
+  return emplace(root, inserted, std::move(k))->entry.second;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename... Args>
+pair<Value*, bool> AvlMap<Key, Value, Compare, Alloc>::try_emplace( const Key & k, Args&&... args )
+{
+  bool inserted = false;
+  MapNode *t = emplace(root, inserted, k, std::forward<Args>(args)...);
+  return make_pair(&t->entry.second, inserted);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename... Args>
+pair<Value*, bool> AvlMap<Key, Value, Compare, Alloc>::try_emplace( Key && k, Args&&... args )
+{
+  bool inserted = false;
+  MapNode *t = emplace(root, inserted, std::move(k), std::forward<Args>(args)...);
+  return make_pair(&t->entry.second, inserted);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename V>
+pair<Value*, bool> AvlMap<Key, Value, Compare, Alloc>::insert_or_assign( const Key & k, V && v )
+{
+  bool inserted = false;
+  MapNode *t = emplace(root, inserted, k, std::forward<V>(v));
+  if(!inserted)
+    t->entry.second = std::forward<V>(v);
+  return make_pair(&t->entry.second, inserted);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename V>
+pair<Value*, bool> AvlMap<Key, Value, Compare, Alloc>::insert_or_assign( Key && k, V && v )
+{
+  bool inserted = false;
+  MapNode *t = emplace(root, inserted, std::move(k), std::forward<V>(v));
+  if(!inserted)
+    t->entry.second = std::forward<V>(v);
+  return make_pair(&t->entry.second, inserted);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+Value * AvlMap<Key, Value, Compare, Alloc>::find( const Key & k )
+{
+  MapNode *t = find_node(k);
+  return t == NULL ? NULL : &t->entry.second;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+const Value * AvlMap<Key, Value, Compare, Alloc>::find( const Key & k ) const
+{
+  MapNode *t = find_node(k);
+  return t == NULL ? NULL : &t->entry.second;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+bool AvlMap<Key, Value, Compare, Alloc>::contains( const Key & k ) const
+{
+  return find_node(k) != NULL;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+bool AvlMap<Key, Value, Compare, Alloc>::erase( const Key & k )
+{
+  return erase(k, root);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename Visitor>
+void AvlMap<Key, Value, Compare, Alloc>::in_order( Visitor visit )
+{
+  in_order(root, visit);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename Visitor>
+void AvlMap<Key, Value, Compare, Alloc>::in_order( Visitor visit ) const
+{
+  in_order((const MapNode *)root, visit);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+int AvlMap<Key, Value, Compare, Alloc>::size( ) const
+{
+  return count;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+bool AvlMap<Key, Value, Compare, Alloc>::is_empty( ) const
+{
+  return root == NULL;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+int AvlMap<Key, Value, Compare, Alloc>::height( ) const
+{
+  return Rotations::height(root);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+void AvlMap<Key, Value, Compare, Alloc>::make_empty( )
+{
+  make_empty(root);
+  count = 0;
+}
+
+/**
+ * Private methods
+ */
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename K, typename... Args>
+typename AvlMap<Key, Value, Compare, Alloc>::MapNode *
+AvlMap<Key, Value, Compare, Alloc>::emplace( MapNode * & t, bool & inserted, K && k, Args&&... args )
+{
+  MapNode *found;
+  if( t == NULL ){
+    t = make_node(std::forward<K>(k), std::forward<Args>(args)...);
+    count++;
+    inserted = true;
+    return t;
+  }
+  else if( less_than(k, t->entry.first) )
+    found = emplace(t->left, inserted, std::forward<K>(k), std::forward<Args>(args)...);
+  else if( less_than(t->entry.first, k) )
+    found = emplace(t->right, inserted, std::forward<K>(k), std::forward<Args>(args)...);
+  else
+    return t;    // present; nothing below changed
+  if(inserted)
+    Rotations::balance(t);
+  return found;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+bool AvlMap<Key, Value, Compare, Alloc>::erase( const Key & k, MapNode * & t )
+{
+  bool erased;
+  if( t == NULL )
+    return false;    // Item not found; do nothing
+  else if( less_than(k, t->entry.first) )
+    erased = erase(k, t->left);
+  else if( less_than(t->entry.first, k) )
+    erased = erase(k, t->right);
+  else
+    {
+      MapNode *old_node = t;
+      if( t->left != NULL && t->right != NULL ) // Two children
+	{
+	  // Relink the successor node in t's place; no entry is copied.
+	  MapNode *successor = detach_min( t->right );
+	  successor->left = t->left;
+	  successor->right = t->right;
+	  t = successor;
+	}
+      else
+	t = ( t->left != NULL ) ? t->left : t->right;
+      free_node(old_node);
+      count--;
+      erased = true;
+    }
+  if(erased)
+    Rotations::balance(t);
+  return erased;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+typename AvlMap<Key, Value, Compare, Alloc>::MapNode *
+AvlMap<Key, Value, Compare, Alloc>::detach_min( MapNode * & t )
+{
+  if( t->left == NULL ){
+    MapNode *min = t;
+    t = t->right;
+    return min;
+  }
+  MapNode *min = detach_min( t->left );
+  Rotations::balance( t );
+  return min;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+typename AvlMap<Key, Value, Compare, Alloc>::MapNode *
+AvlMap<Key, Value, Compare, Alloc>::find_node( const Key & k ) const
+{
+  MapNode *t = root;
+  while(t != NULL){
+    if( less_than(k, t->entry.first) )
+      t = t->left;
+    else if( less_than(t->entry.first, k) )
+      t = t->right;
+    else
+      return t;
+  }
+  return NULL;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename K, typename... Args>
+typename AvlMap<Key, Value, Compare, Alloc>::MapNode *
+AvlMap<Key, Value, Compare, Alloc>::make_node( K && k, Args&&... args )
+{
+  MapNode *t = NodeTraits::allocate(alloc, 1);
+  try {
+    NodeTraits::construct(alloc, t, std::forward<K>(k), std::forward<Args>(args)...);
+  } catch(...) {
+    NodeTraits::deallocate(alloc, t, 1);
+    throw;
+  }
+  return t;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+void AvlMap<Key, Value, Compare, Alloc>::free_node( MapNode *t )
+{
+  NodeTraits::destroy(alloc, t);
+  NodeTraits::deallocate(alloc, t, 1);
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+typename AvlMap<Key, Value, Compare, Alloc>::MapNode *
+AvlMap<Key, Value, Compare, Alloc>::clone( const MapNode *t )
+{
+  if( t == NULL )
+    return NULL;
+  MapNode *c = make_node(t->entry.first, t->entry.second);
+  c->height = t->height;
+  c->left = clone( t->left );
+  c->right = clone( t->right );
+  return c;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+void AvlMap<Key, Value, Compare, Alloc>::make_empty( MapNode * & t )
+{
+  if( t != NULL )
+    {
+      make_empty( t->left );
+      make_empty( t->right );
+      free_node( t );
+    }
+  t = NULL;
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+template <typename Node, typename Visitor>
+void AvlMap<Key, Value, Compare, Alloc>::in_order( Node *t, Visitor & visit )
+{
+  if(t != NULL){
+    in_order(t->left, visit);
+    visit(t->entry.first, t->entry.second);
+    in_order(t->right, visit);
+  }
+}
@@ -0,0 +1,203 @@
+//=============================================================
+// Name:  EAVLMAP.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through eavlmap.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for an AVL tree map: every key carries a Value
+// of the caller's choosing instead of AvlTree's int frequency, so per-key
+// data (counters, timestamps, postings offsets) lives in the tree node and
+// is found and updated with one descent. Keys are ordered by Compare alone,
+// and nodes come from Alloc. Rotations are AvlTree's (eavlrotate.h).
+// Functions are implemented in eavlmap.cpp.
+//
+//============================================================
+
+#ifndef EAVL_MAP_H_INCLUDED
+#define EAVL_MAP_H_INCLUDED
+
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include "eavlrotate.h"
+
+using namespace std;
+
+// AvlMap class
+//
+// CONSTRUCTION: zero parameter, or a Compare and an Alloc
+// Compare: strict weak order on Key (default less<Key>); no ==, > needed
+// Alloc:   allocator of pair<const Key, Value>, rebound to the node type
+//
+// ******************PUBLIC OPERATIONS*********************
+// Value & operator[]( k )              --> k's value, default constructed if new
+// pair<Value*,bool> try_emplace( k, args... )
+//                                      --> Add k with Value(args...) unless present
+// pair<Value*,bool> insert_or_assign( k, v )
+//                                      --> Add k with v, or overwrite k's value
+// Value * find( k )                    --> k's value to read or update in place, or NULL
+// bool contains( k )                   --> Return true if k is present
+// bool erase( k )                      --> Remove k; false if it was absent
+// void in_order( visit )               --> visit(key, value) in sorted order
+// int size( ), height( ); bool is_empty( ); void make_empty( )
+//
+// The pair's bool is true when the key was added. Value pointers stay valid
+// until that key is erased: rotations relink nodes, never move them.
+//
+// AvlTree<Comparable> is the frequency counting case of the same tree,
+// AvlMap<Comparable, int> with insert as ++map[x], plus its own key
+// storage, cache and rebalancing options.
+
+template <typename Key, typename Value, typename Compare = less<Key>,
+  typename Alloc = allocator<pair<const Key, Value> > >
+class AvlMap
+{
+ public:
+  typedef pair<const Key, Value> value_type;
+
+ explicit AvlMap( const Compare & comp = Compare(), const Alloc & a = Alloc() )
+   :root(NULL),count(0),less_than(comp),alloc(a){}
+
+ AvlMap( const AvlMap & rhs )
+   :root(NULL),count(0),less_than(rhs.less_than),
+    alloc(allocator_traits<NodeAlloc>::select_on_container_copy_construction(rhs.alloc))
+    {
+      root = clone(rhs.root);
+      count = rhs.count;
+    }
+
+ AvlMap( AvlMap && rhs ):root(rhs.root),count(rhs.count),less_than(rhs.less_than),alloc(std::move(rhs.alloc))
+    {
+      rhs.root = NULL;
+      rhs.count = 0;
+    }
+
+  AvlMap & operator=( const AvlMap & rhs )
+    {
+      if(this != &rhs){
+	make_empty();
+	less_than = rhs.less_than;
+	root = clone(rhs.root);
+	count = rhs.count;
+      }
+      return *this;
+    }
+
+  ~AvlMap( ){
+    make_empty();
+  }
+
+  /**
+   * Returns k's value, adding k with a default constructed Value first if
+   * it is not present.
+   */
+  Value & operator[]( const Key & k );
+  Value & operator[]( Key && k );
+
+  /**
+   * Adds k with the Value built from args if k is not present; otherwise
+   * leaves the map alone and args unused. Returns k's value and whether k
+   * was added.
+   */
+  template <typename... Args>
+  pair<Value*, bool> try_emplace( const Key & k, Args&&... args );
+  template <typename... Args>
+  pair<Value*, bool> try_emplace( Key && k, Args&&... args );
+
+  /**
+   * Adds k with value v, or assigns v to k's value if k is present.
+   * Returns k's value and whether k was added.
+   */
+  template <typename V>
+  pair<Value*, bool> insert_or_assign( const Key & k, V && v );
+  template <typename V>
+  pair<Value*, bool> insert_or_assign( Key && k, V && v );
+
+  /**
+   * Returns k's value, which may be updated in place, or NULL if k is absent.
+   */
+  Value * find( const Key & k );
+  const Value * find( const Key & k ) const;
+
+  bool contains( const Key & k ) const;
+
+  /**
+   * Removes k and its value. Returns false if k was not present.
+   */
+  bool erase( const Key & k );
+
+  /**
+   * Calls visit(key, value) for every entry, in sorted key order. The
+   * non-const version passes the value by non-const reference.
+   */
+  template <typename Visitor>
+  void in_order( Visitor visit );
+  template <typename Visitor>
+  void in_order( Visitor visit ) const;
+
+  int size( ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Height of the tree: 0 for a single node, -1 when empty.
+   */
+  int height( ) const;
+
+  void make_empty( );
+
+ private:
+  struct MapNode
+  {
+    value_type entry;
+    MapNode *left;
+    MapNode *right;
+    int height;
+
+    template <typename K, typename... Args>
+  MapNode( K && k, Args&&... args )
+  :entry(piecewise_construct, forward_as_tuple(std::forward<K>(k)), forward_as_tuple(std::forward<Args>(args)...)),
+      left(NULL),right(NULL),height(0){}
+  };
+
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<MapNode> NodeAlloc;
+  typedef allocator_traits<NodeAlloc> NodeTraits;
+  typedef AvlRotations<MapNode> Rotations;
+
+  MapNode *root;
+  int count;
+  Compare less_than;
+  NodeAlloc alloc;
+
+  /**
+   * Finds k below t, or adds it as a new node whose value is built from
+   * args, rebalancing on the way back up. inserted says which happened.
+   * Returns k's node. k and args are only consumed by a new node.
+   */
+  template <typename K, typename... Args>
+  MapNode * emplace( MapNode * & t, bool & inserted, K && k, Args&&... args );
+
+  bool erase( const Key & k, MapNode * & t );
+
+  /**
+   * Unlinks the smallest node of subtree t, rebalancing on the way back up,
+   * and returns it. t must not be NULL.
+   */
+  MapNode * detach_min( MapNode * & t );
+
+  MapNode * find_node( const Key & k ) const;
+
+  template <typename K, typename... Args>
+  MapNode * make_node( K && k, Args&&... args );
+
+  void free_node( MapNode *t );
+
+  MapNode * clone( const MapNode *t );
+
+  void make_empty( MapNode * & t );
+
+  template <typename Node, typename Visitor>
+  static void in_order( Node *t, Visitor & visit );
+};
+#endif
@@ -0,0 +1,49 @@
+//=============================================================
+// Name:  EAVLPOLICY.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavltree.h
+// Version: 1.0
+// Description: Balancing policies for the enhanced AVL Tree. The policy is the
+// second template argument of AvlTree and decides whether the tree tracks
+// per-node access counts and when it is rebuilt by weight.
+//
+//============================================================
+
+#ifndef EAVL_POLICY_H_INCLUDED
+#define EAVL_POLICY_H_INCLUDED
+
+/**
+ * Strict AVL balancing (the default). Every insert and remove rebalances
+ * with the usual four rotations; access frequency is ignored.
+ */
+struct AvlBalance
+{
+  static const bool weighted = false;
+
+  static bool rebuild_due(int ops, int size){
+    return false;
+  }
+};
+
+/**
+ * Frequency-aware balancing for skewed workloads.
+ * Inserts and removes still rotate like AVL so the worst case stays bounded
+ * between rebuilds. Every node counts its find hits, and once the number of
+ * finds and inserts since the last rebuild reaches the size of the tree
+ * (and at least MIN_PERIOD) the tree is rebuilt into a weight-balanced BST
+ * with weight freq + hits, which puts hot keys near the root. The rebuild
+ * is O(n log n), so amortized over the period it is O(log n) per operation.
+ * Hits are halved on every rebuild so the shape follows a shifting workload.
+ */
+struct FrequencyBalance
+{
+  static const bool weighted = true;
+  static const int MIN_PERIOD = 1024;
+
+  static bool rebuild_due(int ops, int size){
+    return ops >= MIN_PERIOD && ops >= size;
+  }
+};
+
+#endif
@@ -0,0 +1,231 @@
+//=============================================================
+// Name:  EAVLPOOL.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavltree.h; link with -pthread
+// Version: 1.0
+// Description: Small fork-join task pool with work stealing, used by AvlTree
+// to split subtree-recursive traversals (clone, make_empty, print_tree,
+// int_path_length) across cores, and a parallel merge sort on top of it.
+//
+//============================================================
+
+#ifndef EAVL_POOL_H_INCLUDED
+#define EAVL_POOL_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Fork-join pool. Each worker owns a deque: fork_join pushes the second
+ * task on the back of the caller's deque and runs the first itself; idle
+ * workers steal from the front of other deques. A caller waiting for a
+ * stolen task runs other tasks meanwhile, so nested fork_join never blocks
+ * a worker. The thread that creates the pool is worker 0; any other thread
+ * (including another pool's worker) pushes onto a shared injection deque
+ * after the workers'. Workers that find nothing to steal sleep on a
+ * condition variable until a push or shutdown wakes them.
+ */
+class TaskPool
+{
+ public:
+  /**
+   * Starts threads - 1 background workers (the creating thread is the last one).
+   */
+  explicit TaskPool(int threads)
+    :threads(threads > 0 ? threads : 1),queues(this->threads + 1),stopping(false),queued(0),sleepers(0)
+    {
+      owner = this_thread::get_id();
+      for(int i = 1; i < this->threads; i++)
+	workers.push_back(thread(&TaskPool::work, this, i));
+    }
+
+  ~TaskPool( ){
+    {
+      lock_guard<mutex> guard(sleep_lock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for(unsigned int i = 0; i < workers.size(); i++)
+      workers[i].join();
+  }
+
+  int size() const{
+    return threads;
+  }
+
+  /**
+   * Runs a() and b(), possibly in parallel, and returns when both are done.
+   */
+  template <typename A, typename B>
+  void fork_join(A a, B b){
+    int me = index();
+    Task task(b);
+    push(me, &task);
+    a();
+    if(pop(me, &task)){
+      task.run();
+      return;
+    }
+    // b was stolen; help out until the thief finishes it
+    while(!task.done.load(memory_order_acquire)){
+      Task *other = find_work(me);
+      if(other != NULL)
+	other->run();
+      else
+	this_thread::yield();
+    }
+  }
+
+ private:
+  struct Task
+  {
+    function<void()> fn;
+    atomic<bool> done;
+
+    template <typename F>
+    explicit Task(F f):fn(f),done(false){}
+
+    void run(){
+      fn();
+      done.store(true, memory_order_release);
+    }
+  };
+
+  struct Queue
+  {
+    mutex lock;
+    deque<Task*> tasks;
+  };
+
+  int threads;
+  vector<Queue> queues;    // one per worker, then the injection deque
+  vector<thread> workers;
+  atomic<bool> stopping;
+  atomic<long> queued;     // tasks waiting in any deque
+  atomic<int> sleepers;    // workers parked on wake
+  mutex sleep_lock;
+  condition_variable wake;
+  thread::id owner;
+
+  struct Worker
+  {
+    const TaskPool *pool;
+    int index;
+  };
+
+  // The pool the calling thread works for, if any, and its deque there.
+  static Worker & current(){
+    static thread_local Worker w = { NULL, -1 };
+    return w;
+  }
+
+  int index(){
+    if(current().pool == this)
+      return current().index;
+    if(this_thread::get_id() == owner)
+      return 0;
+    return threads;    // the injection deque
+  }
+
+  void push(int q, Task *t){
+    {
+      lock_guard<mutex> guard(queues[q].lock);
+      queues[q].tasks.push_back(t);
+    }
+    queued.fetch_add(1);
+    if(sleepers.load() > 0){
+      lock_guard<mutex> guard(sleep_lock);
+      wake.notify_one();
+    }
+  }
+
+  // Takes t back off the caller's deque unless it was stolen. Outside
+  // callers share the injection deque, so t need not be at the back.
+  bool pop(int q, Task *t){
+    lock_guard<mutex> guard(queues[q].lock);
+    deque<Task*> & tasks = queues[q].tasks;
+    for(deque<Task*>::iterator it = tasks.end(); it != tasks.begin(); )
+      if(*--it == t){
+	tasks.erase(it);
+	queued.fetch_sub(1);
+	return true;
+      }
+    return false;
+  }
+
+  Task * steal(int q){
+    lock_guard<mutex> guard(queues[q].lock);
+    if(queues[q].tasks.empty())
+      return NULL;
+    Task *t = queues[q].tasks.front();
+    queues[q].tasks.pop_front();
+    queued.fetch_sub(1);
+    return t;
+  }
+
+  Task * find_work(int me){
+    int n = queues.size();
+    for(int k = 1; k < n; k++){
+      Task *t = steal((me + k) % n);
+      if(t != NULL)
+	return t;
+    }
+    return NULL;
+  }
+
+  void work(int i){
+    current().pool = this;
+    current().index = i;
+    int idle = 0;
+    while(!stopping.load()){
+      Task *t = steal(i);
+      if(t == NULL)
+	t = find_work(i);
+      if(t != NULL){
+	t->run();
+	idle = 0;
+      } else if(++idle < 64)
+	this_thread::yield();
+      else {
+	// sleepers goes up before queued is read and push bumps queued
+	// before reading sleepers, so one of them sees the other.
+	sleepers.fetch_add(1);
+	unique_lock<mutex> guard(sleep_lock);
+	wake.wait(guard, [this](){ return stopping.load() || queued.load() > 0; });
+	sleepers.fetch_sub(1);
+	idle = 0;
+      }
+    }
+  }
+
+  TaskPool(const TaskPool &);
+  TaskPool & operator=(const TaskPool &);
+};
+
+/**
+ * Sorts [first, last) by less, splitting ranges longer than grain across
+ * pool: both halves are sorted in parallel and then merged in place. With
+ * no pool it is std::sort.
+ */
+template <typename It, typename Less>
+void parallel_sort(TaskPool *pool, It first, It last, Less less, long grain = 1 << 16){
+  if(pool == NULL || pool->size() == 1 || last - first <= grain){
+    sort(first, last, less);
+    return;
+  }
+  It mid = first + (last - first) / 2;
+  pool->fork_join([&](){ parallel_sort(pool, first, mid, less, grain); },
+		  [&](){ parallel_sort(pool, mid, last, less, grain); });
+  inplace_merge(first, mid, last, less);
+}
+
+#endif
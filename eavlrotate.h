@@ -0,0 +1,118 @@
+//=============================================================
+// Name:  EAVLROTATE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavltree.h and eavlmap.h
+// Version: 1.0
+// Description: The AVL height bookkeeping, rotations and rebalancing step,
+// written once for any node type with left, right and height members so
+// AvlTree and AvlMap share them.
+//
+//============================================================
+
+#ifndef EAVL_ROTATE_H_INCLUDED
+#define EAVL_ROTATE_H_INCLUDED
+
+#include <cstddef>
+
+/**
+ * Which rotation balance() made, named after the AVL cases: single left is
+ * case 1, double left case 2, double right case 3, single right case 4.
+ */
+enum AvlRotation { NO_ROTATION, SINGLE_LEFT, DOUBLE_LEFT, DOUBLE_RIGHT, SINGLE_RIGHT };
+
+template <typename Node>
+struct AvlRotations
+{
+  static const int ALLOWED_IMBALANCE = 1;
+
+  /**
+   * Return the height of node t or -1 if NULL.
+   */
+  static int height( const Node *t ){
+    return t == NULL ? -1 : t->height;
+  }
+
+  static int max( int lhs, int rhs ){
+    return lhs > rhs ? lhs : rhs;
+  }
+
+  /**
+   * Rotate binary tree node with left child.
+   * Update heights, then set new root.
+   */
+  static void rotate_with_left_child( Node * & k2 ){
+    Node *k1 = k2->left;
+    k2->left = k1->right;
+    k1->right = k2;
+    k2->height = max( height( k2->left ), height( k2->right ) ) + 1;
+    k1->height = max( height( k1->left ), k2->height ) + 1;
+    k2 = k1;
+  }
+
+  /**
+   * Rotate binary tree node with right child.
+   * Update heights, then set new root.
+   */
+  static void rotate_with_right_child( Node * & k1 ){
+    Node *k2 = k1->right;
+    k1->right = k2->left;
+    k2->left = k1;
+    k1->height = max( height( k1->left ), height( k1->right ) ) + 1;
+    k2->height = max( height( k2->right ), k1->height ) + 1;
+    k1 = k2;
+  }
+
+  /**
+   * Double rotate: first k3's left child with its right child, then k3
+   * with its new left child.
+   */
+  static void double_with_left_child( Node * & k3 ){
+    rotate_with_right_child( k3->left );
+    rotate_with_left_child( k3 );
+  }
+
+  /**
+   * Double rotate: first k1's right child with its left child, then k1
+   * with its new right child.
+   */
+  static void double_with_right_child( Node * & k1 ){
+    rotate_with_left_child( k1->right );
+    rotate_with_right_child( k1 );
+  }
+
+  /**
+   * Rebalances t, which must be balanced or within one of being balanced,
+   * and sets its height. Returns the rotation made. A relaxed tree passes
+   * a larger allowed imbalance and only rotates beyond it.
+   */
+  static AvlRotation balance( Node * & t, int allowed = ALLOWED_IMBALANCE ){
+    if( t == NULL )
+      return NO_ROTATION;
+    AvlRotation made = NO_ROTATION;
+    if( height( t->left ) - height( t->right ) > allowed ){
+      if( height( t->left->left ) >= height( t->left->right ) ){
+	made = SINGLE_LEFT;
+	rotate_with_left_child( t );
+      }
+      else{
+	made = DOUBLE_LEFT;
+	double_with_left_child( t );
+      }
+    }
+    else if( height( t->right ) - height( t->left ) > allowed ){
+      if( height( t->right->right ) >= height( t->right->left ) ){
+	made = SINGLE_RIGHT;
+	rotate_with_right_child( t );
+      }
+      else{
+	made = DOUBLE_RIGHT;
+	double_with_right_child( t );
+      }
+    }
+    t->height = max( height( t->left ), height( t->right ) ) + 1;
+    return made;
+  }
+};
+
+#endif
@@ -0,0 +1,692 @@
+//=============================================================
+// Name:  EAVLSERVE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by main.cpp (Linux only)
+// Version: 1.0
+// Description: Server mode for the driver (eavl.out --serve). Many local
+// clients connect to a UNIX-domain socket; accepts, receives and sends are
+// batched through io_uring (driven with the raw system calls, no liburing),
+// or through epoll where io_uring is unavailable. Each round of received
+// commands runs against the one shared AvlTree, with clients spread over a
+// TaskPool: finds share a reader lock and go through the side-effect free
+// AvlTree::lookup, inserts and removes take the writer lock. Clients speak
+// the driver's insert, remove, find, display and quit, or the binary
+// commands of eavlcodec.h.
+//
+//============================================================
+
+#ifndef EAVL_SERVE_H_INCLUDED
+#define EAVL_SERVE_H_INCLUDED
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "eavlcodec.h"
+#include "eavlpool.h"
+#include "eavlstream.h"
+#include "eavlwal.h"
+
+using namespace std;
+
+/**
+ * Just enough of io_uring for a socket server, on the raw system calls:
+ * a submission ring to queue accept / recv / send requests and a
+ * completion ring to reap their results. init() fails cleanly when the
+ * kernel (or a seccomp filter) refuses io_uring.
+ */
+class IoUring
+{
+ public:
+ IoUring( ):ring_fd(-1),sq_ptr(MAP_FAILED),cq_ptr(MAP_FAILED),sqes(NULL),sq_len(0),cq_len(0),
+    sqes_len(0),tail(0),submitted(0){}
+
+  ~IoUring( ){
+    if(sqes != NULL)
+      munmap(sqes, sqes_len);
+    if(cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+      munmap(cq_ptr, cq_len);
+    if(sq_ptr != MAP_FAILED)
+      munmap(sq_ptr, sq_len);
+    if(ring_fd >= 0)
+      close(ring_fd);
+  }
+
+  bool init(unsigned entries){
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+    if(ring_fd < 0)
+      return false;
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single)
+      sq_len = cq_len = sq_len > cq_len ? sq_len : cq_len;
+    sq_ptr = mmap(NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if(sq_ptr == MAP_FAILED)
+      return false;
+    cq_ptr = single ? sq_ptr
+      : mmap(NULL, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if(cq_ptr == MAP_FAILED)
+      return false;
+    sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+    void *s = mmap(NULL, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if(s == MAP_FAILED)
+      return false;
+    sqes = (io_uring_sqe *)s;
+    char *sq = (char *)sq_ptr, *cq = (char *)cq_ptr;
+    sq_head = (unsigned *)(sq + p.sq_off.head);
+    sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    sq_entries = p.sq_entries;
+    sq_array = (unsigned *)(sq + p.sq_off.array);
+    cq_head = (unsigned *)(cq + p.cq_off.head);
+    cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    cqes = (io_uring_cqe *)(cq + p.cq_off.cqes);
+    tail = *sq_tail;
+    submitted = tail;
+    return true;
+  }
+
+  /**
+   * Returns a cleared submission entry to fill in, or NULL when the
+   * submission ring is full (submit, then try again).
+   */
+  io_uring_sqe * next_sqe(){
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if(tail - head >= sq_entries)
+      return NULL;
+    unsigned i = tail & sq_mask;
+    sq_array[i] = i;
+    tail++;
+    memset(&sqes[i], 0, sizeof(io_uring_sqe));
+    return &sqes[i];
+  }
+
+  /**
+   * Hands the queued entries to the kernel and waits for at least wait_nr
+   * completions. Returns what io_uring_enter returns, or -errno.
+   */
+  int submit_and_wait(unsigned wait_nr){
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+    unsigned to_submit = tail - submitted;
+    int r = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if(r < 0)
+      return -errno;
+    submitted += r;
+    return r;
+  }
+
+  /**
+   * Calls on_cqe(user_data, res) for every completion waiting and returns
+   * how many there were.
+   */
+  template <typename F>
+  unsigned drain(F on_cqe){
+    unsigned head = *cq_head;
+    unsigned end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n = 0;
+    for(; head != end; head++, n++){
+      const io_uring_cqe & c = cqes[head & cq_mask];
+      on_cqe(c.user_data, c.res);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return n;
+  }
+
+ private:
+  int ring_fd;
+  void *sq_ptr, *cq_ptr;
+  io_uring_sqe *sqes;
+  size_t sq_len, cq_len, sqes_len;
+  unsigned *sq_head, *sq_tail, *sq_array, sq_mask, sq_entries;
+  unsigned *cq_head, *cq_tail, cq_mask;
+  io_uring_cqe *cqes;
+  unsigned tail;       // our submission tail, published by submit_and_wait
+  unsigned submitted;  // entries the kernel has consumed
+
+  IoUring(const IoUring &);
+  IoUring & operator=(const IoUring &);
+};
+
+/**
+ * Serves a Tree (AvlTree<string>) to local clients; see the file comment.
+ * Text clients get exactly the lines eavl_driver prints for find, insert
+ * and remove, and display works too; quit closes the connection, any other
+ * line gets the driver's "is not a valid line" message. A client whose
+ * first byte is BINARY_HELLO sends encoded commands instead and gets one
+ * encoded result for each (eavlcodec.h); an unknown opcode, a malformed
+ * length or a key over MAX_KEY_BYTES closes it, as does a text line over
+ * MAX_LINE_BYTES, so no client can make the server buffer without bound.
+ */
+template <typename Tree>
+class TreeServer
+{
+ public:
+  static const int READ_CHUNK = 16 * 1024;
+  static const unsigned QUEUE_DEPTH = 1024;
+  // Longest text line buffered while waiting for its newline.
+  static const size_t MAX_LINE_BYTES = MAX_KEY_BYTES + 16;
+  // How long accepting stops after accept runs out of descriptors or memory.
+  static constexpr int BACKOFF_MS = 100;
+
+ TreeServer(Tree & tree, TaskPool *workers, TreeLog<Tree> *log)
+   :t(tree),pool(workers),wal(log),listen_fd(-1),served(0),io_name("none"),errors(&cerr),
+    accept_paused(false),accept_error(0){}
+
+  ~TreeServer( ){
+    for(unsigned int i = 0; i < conns.size(); i++)
+      if(conns[i] != NULL)
+	drop(conns[i]);
+    if(listen_fd >= 0){
+      close(listen_fd);
+      unlink(socket_path.c_str());
+    }
+  }
+
+  bool listen_unix(const string & path, ostream & err){
+    listen_fd = open_unix_listener(path, err);
+    if(listen_fd < 0)
+      return false;
+    socket_path = path;
+    return true;
+  }
+
+  /**
+   * Serves until SIGINT / SIGTERM, through io_uring if uring is set and
+   * the kernel allows it, otherwise through epoll. Returns the number of
+   * clients served, or -1 if neither could be set up.
+   */
+  int run(bool uring, ostream & err){
+    errors = &err;
+    install_stop_handlers();
+    if(uring && run_uring())
+      return served;
+    if(run_epoll(err))
+      return served;
+    return -1;
+  }
+
+  /**
+   * "io_uring" or "epoll": the loop run() used.
+   */
+  const char * io() const{
+    return io_name;
+  }
+
+ private:
+  enum { ACCEPT, RECV, SEND, RETRY };
+
+  struct Connection
+  {
+    int fd;
+    int id;
+    bool decided;     // protocol known (text or binary)
+    bool binary;
+    bool eof;         // no more input will come
+    bool closing;     // quit, bad input or a dead peer: send what is left, then close
+    bool queued;      // in ready
+    bool shut;
+    int pending;      // io_uring operations in flight: 1 recv, 2 send
+    bool want_out;    // epoll: EPOLLOUT registered
+    string in;        // received, not yet run
+    string out;       // results not yet sent
+    string inflight;  // io_uring: results being sent
+    size_t inflight_sent;
+    unsigned long long finds;
+    unsigned long long find_visits;
+    char buf[READ_CHUNK];
+  };
+
+  Tree & t;
+  TaskPool *pool;
+  TreeLog<Tree> *wal;
+  shared_mutex lock;
+  int listen_fd;
+  string socket_path;
+  int served;
+  const char *io_name;
+  ostream *errors;
+  bool accept_paused;          // backing off after a failed accept
+  int accept_error;            // errno of the failure last logged, 0 after an accept
+  chrono::steady_clock::time_point retry_at;
+  vector<Connection*> conns;   // by id, NULL when free
+  vector<Connection*> ready;   // connections with input to run this round
+
+  Connection * add_connection(int fd){
+    Connection *c = new Connection();
+    c->fd = fd;
+    c->decided = c->binary = c->eof = c->closing = c->queued = c->shut = c->want_out = false;
+    c->pending = 0;
+    c->inflight_sent = 0;
+    c->finds = c->find_visits = 0;
+    unsigned int id = 0;
+    while(id < conns.size() && conns[id] != NULL)
+      id++;
+    if(id == conns.size())
+      conns.push_back(NULL);
+    conns[id] = c;
+    c->id = id;
+    served++;
+    return c;
+  }
+
+  void drop(Connection *c){
+    close(c->fd);
+    conns[c->id] = NULL;
+    delete c;
+    accept_paused = false;    // its descriptor is free again
+  }
+
+  /**
+   * After a failed accept: a client that gave up or a signal just retries;
+   * anything else (EMFILE, ENFILE, ENOBUFS, ENOMEM) stops accepting until
+   * a connection closes or BACKOFF_MS pass, instead of failing again at
+   * once. Each new error is logged once. Returns true if accepting stopped.
+   */
+  bool accept_failed(int error){
+    if(error == EAGAIN || error == EWOULDBLOCK || error == EINTR || error == ECONNABORTED)
+      return false;
+    if(error != accept_error)
+      *errors << "ERROR: accept: " << strerror(error) << "; retrying in " << BACKOFF_MS
+	      << " ms or when a client disconnects" << endl;
+    accept_error = error;
+    accept_paused = true;
+    retry_at = chrono::steady_clock::now() + chrono::milliseconds(BACKOFF_MS);
+    return true;
+  }
+
+  bool finished(const Connection *c) const{
+    return (c->eof || c->closing) && c->out.empty() && c->inflight.empty() && c->pending == 0;
+  }
+
+  void received(Connection *c, const char *p, ssize_t n){
+    if(n > 0)
+      c->in.append(p, n);
+    else
+      c->eof = true;
+    if(!c->queued){
+      c->queued = true;
+      ready.push_back(c);
+    }
+  }
+
+  /**
+   * Runs the input of every ready connection, in parallel across the pool,
+   * then adds their finds to the tree's statistics.
+   */
+  void run_ready(){
+    if(ready.empty())
+      return;
+    if(pool != NULL && ready.size() > 1)
+      run_range(0, ready.size());
+    else
+      for(unsigned int i = 0; i < ready.size(); i++)
+	execute(ready[i]);
+    for(unsigned int i = 0; i < ready.size(); i++){
+      Connection *c = ready[i];
+      t.count_finds(c->finds, c->find_visits);
+      c->finds = c->find_visits = 0;
+      c->queued = false;
+    }
+    ready.clear();
+  }
+
+  void run_range(int lo, int hi){
+    if(hi - lo == 1)
+      execute(ready[lo]);
+    else {
+      int mid = lo + (hi - lo) / 2;
+      pool->fork_join([&](){ run_range(lo, mid); }, [&](){ run_range(mid, hi); });
+    }
+  }
+
+  /**
+   * Runs every complete command in c->in; at end of input a last text line
+   * without a newline runs too, as in the file driver.
+   */
+  void execute(Connection *c){
+    if(!c->decided && !c->in.empty()){
+      c->decided = true;
+      if((unsigned char)c->in[0] == BINARY_HELLO){
+	c->binary = true;
+	c->in.erase(0, 1);
+      }
+    }
+    const char *p = c->in.data(), *end = p + c->in.size();
+    if(c->binary){
+      char op;
+      string_view key;
+      Decoded d = DECODED;
+      while(!c->closing && (d = decode_command(p, end, op, key, MAX_KEY_BYTES)) == DECODED)
+	run_command(c, op, key);
+      if(d == MALFORMED)
+	c->closing = true;    // a bad varint or an oversized key; waiting would only buffer more
+    } else {
+      while(p < end && !c->closing){
+	const char *nl = (const char *)memchr(p, '\n', end - p);
+	if(nl == NULL && !c->eof)
+	  break;
+	const char *stop = nl != NULL ? nl : end;
+	run_line(c, string_view(p, stop - p));
+	p = nl != NULL ? nl + 1 : end;
+      }
+      if((size_t)(end - p) > MAX_LINE_BYTES)
+	c->closing = true;
+    }
+    if(c->closing)
+      c->in.clear();
+    else
+      c->in.erase(0, p - c->in.data());
+  }
+
+  /**
+   * One text line, split on whitespace like simple_tokenizer; lines of
+   * three or more words are ignored, as the file driver ignores them.
+   * Only insert, remove, find, display and quit are served; the driver's
+   * other commands get their own error (see driver_only).
+   */
+  void run_line(Connection *c, string_view line){
+    string_view words[3];
+    int n = 0;
+    size_t i = 0;
+    while(n < 3){
+      while(i < line.size() && isspace((unsigned char)line[i]))
+	i++;
+      if(i == line.size())
+	break;
+      size_t j = i;
+      while(j < line.size() && !isspace((unsigned char)line[j]))
+	j++;
+      words[n++] = line.substr(i, j - i);
+      i = j;
+    }
+    if(n == 0 || n == 3)
+      return;
+    if(n == 2 && (words[0] == "insert" || words[0] == "remove" || words[0] == "find"))
+      run_command(c, words[0][0], words[1]);
+    else if(n == 1 && words[0] == "quit")
+      c->closing = true;
+    else if(words[0] == "display"){
+      ostringstream shown;
+      {
+	shared_lock<shared_mutex> reading(lock);
+	t.display(shown);
+      }
+      c->out += shown.str();
+    } else if(n == 1 && driver_only(words[0])){
+      c->out += "(";
+      c->out.append(words[0].data(), words[0].size());
+      c->out += ") is not served; clients may insert, remove, find, display or quit\n";
+    } else {
+      c->out += "(";
+      c->out.append(line.data(), line.size());
+      c->out += ") is not a valid line!\n";
+    }
+  }
+
+  /**
+   * Driver commands that only the file driver runs. They print through the
+   * driver's cout or read its globals, which the workers serving other
+   * clients at the same time would share.
+   */
+  static bool driver_only(string_view cmd){
+    return cmd == "report" || cmd == "check" || cmd == "memory" || cmd == "compact" || cmd == "settle" || cmd == "stats";
+  }
+
+  void run_command(Connection *c, char op, string_view key){
+    typename Tree::freq_type freq = 0;
+    int visits = 0;
+    if(op == 'f'){
+      shared_lock<shared_mutex> reading(lock);
+      visits = t.lookup(string(key), freq);
+      c->finds++;
+      c->find_visits += visits;
+    } else if(op == 'i' || op == 'r'){
+      string k(key);
+      unique_lock<shared_mutex> writing(lock);
+      if(wal != NULL)
+	wal->record(op, k);
+      freq = op == 'i' ? t.insert(k) : t.remove(k);
+      if(wal != NULL)
+	wal->applied(t);
+    } else {
+      c->closing = true;    // only binary commands get here
+      return;
+    }
+    if(c->binary){
+      encode_result(c->out, freq, visits);
+      return;
+    }
+    c->out.append(key.data(), key.size());
+    c->out += '\t';
+    if(op == 'r' && freq < 0)
+      c->out += "not found";
+    else {
+      c->out += to_string(freq);
+      if(op == 'f'){
+	c->out += '\t';
+	c->out += to_string(visits);
+      }
+    }
+    c->out += '\n';
+  }
+
+  // io_uring loop: user_data is connection id * 4 + operation
+  bool run_uring(){
+    IoUring ring;
+    if(!ring.init(QUEUE_DEPTH))
+      return false;
+    io_name = "io_uring";
+    bool accepting = false, backing_off = false;
+    __kernel_timespec backoff = { 0, BACKOFF_MS * 1000000LL };
+    while(!stream_stop_requested()){
+      if(!accepting && !accept_paused){
+	io_uring_sqe *s = next_sqe(ring);
+	s->opcode = IORING_OP_ACCEPT;
+	s->fd = listen_fd;
+	s->user_data = ACCEPT;
+	accepting = true;
+      } else if(accept_paused && !backing_off){
+	io_uring_sqe *s = next_sqe(ring);
+	s->opcode = IORING_OP_TIMEOUT;
+	s->addr = (unsigned long)&backoff;
+	s->len = 1;
+	s->user_data = RETRY;
+	backing_off = true;
+      }
+      for(unsigned int i = 0; i < conns.size(); i++){
+	Connection *c = conns[i];
+	if(c == NULL)
+	  continue;
+	if(c->inflight.empty() && !c->out.empty()){
+	  c->inflight.swap(c->out);
+	  c->inflight_sent = 0;
+	}
+	if(!c->inflight.empty() && !(c->pending & 2))
+	  queue_send(ring, c);
+	if(!c->eof && !c->closing && !(c->pending & 1)){
+	  io_uring_sqe *s = next_sqe(ring);
+	  s->opcode = IORING_OP_RECV;
+	  s->fd = c->fd;
+	  s->addr = (unsigned long)c->buf;
+	  s->len = READ_CHUNK;
+	  s->user_data = (unsigned long long)c->id * 4 + RECV;
+	  c->pending |= 1;
+	}
+	if(c->closing && !c->shut && c->out.empty() && c->inflight.empty()){
+	  shutdown(c->fd, SHUT_RDWR);    // ends a recv still in flight
+	  c->shut = true;
+	}
+	if(finished(c))
+	  drop(c);
+      }
+      int r = ring.submit_and_wait(1);
+      if(r < 0 && r != -EINTR && r != -EAGAIN && r != -EBUSY)
+	break;
+      ring.drain([&](unsigned long long data, int res){
+	  if(data == ACCEPT){
+	    accepting = false;
+	    if(res >= 0){
+	      add_connection(res);
+	      accept_error = 0;
+	    } else
+	      accept_failed(-res);
+	    return;
+	  }
+	  if(data == RETRY){
+	    backing_off = false;
+	    accept_paused = false;
+	    return;
+	  }
+	  Connection *c = conns[data / 4];
+	  if(data % 4 == RECV){
+	    c->pending &= ~1;
+	    if(res > 0)
+	      received(c, c->buf, res);
+	    else if(res != -EAGAIN && res != -EINTR)
+	      received(c, NULL, 0);
+	  } else {
+	    c->pending &= ~2;
+	    if(res > 0){
+	      c->inflight_sent += res;
+	      if(c->inflight_sent == c->inflight.size())
+		c->inflight.clear();
+	    } else if(res != -EAGAIN && res != -EINTR){
+	      c->inflight.clear();    // peer gone
+	      c->out.clear();
+	      c->closing = true;
+	    }
+	  }
+	});
+      run_ready();
+    }
+    return true;
+  }
+
+  io_uring_sqe * next_sqe(IoUring & ring){
+    io_uring_sqe *s;
+    while((s = ring.next_sqe()) == NULL)
+      ring.submit_and_wait(0);
+    return s;
+  }
+
+  void queue_send(IoUring & ring, Connection *c){
+    io_uring_sqe *s = next_sqe(ring);
+    s->opcode = IORING_OP_SEND;
+    s->fd = c->fd;
+    s->addr = (unsigned long)(c->inflight.data() + c->inflight_sent);
+    s->len = c->inflight.size() - c->inflight_sent;
+    s->msg_flags = MSG_NOSIGNAL;
+    s->user_data = (unsigned long long)c->id * 4 + SEND;
+    c->pending |= 2;
+  }
+
+  // epoll loop, level triggered: data.u64 is connection id * 4 + RECV, or
+  // ACCEPT. While accepting is paused the listener is left out of the set.
+  bool run_epoll(ostream & err){
+    int ep = epoll_create1(0);
+    if(ep < 0){
+      err << "ERROR: epoll_create1: " << strerror(errno) << endl;
+      return false;
+    }
+    io_name = "epoll";
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = ACCEPT;
+    epoll_ctl(ep, EPOLL_CTL_ADD, listen_fd, &ev);
+    epoll_event events[256];
+    bool listening = true;
+    while(!stream_stop_requested()){
+      int wait_ms = -1;
+      if(accept_paused){
+	chrono::steady_clock::duration left = retry_at - chrono::steady_clock::now();
+	wait_ms = max(0L, (long)chrono::duration_cast<chrono::milliseconds>(left).count() + 1);
+      }
+      int n = epoll_wait(ep, events, 256, wait_ms);
+      if(n < 0 && errno != EINTR)
+	break;
+      for(int i = 0; i < n; i++){
+	if(events[i].data.u64 == ACCEPT){
+	  int fd;
+	  while((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK)) >= 0){
+	    Connection *c = add_connection(fd);
+	    accept_error = 0;
+	    ev.events = EPOLLIN;
+	    ev.data.u64 = (unsigned long long)c->id * 4 + RECV;
+	    epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+	  }
+	  if(accept_failed(errno)){
+	    epoll_ctl(ep, EPOLL_CTL_DEL, listen_fd, NULL);
+	    listening = false;
+	  }
+	  continue;
+	}
+	Connection *c = conns[events[i].data.u64 / 4];
+	if(c == NULL)
+	  continue;
+	if((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !c->eof){
+	  ssize_t got = read(c->fd, c->buf, READ_CHUNK);
+	  if(got >= 0 || (errno != EAGAIN && errno != EINTR))
+	    received(c, c->buf, got > 0 ? got : 0);
+	}
+      }
+      run_ready();
+      for(unsigned int i = 0; i < conns.size(); i++){
+	Connection *c = conns[i];
+	if(c == NULL)
+	  continue;
+	if(!c->out.empty()){
+	  ssize_t sent = send(c->fd, c->out.data(), c->out.size(), MSG_NOSIGNAL);
+	  if(sent > 0)
+	    c->out.erase(0, sent);
+	  else if(sent < 0 && errno != EAGAIN && errno != EINTR){
+	    c->out.clear();
+	    c->closing = true;
+	  }
+	}
+	bool want_out = !c->out.empty();
+	if(want_out != c->want_out || ((c->eof || c->closing) && !c->shut)){
+	  // stop polling input a client will not send, and poll output while some is queued
+	  ev.events = (c->eof || c->closing ? 0 : EPOLLIN) | (want_out ? EPOLLOUT : 0);
+	  ev.data.u64 = (unsigned long long)c->id * 4 + RECV;
+	  epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+	  c->want_out = want_out;
+	  c->shut = c->eof || c->closing;
+	}
+	if(finished(c))
+	  drop(c);    // close() also removes it from the epoll set
+      }
+      if(accept_paused && chrono::steady_clock::now() >= retry_at)
+	accept_paused = false;
+      if(!listening && !accept_paused){
+	ev.events = EPOLLIN;
+	ev.data.u64 = ACCEPT;
+	epoll_ctl(ep, EPOLL_CTL_ADD, listen_fd, &ev);
+	listening = true;
+      }
+    }
+    close(ep);
+    return true;
+  }
+
+  TreeServer(const TreeServer &);
+  TreeServer & operator=(const TreeServer &);
+};
+
+#endif
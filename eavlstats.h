@@ -0,0 +1,332 @@
+//=============================================================
+// Name:  EAVLSTATS.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by eavltree.h and main.cpp; compile with -DEAVL_STATS
+//        (or make eavl_stats.out) to turn the counters on.
+// Version: 1.0
+// Description: Optional instrumentation for the enhanced AVL Tree. Counts
+// rotations by case, search path lengths for insert/remove/find, and keeps
+// HDR-style latency histograms for driver commands. MemoryAccount, the
+// tree's heap footprint, is kept whether or not EAVL_STATS is defined. When EAVL_STATS is not
+// defined the EAVL_STAT macro expands to nothing and no counters exist.
+//
+//============================================================
+
+#ifndef EAVL_STATS_H_INCLUDED
+#define EAVL_STATS_H_INCLUDED
+
+#include <iostream>
+#include <malloc.h>
+#include <string>
+
+using namespace std;
+
+#ifdef EAVL_STATS
+#define EAVL_STAT(stmt) do { stmt; } while(0)
+#else
+#define EAVL_STAT(stmt) do { } while(0)
+#endif
+
+/**
+ * Latency histogram with HDR-style buckets: values below 16 get their own
+ * bucket, above that every power of two is split into 8 linear sub-buckets,
+ * so every recorded value is within 12.5% of its bucket's lower bound.
+ * Values are nanoseconds.
+ */
+class LatencyHistogram
+{
+ public:
+  static const int SUB_BUCKETS = 8;
+  static const int LINEAR = 16;
+  static const int BUCKETS = LINEAR + (64 - 4) * SUB_BUCKETS;
+
+ LatencyHistogram( ):total(0),sum(0),max_value(0)
+    {
+      for(int i = 0; i < BUCKETS; i++)
+	counts[i] = 0;
+    }
+
+  /**
+   * Record one sample of v nanoseconds.
+   */
+  void record(unsigned long long v){
+    counts[bucket_of(v)]++;
+    total++;
+    sum += v;
+    if(v > max_value)
+      max_value = v;
+  }
+
+  unsigned long long count() const{
+    return total;
+  }
+
+  unsigned long long max() const{
+    return max_value;
+  }
+
+  double mean() const{
+    return total > 0 ? (double)sum / total : 0;
+  }
+
+  /**
+   * Returns the lower bound of the bucket holding the p-th percentile (0-100).
+   */
+  unsigned long long percentile(double p) const{
+    if(total == 0)
+      return 0;
+    unsigned long long rank = (unsigned long long)(p / 100.0 * total);
+    if(rank >= total)
+      rank = total - 1;
+    unsigned long long seen = 0;
+    for(int i = 0; i < BUCKETS; i++){
+      seen += counts[i];
+      if(seen > rank)
+	return lower_bound_of(i);
+    }
+    return max_value;
+  }
+
+  /**
+   * Writes count, mean, max and the usual tail percentiles as a JSON object.
+   */
+  void write_json(ostream& os) const{
+    os << "{\"count\": " << total
+       << ", \"mean_ns\": " << mean()
+       << ", \"p50_ns\": " << percentile(50)
+       << ", \"p90_ns\": " << percentile(90)
+       << ", \"p99_ns\": " << percentile(99)
+       << ", \"p999_ns\": " << percentile(99.9)
+       << ", \"max_ns\": " << max_value << "}";
+  }
+
+ private:
+  unsigned long long counts[BUCKETS];
+  unsigned long long total;
+  unsigned long long sum;
+  unsigned long long max_value;
+
+  static int bucket_of(unsigned long long v){
+    if(v < (unsigned long long)LINEAR)
+      return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int sub = (int)((v >> (msb - 3)) & (SUB_BUCKETS - 1));
+    return LINEAR + (msb - 4) * SUB_BUCKETS + sub;
+  }
+
+  static unsigned long long lower_bound_of(int b){
+    if(b < LINEAR)
+      return b;
+    int msb = (b - LINEAR) / SUB_BUCKETS + 4;
+    int sub = (b - LINEAR) % SUB_BUCKETS;
+    return (1ULL << msb) | ((unsigned long long)sub << (msb - 3));
+  }
+};
+
+/**
+ * Average of a value over roughly the last window samples, next to the
+ * lifetime totals. The window is BUCKETS buckets of window / BUCKETS
+ * samples each; when the newest bucket fills, the oldest one is dropped,
+ * so the average covers between 7/8 of the window and the whole window
+ * once that many samples have been added. add() is O(1).
+ */
+class WindowedAverage
+{
+ public:
+  static const int BUCKETS = 8;
+
+ WindowedAverage( ):per_bucket(0),newest(0)
+    {
+      clear();
+    }
+
+  /**
+   * Sets the window to about samples samples and empties it; 0 turns it off.
+   */
+  void resize(unsigned long long samples){
+    per_bucket = samples == 0 ? 0 : (samples + BUCKETS - 1) / BUCKETS;
+    clear();
+  }
+
+  bool enabled() const{
+    return per_bucket > 0;
+  }
+
+  unsigned long long window() const{
+    return per_bucket * BUCKETS;
+  }
+
+  void add(unsigned long long v){
+    if(per_bucket == 0)
+      return;
+    if(count[newest] == per_bucket){
+      newest = (newest + 1) % BUCKETS;
+      count[newest] = 0;
+      sum[newest] = 0;
+    }
+    count[newest]++;
+    sum[newest] += v;
+  }
+
+  double average() const{
+    unsigned long long n = 0, total = 0;
+    for(int i = 0; i < BUCKETS; i++){
+      n += count[i];
+      total += sum[i];
+    }
+    return n > 0 ? (double)total / n : 0;
+  }
+
+ private:
+  unsigned long long per_bucket;
+  int newest;
+  unsigned long long count[BUCKETS];
+  unsigned long long sum[BUCKETS];
+
+  void clear(){
+    newest = 0;
+    for(int i = 0; i < BUCKETS; i++)
+      count[i] = sum[i] = 0;
+  }
+};
+
+/**
+ * Heap footprint of a tree, kept up to date as nodes are made and freed.
+ * Every block (a node, or the heap buffer of a key) is counted twice: the
+ * bytes asked for and the bytes malloc actually reserved for it
+ * (malloc_usable_size); the difference is allocator slack. Each block also
+ * costs malloc a header of HEADER_BYTES (glibc: one size_t).
+ */
+struct MemoryAccount
+{
+  static const int HEADER_BYTES = sizeof(size_t);
+
+  unsigned long long nodes;
+  unsigned long long node_bytes;     // nodes * sizeof(node)
+  unsigned long long node_usable;
+  unsigned long long key_blocks;     // keys with a heap buffer of their own
+  unsigned long long key_bytes;
+  unsigned long long key_usable;
+
+ MemoryAccount( ){
+    clear();
+  }
+
+  void clear(){
+    nodes = node_bytes = node_usable = key_blocks = key_bytes = key_usable = 0;
+  }
+
+  /**
+   * Counts (sign 1) or uncounts (sign -1) a node of node_size bytes at
+   * node, and its key's heap buffer of key_size bytes at key (NULL if none).
+   */
+  void add(int sign, const void *node, size_t node_size, const void *key, size_t key_size){
+    nodes += sign;
+    node_bytes += sign * (long long)node_size;
+    node_usable += sign * (long long)malloc_usable_size((void *)node);
+    if(key != NULL){
+      key_blocks += sign;
+      key_bytes += sign * (long long)key_size;
+      key_usable += sign * (long long)malloc_usable_size((void *)key);
+    }
+  }
+
+  unsigned long long slack() const{
+    return node_usable - node_bytes + key_usable - key_bytes;
+  }
+
+  unsigned long long headers() const{
+    return (nodes + key_blocks) * HEADER_BYTES;
+  }
+
+  /**
+   * Everything the tree holds on the heap, slack and headers included,
+   * plus arena bytes (keys kept in an arena instead of their own blocks).
+   */
+  unsigned long long total(unsigned long long arena = 0) const{
+    return node_usable + key_usable + headers() + arena;
+  }
+
+  /**
+   * Prints the breakdown in the same "(attribute) = (number)" form as
+   * report(). key_size is the bytes of a node that hold its key.
+   */
+  void report(ostream& os, unsigned long long arena, size_t key_size) const{
+    os << "nodes = " << nodes << endl;
+    os << "node bytes = " << node_bytes << endl;
+    os << "key heap bytes = " << key_bytes << " (" << key_blocks << " keys)" << endl;
+    if(arena > 0)
+      os << "key arena bytes = " << arena << endl;
+    os << "allocator slack = " << slack() << endl;
+    os << "allocator headers = " << headers() << endl;
+    os << "per-node overhead = "
+       << (nodes > 0 ? (double)(node_usable + nodes * HEADER_BYTES - nodes * key_size) / nodes : 0) << endl;
+    os << "total bytes = " << total(arena) << endl;
+  }
+};
+
+/**
+ * Hot-path counters kept by AvlTree when EAVL_STATS is defined.
+ * Rotations are counted by AVL case in balance(); a double rotation counts
+ * once as a double and not as its two component single rotations.
+ * Visits count the nodes compared on the way down for each operation.
+ */
+struct AvlStats
+{
+  unsigned long long single_left;     // case 1
+  unsigned long long double_left;     // case 2
+  unsigned long long double_right;    // case 3
+  unsigned long long single_right;    // case 4
+  unsigned long long inserts;
+  unsigned long long insert_visits;
+  unsigned long long removes;
+  unsigned long long remove_visits;
+  unsigned long long finds;
+  unsigned long long find_visits;
+  unsigned long long height_changes;  // nodes whose height changed while retracing
+
+ AvlStats( ):single_left(0),double_left(0),double_right(0),single_right(0),
+    inserts(0),insert_visits(0),removes(0),remove_visits(0),
+    finds(0),find_visits(0),height_changes(0){}
+
+  unsigned long long rotations() const{
+    return single_left + double_left + double_right + single_right;
+  }
+
+  /**
+   * Prints the counters in the same "(attribute) = (number)" form as report().
+   */
+  void report(ostream& os) const{
+    os << "rotations = " << rotations() << endl;
+    os << "  single left (case 1) = " << single_left << endl;
+    os << "  double left (case 2) = " << double_left << endl;
+    os << "  double right (case 3) = " << double_right << endl;
+    os << "  single right (case 4) = " << single_right << endl;
+    os << "average insert path = " << average(insert_visits, inserts) << endl;
+    os << "average remove path = " << average(remove_visits, removes) << endl;
+    os << "average find path = " << average(find_visits, finds) << endl;
+    os << "average rebalancing depth = " << average(height_changes, inserts + removes) << endl;
+  }
+
+  void write_json(ostream& os) const{
+    os << "{\"rotations\": {\"single_left\": " << single_left
+       << ", \"double_left\": " << double_left
+       << ", \"double_right\": " << double_right
+       << ", \"single_right\": " << single_right << "}"
+       << ", \"inserts\": " << inserts
+       << ", \"insert_visits\": " << insert_visits
+       << ", \"removes\": " << removes
+       << ", \"remove_visits\": " << remove_visits
+       << ", \"finds\": " << finds
+       << ", \"find_visits\": " << find_visits
+       << ", \"height_changes\": " << height_changes << "}";
+  }
+
+ private:
+  static double average(unsigned long long total, unsigned long long ops){
+    return ops > 0 ? (double)total / ops : 0;
+  }
+};
+
+#endif
@@ -0,0 +1,276 @@
+//=============================================================
+// Name:  EAVLSTREAM.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by main.cpp (POSIX only)
+// Version: 1.0
+// Description: Streaming command ingestion for the driver. Commands come
+// from stdin or from any number of clients of a local UNIX-domain socket
+// instead of a file; one poll() loop reads whatever each input has ready
+// (non-blocking, up to READ_CHUNK bytes a time), runs every complete line
+// through the driver and sends the responses back as each batch finishes.
+// The tree stays resident across clients.
+//
+//============================================================
+
+#ifndef EAVL_STREAM_H_INCLUDED
+#define EAVL_STREAM_H_INCLUDED
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Set by SIGINT / SIGTERM while a CommandStream runs; the loop then stops
+ * after the batch in hand.
+ */
+inline volatile sig_atomic_t & stream_stop_requested(){
+  static volatile sig_atomic_t stop = 0;
+  return stop;
+}
+
+extern "C" inline void stream_stop_handler(int){
+  stream_stop_requested() = 1;
+}
+
+/**
+ * Routes SIGINT and SIGTERM to stream_stop_handler, without SA_RESTART so
+ * a blocked poll / epoll_wait / io_uring_enter returns EINTR.
+ */
+inline void install_stop_handlers(){
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stream_stop_handler;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+}
+
+/**
+ * Listens on a non-blocking UNIX-domain socket at path, replacing a stale
+ * socket file. Returns the descriptor, or -1 after explaining on err.
+ */
+inline int open_unix_listener(const string & path, ostream & err){
+  sockaddr_un addr;
+  if(path.size() >= sizeof(addr.sun_path)){
+    err << "ERROR: socket path too long: " << path << endl;
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path.c_str());
+  if(fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0){
+    err << "ERROR: cannot listen on " << path << ": " << strerror(errno) << endl;
+    if(fd >= 0)
+      close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+/**
+ * Runs text commands from stdin and socket clients through handler, which
+ * is called as handler(line, from_socket) for every line (without its
+ * newline) and writes responses to cout and errors to cerr, as the file
+ * driver does. It returns false when the client asked to quit. Responses to stdin go to
+ * the real stdout; for a socket client cout and cerr are redirected into
+ * that client's buffer while its lines run and the buffer is sent back.
+ */
+template <typename LineHandler>
+class CommandStream
+{
+ public:
+  static const int READ_CHUNK = 64 * 1024;
+
+ explicit CommandStream(LineHandler h):handler(h),listen_fd(-1){}
+
+  ~CommandStream( ){
+    for(unsigned int i = 0; i < clients.size(); i++)
+      if(clients[i].fd != STDIN_FILENO)
+	close(clients[i].fd);
+    if(listen_fd >= 0){
+      close(listen_fd);
+      unlink(socket_path.c_str());
+    }
+  }
+
+  /**
+   * Reads commands from fd (normally stdin); responses go to cout.
+   */
+  void add_input(int fd){
+    set_nonblocking(fd);
+    clients.push_back(Client(fd, false));
+  }
+
+  /**
+   * Listens on a UNIX-domain socket at path, replacing a stale socket
+   * file. Returns false and explains on err if that fails.
+   */
+  bool listen_unix(const string & path, ostream & err){
+    listen_fd = open_unix_listener(path, err);
+    if(listen_fd < 0)
+      return false;
+    socket_path = path;
+    return true;
+  }
+
+  /**
+   * Serves until every input is closed and there is no socket, or until
+   * SIGINT / SIGTERM. Returns the number of clients served.
+   */
+  int run(){
+    install_stop_handlers();
+    int served = 0;
+    vector<pollfd> fds;
+    while(!stream_stop_requested() && (listen_fd >= 0 || !clients.empty())){
+      fds.clear();
+      for(unsigned int i = 0; i < clients.size(); i++){
+	pollfd p = { clients[i].fd, 0, 0 };
+	if(!clients[i].eof)
+	  p.events |= POLLIN;
+	if(!clients[i].out.empty())
+	  p.events |= POLLOUT;
+	fds.push_back(p);
+      }
+      if(listen_fd >= 0){
+	pollfd p = { listen_fd, POLLIN, 0 };
+	fds.push_back(p);
+      }
+      if(poll(&fds[0], fds.size(), -1) < 0){
+	if(errno == EINTR)
+	  continue;
+	break;
+      }
+      if(listen_fd >= 0 && (fds.back().revents & POLLIN))
+	served += accept_clients();
+      // New clients were appended after the polled ones
+      unsigned int polled = fds.size() - (listen_fd >= 0 ? 1 : 0);
+      for(unsigned int i = 0; i < polled; i++){
+	Client & c = clients[i];
+	if(fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+	  read_batch(c);
+	if(!c.out.empty())
+	  write_pending(c);
+      }
+      // Drop clients that are finished: all input read and all output sent
+      unsigned int kept = 0;
+      for(unsigned int i = 0; i < clients.size(); i++){
+	if(clients[i].eof && clients[i].out.empty()){
+	  if(clients[i].socket)
+	    close(clients[i].fd);
+	} else
+	  clients[kept++] = clients[i];
+      }
+      clients.erase(clients.begin() + kept, clients.end());
+    }
+    return served;
+  }
+
+ private:
+  struct Client
+  {
+    int fd;
+    bool socket;
+    bool eof;
+    string in;     // bytes read but not yet run (a partial last line)
+    string out;    // responses not yet written
+
+  Client(int f, bool s):fd(f),socket(s),eof(false){}
+  };
+
+  LineHandler handler;
+  int listen_fd;
+  string socket_path;
+  vector<Client> clients;
+
+  static void set_nonblocking(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+
+  int accept_clients(){
+    int accepted = 0;
+    for(;;){
+      int fd = accept(listen_fd, NULL, NULL);
+      if(fd < 0)
+	return accepted;
+      set_nonblocking(fd);
+      clients.push_back(Client(fd, true));
+      accepted++;
+    }
+  }
+
+  /**
+   * Reads one chunk from c and runs every complete line in it. At end of
+   * input a last line without a newline is run too, as getline would.
+   */
+  void read_batch(Client & c){
+    char buf[READ_CHUNK];
+    ssize_t n = read(c.fd, buf, sizeof(buf));
+    if(n < 0 && (errno == EAGAIN || errno == EINTR))
+      return;
+    if(n <= 0)
+      c.eof = true;
+    else
+      c.in.append(buf, n);
+    size_t end = c.eof ? c.in.size() : c.in.rfind('\n');
+    if(end == string::npos)
+      return;
+    run_lines(c, c.in.data(), c.in.data() + end);
+    c.in.erase(0, c.eof ? c.in.size() : end + 1);
+  }
+
+  void run_lines(Client & c, const char *p, const char *end){
+    ostringstream replies;
+    streambuf *saved_out = NULL, *saved_err = NULL;
+    if(c.socket){
+      saved_out = cout.rdbuf(replies.rdbuf());
+      saved_err = cerr.rdbuf(replies.rdbuf());
+    }
+    bool open = true;
+    while(p < end && open){
+      const char *nl = (const char *)memchr(p, '\n', end - p);
+      const char *stop = nl != NULL ? nl : end;
+      open = handler(string(p, stop), c.socket);
+      p = stop + 1;
+    }
+    if(c.socket){
+      cout.rdbuf(saved_out);
+      cerr.rdbuf(saved_err);
+      c.out += replies.str();
+    } else
+      cout.flush();
+    if(!open){    // quit: stop reading, finish sending
+      c.eof = true;
+      c.in.clear();
+    }
+  }
+
+  void write_pending(Client & c){
+    if(!c.socket){
+      c.out.clear();
+      return;
+    }
+    ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+    if(n > 0)
+      c.out.erase(0, n);
+    else if(n < 0 && errno != EAGAIN && errno != EINTR){
+      c.out.clear();    // client went away
+      c.eof = true;
+    }
+  }
+};
+
+#endif
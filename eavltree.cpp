@@ -16,29 +16,37 @@
  * Public Methods
  *
  */
-template <typename Comparable>
-const Comparable & AvlTree<Comparable>::find_min( ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+const typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::key_type & AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::find_min( ) const
 {
   return find_min( root )->element;
 }
 
 
-template <typename Comparable>
-const Comparable & AvlTree<Comparable>::find_max( ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+const typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::key_type & AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::find_max( ) const
 {
   return find_max( root )->element;
 }
 
-template <typename Comparable>
-bool AvlTree<Comparable>::contains( const Comparable & x ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+bool AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::contains( const Comparable & x ) const
 {
-  return contains( x, root );
+  const key_type & k = keys.probe(x);
+  if(cache.enabled()){
+    AvlNode *n = cache.lookup(hash<key_type>()(k));
+    if(n != NULL && n->freq > 0 && n->element == k){
+      cache.record_hit();
+      return true;
+    }
+  }
+  return contains( k, root );
 }
 
 
-template <typename Comparable>
-bool  AvlTree<Comparable>::is_empty( ) const{	
-  return root == NULL;
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+bool  AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::is_empty( ) const{	
+  return size_t == 0;    // tombstones do not count
 }
 
 
@@ -49,49 +57,135 @@ bool  AvlTree<Comparable>::is_empty( ) const{
  *
  */
 
-template <typename Comparable>
-void AvlTree<Comparable>::report(){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::report(){
   cout << "size = " << size() << endl;
   cout << "height = " << height() << endl;
   cout << "internal path length = " << int_path_length() << endl;
   cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+  if(recent_visits.enabled())
+    cout << "average number of nodes visited (last " << recent_visits.window() << " finds) = "
+	 << recent_node_visits() << endl;
+  if(cache.enabled())
+    cout << "cache hit rate = " << cache.hit_rate() << endl;
+  if(max_tombstones > 0)
+    cout << "tombstones = " << tombstones << endl;
+  if(allowed_imbalance > AvlRotations<AvlNode>::ALLOWED_IMBALANCE)
+    cout << "unsettled paths = " << unsettled.size() << endl;
+  EAVL_STAT(counters.report(cout));
+}
+
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+const MemoryAccount & AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::memory_usage() const{
+  return memory;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+unsigned long long AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::memory_bytes() const{
+  return memory.total(keys.arena_bytes());
 }
 
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::report_memory(ostream& os) const{
+  memory.report(os, keys.arena_bytes(), sizeof(key_type));
+}
 
-template <typename Comparable>
-int AvlTree<Comparable>::height(){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::height(){
   if( root != NULL){
     return max(height(root->left), height(root->right))+1;   
   }
   return 0;
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::int_path_length(){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+long long AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::int_path_length(){
   return int_path_length(root,0);
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::size(){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::size(){
   return size_t;
 }
 
-template <typename Comparable>
-float AvlTree<Comparable>::avge_node_visits(){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+float AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::avge_node_visits(){
   if(finds > 0 && nodes_visited > 0)
-    return (float)nodes_visited / finds;
+    return (float)((double)nodes_visited / finds);
   else
     return 0;
 }
 
-template <typename Comparable>
-void AvlTree<Comparable>::display(ostream& os){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::set_stats_window(unsigned long long window){
+  recent_visits.resize(window);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+double AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::recent_node_visits(){
+  return recent_visits.enabled() ? recent_visits.average() : avge_node_visits();
+}
+
+#ifdef EAVL_STATS
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+const AvlStats & AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::stats() const{
+  return counters;
+}
+#endif
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::display(ostream& os){
   print_tree(os);
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::find(const Comparable &x, int &freq){
-  return find(x,freq,root);   
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::find(const Comparable &x, Freq &freq){
+  if(!unsettled.empty())
+    settle(1);
+  const key_type & k = keys.probe(x);
+  if(cache.enabled()){
+    AvlNode *n = cache.lookup(hash<key_type>()(k));
+    if(n != NULL && n->freq > 0 && n->element == k){
+      cache.record_hit();
+      freq = n->freq;
+      if(BalancePolicy::weighted)
+	n->hits++;
+      note_operation();
+      return 0;
+    }
+  }
+  int visited = finger_on ? finger_find(k,freq) : find(k,freq,root);
+  note_operation();
+  return visited;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::lookup(const Comparable &x, Freq &freq) const{
+  const key_type & k = keys.probe(x);
+  int visited = 0;
+  AvlNode* t = root;
+  while(t != NULL){
+    if(k < t->element)
+      t = t->left;
+    else if(t->element < k)
+      t = t->right;
+    else {
+      if(t->freq > 0)    // not a tombstone
+	freq = t->freq;
+      return visited;
+    }
+    visited++;
+  }
+  return visited;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::count_finds(unsigned long long n, unsigned long long visited){
+  finds += n;
+  nodes_visited += visited;
+  EAVL_STAT(counters.finds += n);
+  EAVL_STAT(counters.find_visits += visited);
 }
 
 /**
@@ -100,8 +194,8 @@ int AvlTree<Comparable>::find(const Comparable &x, int &freq){
  */
 
 
-template <typename Comparable>
-void AvlTree<Comparable>::print_tree(ostream& os)
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::print_tree(ostream& os)
 {
   if( is_empty( ) )
     os << "Empty tree" << endl;
@@ -110,105 +204,203 @@ void AvlTree<Comparable>::print_tree(ostream& os)
 }
 
 
-template <typename Comparable>
-void AvlTree<Comparable>::make_empty( )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::make_empty( )
 {
+  cache.clear();
+  finger_cut(0);
+  export_open = false;
   make_empty( root );
+  keys.clear();
+  memory.clear();
+  unsettled.clear();
+  size_t = 0;
+  tombstones = 0;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::insert( const Comparable & x )
+{
+  EAVL_STAT(counters.inserts++);
+  Freq freq = finger_on ? finger_insert( keys.probe(x), x ) : insert( keys.probe(x), x, root );
+  note_unbalanced(x);
+  note_operation();
+  return freq;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::insert( Comparable && x )
+{
+  if(allowed_imbalance > 1)
+    return insert( static_cast<const Comparable &>(x) );    // x may need queuing after the insert; counted there
+  EAVL_STAT(counters.inserts++);
+  const key_type & k = keys.probe(x);
+  Freq freq = finger_on ? finger_insert( k, std::move(x) ) : insert( k, std::move(x), root );
+  note_operation();
+  return freq;
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::insert( const Comparable & x )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+template <typename... Args>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::emplace( Args&&... args )
 {
-  return insert( x, root );
+  return insert( Comparable( std::forward<Args>(args)... ) );
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::remove( const Comparable & x )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::remove( const Comparable & x )
 {
-  return remove(x,root);
+  EAVL_STAT(counters.removes++);
+  finger_cut(0);
+  Freq freq = remove(keys.probe(x),root);
+  note_unbalanced(x);
+  if(tombstones > max_tombstones * (size_t + tombstones))
+    compact();
+  return freq;
 }
 
 /**
  * Private methods
  *
  */
-template <typename Comparable>	
-int AvlTree<Comparable>::insert( const Comparable & x, AvlNode * & t)
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>	
+template <typename Source>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::insert( const key_type & x, Source && src, AvlNode * & t)
 {
-  int freq = 1;
+  Freq freq = 1;
+  EAVL_STAT(if(t != NULL) counters.insert_visits++);
   if( t == NULL ){
-    t = new AvlNode(x,NULL,NULL);
+    t = new AvlNode(keys.make(std::forward<Source>(src)),NULL,NULL);
+    account(1, t);
     size_t++;
   } else if( x == t->element){
-    t->freq = t->freq++;
+    if(t->freq == 0){    // revive a tombstone
+      t->freq = 1;
+      tombstones--;
+      size_t++;
+    } else
+      t->freq++;
     freq = t->freq;
+    if(!BalancePolicy::weighted)
+      return freq;
   }
   else if( x < t->element ){
-    freq = insert( x, t->left );
+    int before = height(t->left);
+    freq = insert( x, std::forward<Source>(src), t->left );
+    // A subtree that kept its height leaves every balance above it as it was
+    if(!BalancePolicy::weighted && height(t->left) == before)
+      return freq;
   }
   else if( t->element < x ){
-    freq = insert( x, t->right );
+    int before = height(t->right);
+    freq = insert( x, std::forward<Source>(src), t->right );
+    if(!BalancePolicy::weighted && height(t->right) == before)
+      return freq;
   }
   balance(t);
   t->height = max(height(t->left),height(t->right))+1;
   return freq;
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::remove( const Comparable & x, AvlNode * & t )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::remove( const key_type & x, AvlNode * & t )
 {
-  int freq = 0;
+  Freq freq = 0;
   if( t == NULL)
     return -1;   // Item not found; do nothing
+  EAVL_STAT(counters.remove_visits++);
   
-  if( x < t->element )
+  if( x < t->element ){
+    int before = height(t->left);
     freq = remove( x, t->left );
-  else if( t->element < x )
+    if(!BalancePolicy::weighted && height(t->left) == before)
+      return freq;    // as in insert: nothing above changes
+  }
+  else if( t->element < x ){
+    int before = height(t->right);
     freq = remove( x, t->right );
+    if(!BalancePolicy::weighted && height(t->right) == before)
+      return freq;
+  }
   else
     {
+      if(t->freq <= 0)    // tombstone, already removed
+	return -1;
       t->freq--;
-      if( t->left != NULL & t->right != NULL) // Two children
-	{	   
-	  if(t->freq <= 0){
-	    t->element = find_min( t->right )->element;
-	    t->freq = find_min(t->right)->freq;
-	    remove( t->element, t->right );
-	  }
-	}
-      else
-	{
-	  freq = t->freq;
-	  if(t->freq < 1){
-	    AvlNode *old_node = t;
-	    t = ( t->left != NULL ) ? t->left : t->right;
-	    delete old_node;
-	    size_t--;
+      freq = t->freq;
+      if(t->freq < 1 && max_tombstones > 0){
+	tombstones++;
+	size_t--;
+      }
+      else if(t->freq < 1){
+	AvlNode *old_node = t;
+	if(cache.enabled())
+	  cache.invalidate(hash<key_type>()(old_node->element), old_node);
+	if( t->left != NULL && t->right != NULL) // Two children
+	  {
+	    // Relink the successor node in t's place; no element is copied.
+	    AvlNode *successor = detach_min( t->right );
+	    successor->left = t->left;
+	    successor->right = t->right;
+	    t = successor;
 	  }
-	} 
+	else
+	  t = ( t->left != NULL ) ? t->left : t->right;
+	account(-1, old_node);
+	delete old_node;
+	size_t--;
+      }
     }
   
   balance( t );
   return freq;
 }
 
-template <typename Comparable>
-int AvlTree<Comparable>::int_path_length(AvlNode*& t, int val){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::AvlNode * AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::detach_min( AvlNode * & t )
+{
+  EAVL_STAT(counters.remove_visits++);
+  if( t->left == NULL ){
+    AvlNode *min = t;
+    t = t->right;
+    return min;
+  }
+  AvlNode *min = detach_min( t->left );
+  balance( t );
+  return min;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+long long AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::int_path_length(AvlNode*& t, int val){
   if(t == NULL){
     return 0;
   }
+  if(pool != NULL && t->height >= PARALLEL_HEIGHT){
+    long long lt, rt;
+    pool->fork_join([&](){ lt = int_path_length(t->left,val+1); }, [&](){ rt = int_path_length(t->right,val+1); });
+    return val + lt + rt;
+  }
   return val + int_path_length(t->left,val+1)+int_path_length(t->right,val+1);
 }   
 
-template <typename Comparable>
-int AvlTree<Comparable>::find(const Comparable &x, int& freq, AvlNode* r){
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::find(const key_type &x, Freq& freq, AvlNode* r){
   finds++;
+  EAVL_STAT(counters.finds++);
   int visited = 0;
   AvlNode* t = r;
   while(t != NULL){
-    if(t->element == x){       
+    if(t->element == x && t->freq == 0){    // tombstone
+      break;
+    }else if(t->element == x){       
       freq = t->freq;
+      if(BalancePolicy::weighted)
+	t->hits++;
+      if(cache.enabled())
+	cache.store(hash<key_type>()(x), t);
       nodes_visited += visited;
+      recent_visits.add(visited);
+      EAVL_STAT(counters.find_visits += visited);
       return visited;
     }else if(t->element > x){
       t = t->left;
@@ -218,38 +410,529 @@ int AvlTree<Comparable>::find(const Comparable &x, int& freq, AvlNode* r){
     visited++;
   }
   nodes_visited+=visited;
+  recent_visits.add(visited);
+  EAVL_STAT(counters.find_visits += visited);
   return visited;
 }
 
-// Assume t is balanced or within one of being balanced
-template <typename Comparable>
-void AvlTree<Comparable>::balance(AvlNode * & t )
-{
-  if( t == NULL )
-    return;
-  
-  if( height( t->left ) - height( t->right ) > ALLOWED_IMBALANCE ){
-    if( height( t->left->left ) >= height( t->left->right ) ){
-      rotate_with_left_child( t );
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::set_task_pool(TaskPool *p){
+  pool = p;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::set_lazy_delete(double fraction){
+  max_tombstones = fraction > 0 ? fraction : 0;
+  if(max_tombstones == 0)
+    compact();
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::compact(){
+  if(tombstones == 0)
+    return 0;
+  vector<AvlNode*> nodes;
+  nodes.reserve(size_t + tombstones);
+  flatten(root, nodes);
+  unsigned int live = 0;
+  for(unsigned int i = 0; i < nodes.size(); i++){
+    if(nodes[i]->freq > 0)
+      nodes[live++] = nodes[i];
+    else {
+      account(-1, nodes[i]);
+      delete nodes[i];
     }
-    else{
-      double_with_left_child( t );}
   }
-  else{
-    if( height( t->right ) - height( t->left ) > ALLOWED_IMBALANCE ){
-      if( height( t->right->right ) >= height( t->right->left ) ){
-	rotate_with_right_child( t );
-      }
-      else{
-	double_with_right_child( t );
+  nodes.resize(live);
+  cache.clear();
+  finger_cut(0);
+  root = build_balanced(nodes, 0, live);
+  int removed = tombstones;
+  tombstones = 0;
+  return removed;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::set_relaxed(int imbalance){
+  if(imbalance < AvlRotations<AvlNode>::ALLOWED_IMBALANCE)
+    imbalance = AvlRotations<AvlNode>::ALLOWED_IMBALANCE;
+  bool was_relaxed = allowed_imbalance > AvlRotations<AvlNode>::ALLOWED_IMBALANCE;
+  allowed_imbalance = imbalance;
+  if(was_relaxed && imbalance == AvlRotations<AvlNode>::ALLOWED_IMBALANCE){
+    // settling the queued paths may miss nodes rotations moved off them
+    vector<AvlNode*> nodes;
+    nodes.reserve(size_t + tombstones);
+    flatten(root, nodes);
+    cache.clear();
+    finger_cut(0);
+    root = build_balanced(nodes, 0, nodes.size());
+    unsettled.clear();
+  }
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::settle(int paths){
+  int rotations = 0;
+  while(!unsettled.empty() && paths-- != 0){
+    rotations += settle(keys.probe(unsettled.back()), root);
+    unsettled.pop_back();
+  }
+  if(rotations > 0){
+    cache.clear();
+    finger_cut(0);
+  }
+  return rotations;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::unsettled_count() const{
+  return unsettled.size();
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+bool AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::check(ostream & err) const{
+  int live = 0, dead = 0;
+  if(!check(root, NULL, NULL, live, dead, err))
+    return false;
+  if(live != size_t){
+    err << "size " << size_t << " but " << live << " live nodes" << endl;
+    return false;
+  }
+  if(dead != tombstones || (dead > 0 && max_tombstones == 0)){
+    err << "tombstone count " << tombstones << " but " << dead << " nodes of frequency 0" << endl;
+    return false;
+  }
+  if(memory.nodes != (unsigned long long)(live + dead)){
+    err << "memory accounts for " << memory.nodes << " nodes but the tree has " << live + dead << endl;
+    return false;
+  }
+  return true;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+bool AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::check(const AvlNode *t, const key_type *lo, const key_type *hi, int & live, int & dead, ostream & err) const{
+  if(t == NULL)
+    return true;
+  if((lo != NULL && !(*lo < t->element)) || (hi != NULL && !(t->element < *hi))){
+    err << "key " << t->element << " out of order" << endl;
+    return false;
+  }
+  if(t->freq < 0){
+    err << "key " << t->element << " has frequency " << t->freq << endl;
+    return false;
+  }
+  if(t->freq > 0)
+    live++;
+  else
+    dead++;
+  if(!check(t->left, lo, &t->element, live, dead, err) || !check(t->right, &t->element, hi, live, dead, err))
+    return false;
+  int lh = AvlRotations<AvlNode>::height(t->left), rh = AvlRotations<AvlNode>::height(t->right);
+  if(t->height != max(lh, rh) + 1){
+    err << "key " << t->element << " has height " << t->height << ", should be " << max(lh, rh) + 1 << endl;
+    return false;
+  }
+  if(!BalancePolicy::weighted && (lh - rh > allowed_imbalance || rh - lh > allowed_imbalance)){
+    err << "key " << t->element << " is out of balance: left height " << lh << ", right height " << rh << endl;
+    return false;
+  }
+  return true;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::tombstone_count(){
+  return tombstones;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::set_finger(bool on){
+  finger_on = on && !BalancePolicy::weighted;    // weighted inserts rotate off the finger's path
+  finger_cut(0);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::finger_walk(const key_type &x){
+  int visited = 0;
+  if(finger.empty()){
+    if(root == NULL)
+      return 0;
+    finger_push(root, NULL, NULL);
+  }
+  // Up: until x lies inside the range of the subtree in hand
+  while(finger.size() > 1 &&
+	((finger_lo.back() != NULL && !(*finger_lo.back() < x)) ||
+	 (finger_hi.back() != NULL && !(x < *finger_hi.back())))){
+    finger_cut(finger.size() - 1);
+    visited++;
+  }
+  // Down: an ordinary search from there
+  for(;;){
+    AvlNode *t = finger.back();
+    if(x == t->element)
+      break;
+    const key_type *lo = finger_lo.back(), *hi = finger_hi.back();
+    AvlNode *next;
+    if(x < t->element){
+      next = t->left;
+      hi = &t->element;
+    } else {
+      next = t->right;
+      lo = &t->element;
+    }
+    if(next == NULL)
+      break;
+    finger_push(next, lo, hi);
+    visited++;
+  }
+  return visited;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::finger_find(const key_type &x, Freq &freq){
+  finds++;
+  EAVL_STAT(counters.finds++);
+  int visited = finger_walk(x);
+  if(!finger.empty()){
+    AvlNode *t = finger.back();
+    if(!(t->element == x))
+      visited++;    // stepped off the tree, as find counts a miss
+    else if(t->freq > 0){
+      freq = t->freq;
+      if(BalancePolicy::weighted)
+	t->hits++;
+      if(cache.enabled())
+	cache.store(hash<key_type>()(x), t);
+    }
+  }
+  nodes_visited += visited;
+  recent_visits.add(visited);
+  EAVL_STAT(counters.find_visits += visited);
+  return visited;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+template <typename Source>
+Freq AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::finger_insert(const key_type &x, Source &&src){
+  if(root == NULL)
+    return insert(x, std::forward<Source>(src), root);
+#ifdef EAVL_STATS
+  counters.insert_visits += finger_walk(x) + 1;
+#else
+  finger_walk(x);
+#endif
+  AvlNode *t = finger.back();
+  if(x == t->element){
+    if(t->freq == 0){    // revive a tombstone
+      t->freq = 1;
+      tombstones--;
+      size_t++;
+    } else
+      t->freq++;
+    return t->freq;
+  }
+  // x may be src itself, so compare before the key is made
+  bool go_left = x < t->element;
+  AvlNode *n = new AvlNode(keys.make(std::forward<Source>(src)),NULL,NULL);
+  account(1, n);
+  size_t++;
+  if(go_left){
+    t->left = n;
+    finger_push(n, finger_lo.back(), &t->element);
+  } else {
+    t->right = n;
+    finger_push(n, &t->element, finger_hi.back());
+  }
+  // Rebalance bottom up, as the recursive insert does on its way back. Once
+  // a subtree keeps its height (always so after a rotation) nothing above
+  // it changes, so the walk stops there.
+  for(int k = finger.size() - 2; k >= 0; k--){
+    AvlNode *&link = finger_link(k);
+    int old_height = link->height;
+    balance(link);
+    if(link != finger[k]){    // rotated: re-extend the finger from the new subtree root
+      const key_type *lo = finger_lo[k], *hi = finger_hi[k];
+      finger_cut(k);
+      finger_push(link, lo, hi);
+      finger_walk(n->element);
+      break;
+    }
+    if(link->height == old_height)
+      break;
+  }
+  return 1;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::AvlNode *&
+AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::finger_link(int k){
+  if(k == 0)
+    return root;
+  AvlNode *p = finger[k - 1];
+  return p->left == finger[k] ? p->left : p->right;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::finger_push(AvlNode *t, const key_type *lo, const key_type *hi){
+  finger.push_back(t);
+  finger_lo.push_back(lo);
+  finger_hi.push_back(hi);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::finger_cut(unsigned int levels){
+  finger.resize(levels);
+  finger_lo.resize(levels);
+  finger_hi.resize(levels);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::AvlNode *
+AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::build_balanced(vector<AvlNode*>& nodes, int lo, int hi){
+  if(lo >= hi)
+    return NULL;
+  int mid = lo + (hi - lo) / 2;
+  AvlNode *t = nodes[mid];
+  t->left = build_balanced(nodes, lo, mid);
+  t->right = build_balanced(nodes, mid + 1, hi);
+  t->height = max(height(t->left), height(t->right)) + 1;
+  return t;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::set_cache_size(int entries){
+  cache.resize(entries);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+template <typename Visitor>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::in_order(Visitor visit) const{
+  in_order(root, visit);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+template <typename Visitor>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::in_order(AvlNode *t, Visitor & visit) const{
+  if(t != NULL){
+    in_order(t->left, visit);
+    if(t->freq > 0)
+      visit(t->element, t->freq);
+    in_order(t->right, visit);
+  }
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::export_begin(){
+  export_open = true;
+  export_last.clear();
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+template <typename Visitor>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::export_next(int n, Visitor visit){
+  if(!export_open)
+    return 0;
+  // The stack holds the nodes still to visit whose left subtrees are done:
+  // those on the path to the first key past export_last where it went left.
+  vector<AvlNode*> stack;
+  AvlNode *t = root;
+  while(t != NULL){
+    if(export_last.empty() || export_last[0] < t->element){
+      stack.push_back(t);
+      t = t->left;
+    }else
+      t = t->right;
+  }
+  int visited = 0;
+  AvlNode *last = NULL;
+  while(visited < n && !stack.empty()){
+    last = stack.back();
+    stack.pop_back();
+    for(AvlNode *c = last->right; c != NULL; c = c->left)
+      stack.push_back(c);
+    if(last->freq > 0){    // not a tombstone
+      visit(last->element, last->freq);
+      visited++;
+    }
+  }
+  if(stack.empty())
+    export_open = false;
+  else if(last != NULL)
+    export_last.assign(1, last->element);    // one key copied per chunk
+  return visited;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+bool AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::exporting() const{
+  return export_open;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::assign_sorted(vector<pair<Comparable, Freq> > & items){
+  make_empty();
+  root = build_sorted(items, 0, items.size());
+  size_t = items.size();
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::merge_sorted(vector<pair<Comparable, Freq> > & items, vector<Freq> & before){
+  vector<AvlNode*> nodes, merged;
+  nodes.reserve(size_t + tombstones);
+  flatten(root, nodes);
+  merged.reserve(nodes.size() + items.size());
+  before.assign(items.size(), 0);
+  unsigned int n = 0;
+  for(unsigned int i = 0; i < items.size(); i++){
+    const key_type & k = keys.probe(items[i].first);
+    while(n < nodes.size() && nodes[n]->element < k)
+      merged.push_back(nodes[n++]);
+    if(n < nodes.size() && !(k < nodes[n]->element)){
+      AvlNode *t = nodes[n++];
+      before[i] = t->freq;
+      if(t->freq == 0){    // revive a tombstone
+	tombstones--;
+	size_t++;
       }
+      t->freq += items[i].second;
+      merged.push_back(t);
+    } else {
+      merged.push_back(new AvlNode(keys.make(std::move(items[i].first)), NULL, NULL, 0, items[i].second));
+      account(1, merged.back());
+      size_t++;
     }
-  }   
-  t -> height = max( height( t->left ), height( t->right ) ) + 1;
+    EAVL_STAT(counters.inserts += items[i].second);
+  }
+  while(n < nodes.size())
+    merged.push_back(nodes[n++]);
+  cache.clear();
+  finger_cut(0);
+  root = build_balanced(merged, 0, merged.size());
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::AvlNode *
+AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::build_sorted(vector<pair<Comparable, Freq> > & items, int lo, int hi){
+  if(lo >= hi)
+    return NULL;
+  int mid = lo + (hi - lo) / 2;
+  AvlNode *left = build_sorted(items, lo, mid);
+  AvlNode *t = new AvlNode(keys.make(std::move(items[mid].first)), left, NULL, 0, items[mid].second);
+  account(1, t);
+  t->right = build_sorted(items, mid + 1, hi);
+  t->height = max(height(t->left), height(t->right)) + 1;
+  return t;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::note_operation(){
+  if(BalancePolicy::rebuild_due(++ops_since_rebuild, size_t))
+    rebuild_by_weight();
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::rebuild_by_weight(){
+  vector<AvlNode*> nodes;
+  nodes.reserve(size_t);
+  finger_cut(0);
+  flatten(root, nodes);
+  vector<long long> prefix(nodes.size() + 1, 0);
+  // Without a weighted policy every node weighs the same, so each root is
+  // the range's median and the result keeps the AVL height invariant.
+  for(unsigned int i = 0; i < nodes.size(); i++){
+    prefix[i + 1] = prefix[i] + (BalancePolicy::weighted ? nodes[i]->freq + nodes[i]->hits : 1);
+    nodes[i]->hits /= 2;
+  }
+  root = build_weighted(nodes, prefix, 0, nodes.size());
+  ops_since_rebuild = 0;
 }
 
-template <typename Comparable>
-bool AvlTree<Comparable>::contains( const Comparable & x, AvlNode *t ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::flatten(AvlNode *t, vector<AvlNode*>& nodes) const{
+  if(t != NULL){
+    flatten(t->left, nodes);
+    nodes.push_back(t);
+    flatten(t->right, nodes);
+  }
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+typename AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::AvlNode *
+AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::build_weighted(vector<AvlNode*>& nodes, const vector<long long>& prefix, int lo, int hi){
+  if(lo >= hi)
+    return NULL;
+  // Root is the node whose weight covers the midpoint of the range's total
+  // weight (bisection rule), so a node of weight w ends up at depth O(log(W/w)).
+  long long half = prefix[lo] + (prefix[hi] - prefix[lo]) / 2;
+  int mid = upper_bound(prefix.begin() + lo + 1, prefix.begin() + hi + 1, half) - prefix.begin() - 1;
+  if(mid >= hi)
+    mid = hi - 1;
+  AvlNode *t = nodes[mid];
+  t->left = build_weighted(nodes, prefix, lo, mid);
+  t->right = build_weighted(nodes, prefix, mid + 1, hi);
+  t->height = max(height(t->left), height(t->right)) + 1;
+  return t;
+}
+
+// Assume t is balanced or within one of being balanced
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::balance(AvlNode * & t, int allowed )
+{
+#ifdef EAVL_STATS
+  int old_height = t == NULL ? -1 : t->height;
+  switch(AvlRotations<AvlNode>::balance( t, allowed )){
+  case SINGLE_LEFT: counters.single_left++; break;
+  case DOUBLE_LEFT: counters.double_left++; break;
+  case DOUBLE_RIGHT: counters.double_right++; break;
+  case SINGLE_RIGHT: counters.single_right++; break;
+  case NO_ROTATION: break;
+  }
+  if(t != NULL && t->height != old_height)
+    counters.height_changes++;
+#else
+  AvlRotations<AvlNode>::balance( t, allowed );
+#endif
+  // Updates move a balance by one, so 2 is where t just left strict balance
+  if(allowed > 1 && t != NULL && abs(height(t->left) - height(t->right)) == 2)
+    left_unbalanced = true;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::note_unbalanced(const Comparable &x){
+  if(!left_unbalanced)
+    return;
+  left_unbalanced = false;
+  unsettled.push_back(x);
+  if(unsettled.size() > MAX_UNSETTLED)
+    settle(1);    // a long write burst settles as it goes
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::settle(const key_type &x, AvlNode *&t){
+  if(t == NULL)
+    return 0;
+  int rotations = 0;
+  if(x < t->element)
+    rotations = settle(x, t->left);
+  else if(t->element < x)
+    rotations = settle(x, t->right);
+  return rotations + tighten(t);
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::tighten(AvlNode *&t){
+  int rotations = 0;
+  t->height = max(height(t->left), height(t->right)) + 1;
+  while(abs(height(t->left) - height(t->right)) > 1){
+    balance(t, 1);
+    rotations++;
+    // the rotation moved t's old root (and, doubled, a grandchild) down
+    rotations += tighten(t->left) + tighten(t->right);
+    t->height = max(height(t->left), height(t->right)) + 1;
+  }
+  return rotations;
+}
+
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+bool AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::contains( const key_type & x, AvlNode *t ) const
 {
   if( t == NULL )
     return false;
@@ -258,75 +941,78 @@ bool AvlTree<Comparable>::contains( const Comparable & x, AvlNode *t ) const
   else if( t->element < x )
     return contains( x, t->right );
   else
-    return true;    // Match
+    return t->freq > 0;    // Match, unless a tombstone
 }
 
-template <typename Comparable>
-void AvlTree<Comparable>::make_empty( AvlNode * & t )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::make_empty( AvlNode * & t )
 {
   if( t != NULL )
     {
-      make_empty( t->left );
-      make_empty( t->right );
+      if( pool != NULL && t->height >= PARALLEL_HEIGHT )
+	pool->fork_join([&](){ make_empty( t->left ); }, [&](){ make_empty( t->right ); });
+      else
+	{
+	  make_empty( t->left );
+	  make_empty( t->right );
+	}
       delete t;
     }
   t = NULL;
 }
-template <typename Comparable>
-void AvlTree<Comparable>::print_tree( AvlNode *t, ostream& os ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::print_tree( AvlNode *t, ostream& os ) const
 {
-  if( t != NULL )
+  if( t != NULL && pool != NULL && t->height >= PARALLEL_HEIGHT )
+    {
+      // The right subtree prints into its own buffer, appended once both halves are done.
+      ostringstream right;
+      pool->fork_join([&](){ print_tree( t->left, os ); }, [&](){ print_tree( t->right, right ); });
+      if( t->freq > 0 )
+	os << t->element << endl;
+      os << right.str();
+    }
+  else if( t != NULL )
     {
       print_tree( t->left, os );
-      os << t->element << endl;
+      if( t->freq > 0 )
+	os << t->element << endl;
       print_tree( t->right, os );
     }
 }
 
 // Avl manipulations
 
-template <typename Comparable>
-int AvlTree<Comparable>::height( AvlNode *t ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::height( AvlNode *t ) const
 {
-  return t == NULL ? -1 : t->height;
+  return AvlRotations<AvlNode>::height( t );
 }
-template <typename Comparable>
-int AvlTree<Comparable>::max( int lhs, int rhs ) const
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+int AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::max( int lhs, int rhs ) const
 {
   return lhs > rhs ? lhs : rhs;
 }
-template <typename Comparable>
-void AvlTree<Comparable>::rotate_with_left_child( AvlNode * & k2 )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::rotate_with_left_child( AvlNode * & k2 )
 {
-  AvlNode *k1 = k2->left;
-  k2->left = k1->right;
-  k1->right = k2;
-  k2->height = max( height( k2->left ), height( k2->right ) ) + 1;
-  k1->height = max( height( k1->left ), k2->height ) + 1;
-  k2 = k1;
+  AvlRotations<AvlNode>::rotate_with_left_child( k2 );
 }
 
-template <typename Comparable>
-void AvlTree<Comparable>::rotate_with_right_child( AvlNode * & k1 )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::rotate_with_right_child( AvlNode * & k1 )
 {
-  AvlNode *k2 = k1->right;
-  k1->right = k2->left;
-  k2->left = k1;
-  k1->height = max( height( k1->left ), height( k1->right ) ) + 1;
-  k2->height = max( height( k2->right ), k1->height ) + 1;
-  k1 = k2;
+  AvlRotations<AvlNode>::rotate_with_right_child( k1 );
 }
 
-template <typename Comparable>
-void AvlTree<Comparable>::double_with_left_child( AvlNode * & k3 )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::double_with_left_child( AvlNode * & k3 )
 {
-  rotate_with_right_child( k3->left );
-  rotate_with_left_child( k3 );
+  AvlRotations<AvlNode>::double_with_left_child( k3 );
 }
 
-template <typename Comparable>
-void AvlTree<Comparable>::double_with_right_child( AvlNode * & k1 )
+template <typename Comparable, typename BalancePolicy, typename KeyStorage, typename Freq>
+void AvlTree<Comparable, BalancePolicy, KeyStorage, Freq>::double_with_right_child( AvlNode * & k1 )
 {
-  rotate_with_left_child( k1->right );
-  rotate_with_right_child( k1 );
+  AvlRotations<AvlNode>::double_with_right_child( k1 );
 }
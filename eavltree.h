@@ -14,13 +14,30 @@
 #define AVL_TREE_H_INCLUDED
 
 #include <algorithm>
+#include <functional>
+#include <sstream>
+#include <type_traits>
+#include <utility>
 #include <iostream> 
+#include <vector>
+#include "eavlstats.h"
+#include "eavlpolicy.h"
+#include "eavlcache.h"
+#include "eavlkeys.h"
+#include "eavlpool.h"
+#include "eavlrotate.h"
 
 using namespace std;
 
 // (E)AvlTree class
 //
 // CONSTRUCTION: zero parameter
+// BalancePolicy: AvlBalance (strict AVL, default) or FrequencyBalance
+//                (periodic rebuild weighted by freq and find hits), see eavlpolicy.h
+// KeyStorage:    DirectKeys<Comparable> (key stored in the node, default) or, for
+//                strings, ArenaKeys (key bytes interned in a tree-owned arena), see eavlkeys.h
+// Freq:          signed integer type of the per-key frequency (default int; long long
+//                for keys inserted more than 2^31 times). remove returns -1 for absent keys.
 //
 // ******************PUBLIC OPERATIONS*********************
 // void insert( x )       --> Insert x
@@ -34,39 +51,56 @@ using namespace std;
 //
 
 
-template <typename Comparable>
+template <typename Comparable, typename BalancePolicy = AvlBalance, typename KeyStorage = DirectKeys<Comparable>, typename Freq = int>
 class AvlTree
 {
+  static_assert(is_integral<Freq>::value && is_signed<Freq>::value, "Freq must be a signed integer type");
   
  public:
+  // What a node stores for its key: Comparable itself unless KeyStorage interns it.
+  typedef typename KeyStorage::key_type key_type;
+  typedef Freq freq_type;
+
   // Enhanced default constructor, total finds/size/nodes_visited = 0
- AvlTree( ):root(NULL),size_t(0),finds(0.0),nodes_visited(0.0){}
+ AvlTree( ):root(NULL),size_t(0),finds(0),nodes_visited(0),ops_since_rebuild(0),tombstones(0),max_tombstones(0),pool(NULL),finger_on(false),
+    allowed_imbalance(AvlRotations<AvlNode>::ALLOWED_IMBALANCE),left_unbalanced(false),export_open(false){}
   
- AvlTree( const AvlTree & rhs ):root(NULL)
+ AvlTree( const AvlTree & rhs ):root(NULL),size_t(0),finds(0),nodes_visited(0),ops_since_rebuild(0),tombstones(0),max_tombstones(0),pool(rhs.pool),finger_on(false),
+    allowed_imbalance(AvlRotations<AvlNode>::ALLOWED_IMBALANCE),left_unbalanced(false),export_open(false)
     {
       *this = rhs;
     }
   
   /**
-   * Deep copy.
+   * Deep copy. With ArenaKeys the copy shares rhs's key arena instead of
+   * copying every key.
    */
   AvlTree & operator=( const AvlTree & rhs )
     {
       if(this != &rhs){
 	make_empty();
+	keys = rhs.keys;
 	root = clone(rhs.root);
+	recount(root);
+	size_t = rhs.size_t;
+	tombstones = rhs.tombstones;
+	max_tombstones = rhs.max_tombstones;
+	allowed_imbalance = rhs.allowed_imbalance;
+	unsettled = rhs.unsettled;
       }
      return *this;
     }
   /*
-   * Find the smallest item in the tree
+   * Find the smallest item in the tree; tombstones are skipped. The tree
+   * must not be empty.
    */
-  const Comparable & find_min() const;
+  const key_type & find_min() const;
   
 /**
- * Find the largest item in the tree. 
+ * Find the largest item in the tree; tombstones are skipped. The tree must
+ * not be empty.
  */
-  const Comparable & find_max( ) const;
+  const key_type & find_max( ) const;
   /**
    * Returns true if x is found in the tree.
    */
@@ -99,7 +133,7 @@ class AvlTree
   /**
    * Returns the internal path length of the tree. 
    */
-  int int_path_length();
+  long long int_path_length();
   /**
    * Returns the size (number of nodes) in the tree. 
    * This is a class variable and is accounted for during insertion and deletion.
@@ -109,8 +143,48 @@ class AvlTree
   /**
    * Returns the average number of nodes visited per find operation
    * finds and nodes_visited are accounted for in the find function.
+   * Both are 64 bit, so the lifetime average stays exact for billions of finds.
    */
   float avge_node_visits();
+
+  /**
+   * Also keep the average nodes visited over roughly the last window finds
+   * (see WindowedAverage), which report() prints after the lifetime one.
+   * 0 (the default) turns the window off.
+   */
+  void set_stats_window(unsigned long long window);
+
+  /**
+   * Average nodes visited per find over the window, or the lifetime average
+   * when no window is set.
+   */
+  double recent_node_visits();
+
+  /**
+   * Heap bytes held by the tree's nodes and key buffers, slack included
+   * (see MemoryAccount); kept up to date on every insert and remove.
+   */
+  const MemoryAccount & memory_usage() const;
+
+  /**
+   * All heap bytes of the tree: memory_usage().total() plus the key arena.
+   */
+  unsigned long long memory_bytes() const;
+
+  /**
+   * Prints the memory breakdown: node bytes, key heap (and arena) bytes,
+   * allocator slack and headers, per-node overhead beyond the key, and the
+   * total. report() leaves memory out; its figures depend on the allocator.
+   */
+  void report_memory(ostream& os) const;
+
+#ifdef EAVL_STATS
+  /**
+   * Rotation, path length and rebalancing counters gathered so far.
+   * Only present when built with EAVL_STATS.
+   */
+  const AvlStats & stats() const;
+#endif
   
   /**
    * Displays the tree in order from lowests to highests. (0,1,2...)(A,B,a,b...)
@@ -121,7 +195,21 @@ class AvlTree
   * Find function for the tree. 
   * Returns the number of nodes visited and a variable is updated to view the current frequency of the item.
   */
-  int find(const Comparable &x, int &freq);
+  int find(const Comparable &x, Freq &freq);
+
+  /**
+   * find without side effects: statistics, the cache, hit counts and the
+   * finger are left alone, so any number of threads may look up at once
+   * while nothing writes the tree. Returns the nodes visited and sets freq
+   * as find does. Hand the counts to count_finds() to have them reported.
+   */
+  int lookup(const Comparable &x, Freq &freq) const;
+
+  /**
+   * Adds n finds that visited visited nodes in all (made with lookup) to
+   * the lifetime statistics.
+   */
+  void count_finds(unsigned long long n, unsigned long long visited);
   
   /**
    * END ENCHANCED PUBLIC METHODS
@@ -143,31 +231,208 @@ class AvlTree
   /**
   * Insert x into the tree; duplicates increase frequency.
   */
-  int insert(const Comparable &x);
+  Freq insert(const Comparable &x);
+
+  /**
+  * Insert x, moving it into the new node if x is not already present.
+  */
+  Freq insert(Comparable &&x);
+
+  /**
+  * Insert the Comparable built from args; it is constructed once and moved
+  * into the new node, never copied.
+  */
+  template <typename... Args>
+  Freq emplace(Args&&... args);
   
   /**
    * Remove x from the tree. Returns -1 if x is not found.
    */
-  int remove(const Comparable &x);
+  Freq remove(const Comparable &x);
+
+  /**
+   * Rebuild the whole tree into a weight-balanced BST where a node weighs
+   * its freq plus its find hits: each subtree root is the key that splits
+   * the subtree's weight most evenly. Called automatically by the
+   * FrequencyBalance policy. Under a policy that is not weighted (AvlBalance)
+   * every node weighs 1, so the result is perfectly balanced and later
+   * rotations can rely on its heights.
+   */
+  void rebuild_by_weight();
+
+  /**
+   * Put a hot-key cache of about entries nodes in front of find and contains.
+   * A find answered by the cache visits no tree nodes and is not counted in
+   * avge_node_visits(), which stays the average over real tree walks.
+   * 0 (the default) turns the cache off; resizing empties it.
+   */
+  void set_cache_size(int entries);
+
+  /**
+   * Calls visit(key, freq) for every node, in sorted order.
+   */
+  template <typename Visitor>
+  void in_order(Visitor visit) const;
+
+  /**
+   * Chunked export, for dumping a large tree without one long blocking
+   * call. export_begin() puts the cursor before the smallest key, then
+   * each export_next(n, visit) calls visit(key, freq) for the next n keys
+   * in sorted order and returns how many it visited, 0 once the export is
+   * done. Other operations may run between chunks: each chunk rebuilds its
+   * explicit stack from the last key exported (O(log n) nodes), so keys
+   * removed before the cursor reaches them are skipped and keys inserted
+   * ahead of it are included. make_empty() ends the export.
+   */
+  void export_begin();
+
+  template <typename Visitor>
+  int export_next(int n, Visitor visit);
+
+  /**
+   * True from export_begin() until export_next() has visited every key.
+   */
+  bool exporting() const;
+
+  /**
+   * Replace the contents of the tree with items: (key, frequency) pairs
+   * sorted by key without duplicates. Keys are moved out of items. The
+   * result is perfectly balanced and built in linear time.
+   */
+  void assign_sorted(vector<pair<Comparable, Freq> > & items);
+
+  /**
+   * Bulk insert: items are (key, count) pairs sorted by key without
+   * duplicates, each standing for count inserts of key. They are merged
+   * with the tree's nodes in one pass and the result is relinked perfectly
+   * balanced, in time linear in size() plus items.size(). Keys are moved
+   * out of items; before[i] is set to items[i]'s frequency beforehand (0
+   * if absent or a tombstone).
+   */
+  void merge_sorted(vector<pair<Comparable, Freq> > & items, vector<Freq> & before);
+
+  /**
+   * Let clone (copies), make_empty, print_tree and int_path_length split
+   * subtrees taller than PARALLEL_HEIGHT across the workers of p. NULL (the
+   * default) keeps them sequential. p must outlive its use by the tree.
+   */
+  void set_task_pool(TaskPool *p);
+
+  /**
+   * Lazy deletion. With fraction > 0, a remove that takes a key's frequency
+   * to 0 leaves the node in place as a tombstone, which find, contains,
+   * display and size() treat as absent and a later insert revives. Once
+   * tombstones exceed fraction of all nodes the tree is compacted.
+   * 0 (the default) unlinks nodes immediately. Turning it off compacts.
+   */
+  void set_lazy_delete(double fraction);
+
+  /**
+   * Drops every tombstone and rebuilds the remaining nodes into a perfectly
+   * balanced tree in linear time. Returns the number of tombstones removed.
+   */
+  int compact();
+
+  /**
+   * Returns the number of tombstones currently in the tree.
+   */
+  int tombstone_count();
+
+  /**
+   * Finger search. When on, insert and find start from the path to the key
+   * accessed last instead of from the root: they climb that path until the
+   * subtree in hand must hold the key, then search down from there, so a
+   * key d positions away from the previous one costs O(log d) nodes rather
+   * than O(log n). Visits counted include the climb. remove and anything
+   * that rebuilds the tree drop the finger. Off by default, and stays off
+   * under a weighted BalancePolicy, whose inserts rotate without keeping a
+   * finger.
+   */
+  void set_finger(bool on);
+
+  /**
+   * Relaxed balance. With imbalance > 1, insert and remove only rotate a
+   * node whose subtree heights differ by more than imbalance (the tree is
+   * an HB[imbalance] tree, whose height stays within about 1.81 log2 n for
+   * 2 and 2.15 log2 n for 3, against 1.44 log2 n for AVL). The rebalancing
+   * this skips is deferred: the key of every update that left a node
+   * between 1 and imbalance out of balance is queued, and settle() later
+   * rebalances those paths to strict AVL. Each find settles one queued path,
+   * so read-mostly phases pay off a write burst's debt. 1 (the default) is
+   * strict AVL; turning relaxation off rebuilds the tree perfectly balanced.
+   */
+  void set_relaxed(int imbalance);
+
+  /**
+   * Rebalances up to paths queued paths (all of them if paths < 0) to
+   * strict AVL balance and returns the rotations made.
+   */
+  int settle(int paths = -1);
+
+  /**
+   * Number of update paths still waiting for settle().
+   */
+  int unsettled_count() const;
+
+  /**
+   * Checks the tree's invariants: keys in strictly increasing order, every
+   * stored height correct, every node within the allowed imbalance (AVL
+   * policy only; weighted rebuilds are not height balanced), size() and
+   * tombstone_count() matching the nodes, and every node accounted for in
+   * memory_usage(). Describes the first problem on err.
+   */
+  bool check(ostream & err) const;
   
  private:
   struct AvlNode
   {
-    Comparable element;
+    key_type element;
     AvlNode *left;
     AvlNode * right;
     int height;
-    int freq;
+    Freq freq;
+    int hits;
     // Enhanced node has a frequency, default is 1 because if the node exists there must be a frequency.
+    // hits counts successful finds and is only maintained by weighted policies.
     
-  AvlNode(const Comparable &ele, AvlNode *lt, AvlNode *rt, int h = 0, int q = 1) : element(ele),left(lt),right(rt),height(h), freq(q){}
+  AvlNode(const key_type &ele, AvlNode *lt, AvlNode *rt, int h = 0, Freq q = 1) : element(ele),left(lt),right(rt),height(h), freq(q), hits(0){}
+  AvlNode(key_type &&ele, AvlNode *lt, AvlNode *rt, int h = 0, Freq q = 1) : element(std::move(ele)),left(lt),right(rt),height(h), freq(q), hits(0){}
     
   };
   
   AvlNode* root;
   int size_t;
-  int finds;
-  int nodes_visited;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+  WindowedAverage recent_visits;
+  int ops_since_rebuild;
+  int tombstones;
+  double max_tombstones;
+  mutable HotKeyCache<AvlNode> cache;
+  KeyStorage keys;
+  TaskPool *pool;
+  bool finger_on;
+  int allowed_imbalance;
+  bool left_unbalanced;            // the last balance() left |bf| > 1 (relaxed only)
+  vector<Comparable> unsettled;    // keys of update paths to settle
+  MemoryAccount memory;
+  // The finger: the path from the root to the node accessed last, and the
+  // open key range each of those subtrees covers (NULL is unbounded).
+  vector<AvlNode*> finger;
+  vector<const key_type*> finger_lo;
+  vector<const key_type*> finger_hi;
+  // The export cursor: the last key export_next() passed, once it has
+  // started (a vector, so key_type needs no default constructor).
+  bool export_open;
+  vector<key_type> export_last;
+
+  // Subtrees at least this tall (roughly 2^12 nodes and up) are forked.
+  static const int PARALLEL_HEIGHT = 12;
+  // Past this many queued paths each relaxed update settles one itself.
+  static const unsigned int MAX_UNSETTLED = 1 << 16;
+#ifdef EAVL_STATS
+  AvlStats counters;
+#endif
   
   
   /**
@@ -180,9 +445,13 @@ class AvlTree
    * == Enhanced ==
    * Updates frequency, if need be, of x in the tree.
    * Returns the frequency of x in the tree.
+   * x is the key compared on the way down; src is what a new node's key is
+   * made from (forwarded, so an rvalue is moved). With DirectKeys x may be
+   * src itself, so x is not used once src has been consumed.
    * 
    */
-  int insert(const Comparable &x, AvlNode *&t);
+  template <typename Source>
+  Freq insert(const key_type &x, Source &&src, AvlNode *&t);
   
   /**
    * Internal method to remove from a subtree.
@@ -192,13 +461,21 @@ class AvlTree
    *
    * == Enhanced ==
    * 
-   * If we remove x and x still has a frequency above 0, do nothing.  * If less, some pointer manipulation and remove recursively
+   * If we remove x and x still has a frequency above 0, do nothing.
+   * If less, unlink the node; a node with two children is replaced by its
+   * successor node, which is detached and relinked rather than copied.
    * Set 0 as a  placeholder, if we haven't found x it remains 0 andis returned
    * Using that information we can say we did not find x at all.
    * Returns the frequency of x in the tree, even if now 0.
    * 
    */
-  int remove(const Comparable &x, AvlNode *&t);
+  Freq remove(const key_type &x, AvlNode *&t);
+
+  /**
+   * Unlinks the smallest node of subtree t, rebalancing on the way back up,
+   * and returns it. t must not be NULL.
+   */
+  AvlNode * detach_min(AvlNode *&t);
   
   /**
    *
@@ -211,7 +488,7 @@ class AvlTree
    * Returns the internal path length of the tree.
    * Add 1 for every node inbetween the highest nodes and the root.
    */
-  int int_path_length(AvlNode*& t, int val);
+  long long int_path_length(AvlNode*& t, int val);
 
   /**
    * Returns the number of nodes visited during a find operation.
@@ -220,40 +497,154 @@ class AvlTree
    * If the item is not found, freq will not change.
    *
    */
-  int find(const Comparable &x, int& freq, AvlNode *r);
+  int find(const key_type &x, Freq& freq, AvlNode *r);
+
+  /**
+   * Called after every insert and find; asks the policy whether enough
+   * operations have passed to rebuild by weight.
+   */
+  void note_operation();
+
+  /**
+   * Adds (sign 1) or takes away (sign -1) node n and its key in memory.
+   */
+  void account(int sign, const AvlNode *n){
+    std::size_t key_bytes = 0;
+    const void *key = key_heap_block(n->element, key_bytes);
+    memory.add(sign, n, sizeof(AvlNode), key, key_bytes);
+  }
+
+  /**
+   * Counts every node of subtree t into memory (after a clone).
+   */
+  void recount(const AvlNode *t){
+    if(t != NULL){
+      account(1, t);
+      recount(t->left);
+      recount(t->right);
+    }
+  }
+
+  /**
+   * Appends the nodes of subtree t to nodes in sorted order.
+   */
+  void flatten(AvlNode *t, vector<AvlNode*>& nodes) const;
+
+  /**
+   * Links nodes[lo, hi) into a weight-balanced subtree and returns its root.
+   * prefix[i] is the total weight of nodes[0, i).
+   */
+  AvlNode * build_weighted(vector<AvlNode*>& nodes, const vector<long long>& prefix, int lo, int hi);
+
+  /**
+   * Links nodes[lo, hi) into a perfectly balanced subtree and returns its root.
+   */
+  AvlNode * build_balanced(vector<AvlNode*>& nodes, int lo, int hi);
+
+  /**
+   * Builds a balanced subtree holding items[lo, hi) and returns its root.
+   */
+  AvlNode * build_sorted(vector<pair<Comparable, Freq> > & items, int lo, int hi);
+
+  template <typename Visitor>
+  void in_order(AvlNode *t, Visitor & visit) const;
+
+  /**
+   * check() for subtree t, keys strictly between lo and hi (NULL is
+   * unbounded); counts its live and tombstone nodes.
+   */
+  bool check(const AvlNode *t, const key_type *lo, const key_type *hi, int & live, int & dead, ostream & err) const;
+
+  /**
+   * Climbs the finger to the deepest node whose subtree must hold x, then
+   * extends it down toward x. The finger ends at x's node, or at the node
+   * x would hang from. Returns the number of nodes moved through.
+   */
+  int finger_walk(const key_type &x);
+
+  /**
+   * find and insert starting from the finger; see set_finger.
+   */
+  int finger_find(const key_type &x, Freq &freq);
+
+  template <typename Source>
+  Freq finger_insert(const key_type &x, Source &&src);
+
+  /**
+   * Returns the link (root or a child pointer) that points at finger[k].
+   */
+  AvlNode *& finger_link(int k);
+
+  void finger_push(AvlNode *t, const key_type *lo, const key_type *hi);
+
+  // Cuts the finger back to its first levels nodes.
+  void finger_cut(unsigned int levels);
   /**
    * ==========================
    * END ENHANCHED PRIVATE METHODS
    */
   
-  static const int ALLOWED_IMBALANCE = 1;
-  
   // Assume t is balanced or within one of being balanced
-  void balance(AvlNode*& t);
+  void balance(AvlNode*& t){
+    balance(t, allowed_imbalance);
+  }
+
+  /**
+   * Rotates t if its subtree heights differ by more than allowed; a
+   * relaxed call (allowed > 1) that leaves t just out of strict balance
+   * sets left_unbalanced.
+   */
+  void balance(AvlNode*& t, int allowed);
+
+  /**
+   * Queues x's path for settle() if the update just made left a node out
+   * of strict balance.
+   */
+  void note_unbalanced(const Comparable &x);
+
+  /**
+   * Settles the path to x: strictly rebalances every node on it, bottom up.
+   * Returns the rotations made.
+   */
+  int settle(const key_type &x, AvlNode *&t);
+
+  /**
+   * Rotates t until it and, recursively, the nodes its rotations move down
+   * are within one of balanced. Returns the rotations made.
+   */
+  int tighten(AvlNode *&t);
   
   /**
    * Internal method to find the smallest item in a subtree t.
-   * Return node containing the smallest item.
+   * Return node containing the smallest item that is not a tombstone, or
+   * NULL. Tombstoned subtrees are walked in order, so this costs the
+   * tombstones passed on the way.
    */
   
   AvlNode * find_min( AvlNode *t ) const{
     
     if( t == NULL )
       return NULL;
-    if( t->left == NULL )
+    AvlNode *m = find_min( t->left );
+    if( m != NULL )
+      return m;
+    if( t->freq > 0 )
       return t;
-    return find_min( t->left );
+    return find_min( t->right );
   }
   /**
    * Internal method to find the largest item in a subtree t.
-   * Return node containing the largest item.
+   * Return node containing the largest item that is not a tombstone, or NULL.
    */ 
   AvlNode * find_max( AvlNode *t ) const{
-    if( t != NULL )
-      while( t->right != NULL )
-	t = t->right;
-    return t;
-    
+    if( t == NULL )
+      return NULL;
+    AvlNode *m = find_max( t->right );
+    if( m != NULL )
+      return m;
+    if( t->freq > 0 )
+      return t;
+    return find_max( t->left );
   }
   
   /**
@@ -261,7 +652,7 @@ class AvlTree
    * x is item to search for.
    * t is the node that roots the tree.
    */
-  bool contains( const Comparable & x, AvlNode *t ) const;
+  bool contains( const key_type & x, AvlNode *t ) const;
   
   /**
    * Internal method to make subtree empty.
@@ -277,15 +668,21 @@ class AvlTree
   
   /**
    * Internal method to clone subtree.
+   * Tall subtrees clone their two children in parallel when a pool is set.
    */
   AvlNode * clone( AvlNode *t ) const{
     if( t == NULL )
       return NULL;
+    else if( pool != NULL && t->height >= PARALLEL_HEIGHT ){
+      AvlNode *lt, *rt;
+      pool->fork_join([&](){ lt = clone( t->left ); }, [&](){ rt = clone( t->right ); });
+      return new AvlNode(t->element, lt, rt, t->height, t->freq);
+    }
     else
-      return new AvlNode(t->element, clone( t->left ), clone( t->right ), t->height);
+      return new AvlNode(t->element, clone( t->left ), clone( t->right ), t->height, t->freq);
   }
   
-  // Avl manipulations
+  // Avl manipulations, shared with AvlMap through AvlRotations (eavlrotate.h)
   
   /**
    * Return the height of node t or -1 if NULL.
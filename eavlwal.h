@@ -0,0 +1,431 @@
+//=============================================================
+// Name:  EAVLWAL.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included by main.cpp (POSIX only)
+// Version: 1.0
+// Description: Optional durability for an AvlTree of strings: an append-only
+// write-ahead log of inserts and removes with group commit, binary
+// checkpoint snapshots of the tree, and recovery that loads the latest
+// snapshot and replays only the log records after it.
+//
+//============================================================
+
+#ifndef EAVL_WAL_H_INCLUDED
+#define EAVL_WAL_H_INCLUDED
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "eavlkeys.h"
+
+using namespace std;
+
+/**
+ * Bytes of a stored key, whichever KeyStorage the tree uses.
+ */
+inline string_view key_view(const string & k){
+  return string_view(k);
+}
+
+inline string_view key_view(const ArenaString & k){
+  return k.view();
+}
+
+/**
+ * FNV-1a, used to detect torn or corrupt records and snapshots.
+ */
+inline uint32_t wal_checksum(const char *p, size_t n, uint32_t h = 2166136261u){
+  for(size_t i = 0; i < n; i++){
+    h ^= (unsigned char)p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/**
+ * Append-only log of tree mutations. A record is
+ *   lsn (8 bytes) | op (1 byte, 'i' or 'r') | key length (4) | key | checksum (4)
+ * in host byte order. Records are buffered and written with one fdatasync
+ * per group of group_size records (group commit); commit() forces a sync.
+ * Records not yet committed are lost if the process dies, so a recovered
+ * tree always equals the tree after some prefix of the logged mutations.
+ */
+class WriteAheadLog
+{
+ public:
+ WriteAheadLog( ):fd(-1),group_size(1),pending(0),next(1),syncs(0){}
+
+  ~WriteAheadLog( ){
+    close();
+  }
+
+  /**
+   * Opens (creating if needed) the log at path for appending; the next
+   * record gets sequence number next_lsn. Returns false on error.
+   */
+  bool open(const string & path, int group, unsigned long long next_lsn){
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    group_size = group > 0 ? group : 1;
+    next = next_lsn;
+    return fd >= 0;
+  }
+
+  /**
+   * Logs one mutation and commits if the group is full. Returns false if
+   * that commit failed.
+   */
+  bool append(char op, string_view key){
+    unsigned long long lsn = next++;
+    uint32_t len = key.size();
+    size_t start = buffer.size();
+    buffer.append((const char *)&lsn, sizeof(lsn));
+    buffer.push_back(op);
+    buffer.append((const char *)&len, sizeof(len));
+    buffer.append(key.data(), key.size());
+    uint32_t sum = wal_checksum(buffer.data() + start, buffer.size() - start);
+    buffer.append((const char *)&sum, sizeof(sum));
+    if(++pending >= group_size)
+      return commit();
+    return true;
+  }
+
+  /**
+   * Writes buffered records and waits for them to reach the disk. If a
+   * write or the fdatasync fails, reports it and returns false with the
+   * records still buffered: they are not durable and must not be counted
+   * as committed.
+   */
+  bool commit(){
+    if(buffer.empty())
+      return true;
+    if(fd < 0){
+      cerr << "ERROR: write-ahead log is not open" << endl;
+      return false;
+    }
+    size_t done = 0;
+    while(done < buffer.size()){
+      ssize_t n = ::write(fd, buffer.data() + done, buffer.size() - done);
+      if(n < 0){
+	if(errno == EINTR)
+	  continue;
+	cerr << "ERROR: write-ahead log write failed: " << strerror(errno) << endl;
+	return false;
+      }
+      done += n;
+    }
+    if(fdatasync(fd) != 0){
+      cerr << "ERROR: write-ahead log fdatasync failed: " << strerror(errno) << endl;
+      return false;
+    }
+    syncs++;
+    buffer.clear();
+    pending = 0;
+    return true;
+  }
+
+  /**
+   * Empties the log once a checkpoint covers every record in it. Returns
+   * false, reporting why, if the commit, ftruncate or fdatasync fails.
+   */
+  bool truncate(){
+    if(!commit())
+      return false;
+    if(ftruncate(fd, 0) != 0){
+      cerr << "ERROR: write-ahead log ftruncate failed: " << strerror(errno) << endl;
+      return false;
+    }
+    if(fdatasync(fd) != 0){
+      cerr << "ERROR: write-ahead log fdatasync failed: " << strerror(errno) << endl;
+      return false;
+    }
+    return true;
+  }
+
+  void close(){
+    if(fd >= 0){
+      commit();
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  unsigned long long last_lsn() const{
+    return next - 1;
+  }
+
+  unsigned long long sync_count() const{
+    return syncs;
+  }
+
+  /**
+   * Calls apply(op, key) for every intact record of the log at path whose
+   * sequence number is above after_lsn, stops at the first torn or corrupt
+   * record and cuts the file there so new records follow intact ones.
+   * Returns the highest sequence number seen (after_lsn if none).
+   */
+  template <typename Apply>
+  static unsigned long long replay(const string & path, unsigned long long after_lsn, Apply apply){
+    ifstream in(path.c_str(), ios::binary);
+    if(!in.is_open())
+      return after_lsn;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    const size_t HEADER = sizeof(unsigned long long) + 1 + sizeof(uint32_t);
+    unsigned long long last = after_lsn;
+    size_t pos = 0;
+    while(data.size() - pos >= HEADER){
+      unsigned long long lsn;
+      uint32_t len, sum;
+      memcpy(&lsn, data.data() + pos, sizeof(lsn));
+      char op = data[pos + sizeof(lsn)];
+      memcpy(&len, data.data() + pos + sizeof(lsn) + 1, sizeof(len));
+      if(data.size() - pos - HEADER < (size_t)len + sizeof(sum))
+	break;
+      memcpy(&sum, data.data() + pos + HEADER + len, sizeof(sum));
+      if(sum != wal_checksum(data.data() + pos, HEADER + len))
+	break;
+      if(lsn > last){
+	apply(op, string(data.data() + pos + HEADER, len));
+	last = lsn;
+      }
+      pos += HEADER + len + sizeof(sum);
+    }
+    if(pos < data.size())
+      ::truncate(path.c_str(), pos);
+    return last;
+  }
+
+ private:
+  int fd;
+  int group_size;
+  int pending;
+  unsigned long long next;
+  unsigned long long syncs;
+  string buffer;
+
+  WriteAheadLog(const WriteAheadLog &);
+  WriteAheadLog & operator=(const WriteAheadLog &);
+};
+
+/**
+ * Writes a binary snapshot of t, covering log records up to lsn, to path.
+ * Format: "EAVLSNP1" | lsn | count | count x (key length | key | freq) | checksum;
+ * freq is Tree::freq_type, so int for the default AvlTree.
+ * The snapshot is written to path.tmp, synced and renamed over path, so a
+ * crash leaves either the old or the new snapshot; then path's directory
+ * is synced so the rename is on disk. Returns false if any step fails.
+ */
+template <typename Tree>
+bool save_snapshot(const Tree & t, const string & path, unsigned long long lsn){
+  string data("EAVLSNP1");
+  unsigned long long count = 0;
+  data.append((const char *)&lsn, sizeof(lsn));
+  data.append((const char *)&count, sizeof(count));
+  t.in_order([&](const typename Tree::key_type & k, typename Tree::freq_type freq){
+      string_view v = key_view(k);
+      uint32_t len = v.size();
+      data.append((const char *)&len, sizeof(len));
+      data.append(v.data(), v.size());
+      data.append((const char *)&freq, sizeof(freq));
+      count++;
+    });
+  memcpy(&data[8 + sizeof(lsn)], &count, sizeof(count));
+  uint32_t sum = wal_checksum(data.data(), data.size());
+  data.append((const char *)&sum, sizeof(sum));
+
+  string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0)
+    return false;
+  size_t done = 0;
+  while(done < data.size()){
+    ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+    if(n < 0 && errno == EINTR)
+      continue;
+    if(n < 0){
+      ::close(fd);
+      return false;
+    }
+    done += n;
+  }
+  bool synced = fsync(fd) == 0;
+  ::close(fd);
+  if(!synced || rename(tmp.c_str(), path.c_str()) != 0)
+    return false;
+  // The rename is only durable once the directory entry is.
+  string::size_type slash = path.rfind('/');
+  string parent = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  int dir = ::open(parent.c_str(), O_RDONLY | O_DIRECTORY);
+  if(dir < 0)
+    return false;
+  synced = fsync(dir) == 0;
+  ::close(dir);
+  return synced;
+}
+
+/**
+ * Loads the snapshot at path into t (replacing its contents) and sets lsn.
+ * Returns false, leaving t alone, if there is no intact snapshot.
+ */
+template <typename Tree>
+bool load_snapshot(Tree & t, const string & path, unsigned long long & lsn){
+  ifstream in(path.c_str(), ios::binary);
+  if(!in.is_open())
+    return false;
+  string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  const size_t HEADER = 8 + 2 * sizeof(unsigned long long);
+  uint32_t sum;
+  if(data.size() < HEADER + sizeof(sum) || data.compare(0, 8, "EAVLSNP1") != 0)
+    return false;
+  memcpy(&sum, data.data() + data.size() - sizeof(sum), sizeof(sum));
+  if(sum != wal_checksum(data.data(), data.size() - sizeof(sum)))
+    return false;
+  unsigned long long count;
+  memcpy(&lsn, data.data() + 8, sizeof(lsn));
+  memcpy(&count, data.data() + 8 + sizeof(lsn), sizeof(count));
+  vector<pair<string, typename Tree::freq_type> > items;
+  items.reserve(count);
+  size_t pos = HEADER;
+  for(unsigned long long i = 0; i < count; i++){
+    uint32_t len;
+    typename Tree::freq_type freq;
+    memcpy(&len, data.data() + pos, sizeof(len));
+    pos += sizeof(len);
+    string key(data.data() + pos, len);
+    pos += len;
+    memcpy(&freq, data.data() + pos, sizeof(freq));
+    pos += sizeof(freq);
+    items.push_back(make_pair(std::move(key), freq));
+  }
+  t.assign_sorted(items);
+  return true;
+}
+
+/**
+ * Durability for a driver's tree: a directory holding "wal" and "snapshot".
+ * Every mutation is logged before it is applied; every checkpoint_every
+ * mutations the tree is snapshotted and the log emptied.
+ */
+template <typename Tree>
+class TreeLog
+{
+ public:
+ TreeLog(const string & directory, int group, int checkpoint_every)
+   :dir(directory),group_size(group),period(checkpoint_every),since_checkpoint(0){}
+
+  /**
+   * Rebuilds t from the latest snapshot plus the log tail and opens the log
+   * for appending. Reports what was recovered on os. Returns false if the
+   * directory or log cannot be used.
+   */
+  bool recover(Tree & t, ostream & os){
+    mkdir(dir.c_str(), 0755);
+    unsigned long long snap_lsn = 0;
+    bool have_snapshot = load_snapshot(t, snapshot_path(), snap_lsn);
+    unsigned long long replayed = 0;
+    unsigned long long last = WriteAheadLog::replay(wal_path(), snap_lsn, [&](char op, const string & key){
+	if(op == 'i')
+	  t.insert(key);
+	else
+	  t.remove(key);
+	replayed++;
+      });
+    since_checkpoint = replayed;
+    os << "recovered: snapshot lsn " << snap_lsn << (have_snapshot ? "" : " (none)")
+       << ", replayed " << replayed << " log records, lsn " << last << endl;
+    if(!wal.open(wal_path(), group_size, last + 1)){
+      cerr << "ERROR: cannot open write-ahead log in " << dir << endl;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Logs a mutation; call before applying it to the tree. Stops the
+   * process if the log cannot be made durable (see stop()).
+   */
+  void record(char op, string_view key){
+    if(!wal.append(op, key))
+      stop();
+  }
+
+  /**
+   * Call after applying a logged mutation; checkpoints when one is due.
+   */
+  void applied(const Tree & t){
+    if(period > 0 && ++since_checkpoint >= (unsigned long long)period)
+      checkpoint(t);
+  }
+
+  /**
+   * Commits the log, snapshots t and empties the log. The log is only
+   * truncated once the snapshot and its directory entry are synced, so the
+   * truncate cannot reach the disk ahead of the rename. If the process dies
+   * between the rename and the truncate, recovery skips the log records
+   * the snapshot already covers.
+   */
+  void checkpoint(const Tree & t){
+    if(!wal.commit())
+      stop();
+    if(save_snapshot(t, snapshot_path(), wal.last_lsn())){
+      if(!wal.truncate())
+	stop();
+      since_checkpoint = 0;
+    } else
+      cerr << "ERROR: checkpoint to " << snapshot_path() << " failed" << endl;
+  }
+
+  /**
+   * Commits anything still buffered; stops the process if it cannot.
+   */
+  void commit(){
+    if(!wal.commit())
+      stop();
+  }
+
+  unsigned long long sync_count() const{
+    return wal.sync_count();
+  }
+
+ private:
+  string dir;
+  int group_size;
+  int period;
+  unsigned long long since_checkpoint;
+  WriteAheadLog wal;
+
+  string wal_path() const{
+    return dir + "/wal";
+  }
+
+  string snapshot_path() const{
+    return dir + "/snapshot";
+  }
+
+  /**
+   * The log could not be written, synced or truncated, so mutations past
+   * the last good commit are not durable. Going on would acknowledge more
+   * of them; instead the process ends at once, before the mutation being
+   * logged is applied, with status 2 (a normal driver run exits 1). Other
+   * threads may be inside the tree, so no destructors run.
+   */
+  void stop(){
+    cout.flush();
+    cerr << "ERROR: write-ahead log in " << dir << " failed; stopping" << endl;
+    _exit(2);
+  }
+};
+
+#endif
@@ -2,7 +2,7 @@
 // Name        : main.cpp
 // Author      : William Widmer
 // Created     : March 2014
-// Build       : g++ main.cpp
+// Build       : g++ main.cpp eavlinst.cpp
 //               or simply with attached makefile: make and run with ./eavl.out
 // Version     : 1.0
 // Description : Main file for Assignment two, Spring 2014 CSCI 335 Professor Weiss
@@ -12,33 +12,221 @@
 //============================================================================
 
 
-#include "eavltree.cpp"
+#include "eavltree.h"
+#include <string>
+// AvlTree<string> is compiled once, in eavlinst.cpp
+extern template class AvlTree<std::string>;
+#include "eavlengine.cpp"
+#include "eavlwal.h"
+#include "eavlstream.h"
+#include "eavlserve.h"
+#include "eavlcmdlog.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <cstdarg>
 #include <sstream>
+#ifdef EAVL_STATS
+#include <chrono>
+#include <map>
+#endif
 
 using namespace std;
 
 vector<string> simple_tokenizer(string line);
 void driver(string line);
+void run_line(const string & line);
+void replay(const string & input);
+void bulk_driver(const string & input);
+void run_inserts(vector<string_view> & run);
+bool run_command(char op, const string & key);
+void export_chunk(bool rest);
+int stream_driver(const string & socket_path, bool from_stdin);
+int serve_driver(const string & socket_path, bool uring);
 bool eavl_driver(string error_line,string cmd, ...);
-AvlTree<string> t; 
+EngineAdapter<string, AvlTree<string> > avl("avl");
+AvlTree<string> & t = avl.tree();
+TreeEngine<string> *engine = &avl;
+TreeLog<AvlTree<string> > *wal = NULL;
+TaskPool *pool = NULL;
+int export_keys = 0;    // --export=N: display prints N keys per command
+// --bulk: runs of inserts this long or longer are sorted and merged into the tree
+const unsigned int BULK_MIN = 4096;
+// and a run is cut at this many inserts to bound memory
+const unsigned int BULK_MAX = 1 << 22;
+#ifdef EAVL_STATS
+void print_stats(ostream& os, bool json);
+map<string, LatencyHistogram> latencies;
+#endif
 
 /**
- * Main function. Requires an argument (path to a file).
+ * Main function. Requires an argument (path to a file), or - to read
+ * commands from stdin as they arrive, or --socket=PATH.
  * Will only accept first argument as a path to a file others ignored.
+ * Options, which may come before the path:
+ *   --socket=PATH serve commands from clients of a UNIX-domain socket at PATH (and
+ *                 stdin too if - is given, after the file if one is) until SIGINT /
+ *                 SIGTERM; quit closes only the client that sent it
+ *   --serve[=PATH] serve many clients at once on a UNIX-domain socket at PATH (default
+ *                 eavl.sock), text or binary commands, finds in parallel on the
+ *                 --threads pool; after the file if one is given (see eavlserve.h)
+ *   --io=epoll    with --serve, use epoll instead of io_uring
+ *   --convert=OUT write the file's commands to OUT as a binary command log (see
+ *                 eavlcmdlog.h) instead of running them; a command log given as the
+ *                 file is replayed
+ *   --dict        with --convert, store each distinct key once in a dictionary
+ *   --bulk        runs of inserts are sorted (in parallel on the --threads pool),
+ *                 counted and merged into the tree in one linear pass; prints the
+ *                 same insert lines, but the tree ends up shaped differently
+ *   --cache[=N]   put a hot-key cache of N nodes (default 1024) in front of find
+ *   --wal=DIR     log inserts and removes to DIR/wal and recover the tree from
+ *                 DIR/snapshot plus the log on start (see eavlwal.h); if the log
+ *                 cannot be written or synced the driver stops with status 2
+ *   --group=N     group commit: fdatasync the log once per N mutations (default 64)
+ *   --checkpoint=N  snapshot the tree and empty the log every N mutations (default 100000)
+ *   --threads=N   run display, report and quit (tree teardown) on N threads
+ *   --lazy[=F]    lazy deletion: removed keys become tombstones, compacted once
+ *                 they exceed fraction F of the nodes (default 0.25)
+ *   --relaxed[=K] relaxed balance: updates only rotate nodes more than K (default 2)
+ *                 out of balance and queue the rest for find or settle to fix
+ *   --window=N    report also prints the average nodes visited over the last N finds
+ *   --finger      finger search: insert and find start from the last key accessed,
+ *                 cheaper when consecutive keys are close in sorted order
+ *   --export=N    display streams the tree instead of printing it in one call: N keys
+ *                 after display and after each later command, the rest at quit or the
+ *                 end of input (not with --socket or --serve)
+ *   --engine=NAME run the commands on another balanced tree: avl (default), rb
+ *                 (red-black), wavl (weak AVL), bf (AVL with balance factors instead
+ *                 of heights), btree or bplus (B+ tree). The options above
+ *                 only apply to avl.
  */
 int main(int argc, char* argv[] ){
-  if(argc < 2){
+  vector<string> files;
+  string wal_dir;
+  int group = 64;
+  int checkpoint = 100000;
+  bool avl_only = false;
+  string socket_path;
+  string serve_path;
+  bool uring = true;
+  string convert_path;
+  bool dictionary = false;
+  bool bulk = false;
+  for(int i = 1; i < argc; i++){
+    string arg = argv[i];
+    if(arg.compare(0, 9, "--socket=") == 0){
+      socket_path = arg.substr(9);
+    } else if(arg == "--serve"){
+      serve_path = "eavl.sock";
+      avl_only = true;
+    } else if(arg.compare(0, 8, "--serve=") == 0){
+      serve_path = arg.substr(8);
+      avl_only = true;
+    } else if(arg.compare(0, 10, "--convert=") == 0){
+      convert_path = arg.substr(10);
+    } else if(arg == "--bulk"){
+      bulk = true;
+      avl_only = true;
+    } else if(arg == "--dict"){
+      dictionary = true;
+    } else if(arg == "--io=epoll"){
+      uring = false;
+    } else if(arg.compare(0, 6, "--wal=") == 0){
+      wal_dir = arg.substr(6);
+      avl_only = true;
+    } else if(arg.compare(0, 8, "--group=") == 0){
+      group = atoi(arg.c_str() + 8);
+    } else if(arg.compare(0, 13, "--checkpoint=") == 0){
+      checkpoint = atoi(arg.c_str() + 13);
+    } else if(arg.compare(0, 9, "--engine=") == 0){
+      engine = arg.substr(9) == "avl" ? &avl : make_engine<string>(arg.substr(9));
+      if(engine == NULL){
+	cerr << "ERROR: Unknown engine " << arg.substr(9) << "! Use avl, rb, wavl, bf, btree or bplus. Exiting.." << endl;
+	return 0;
+      }
+    } else if(arg.compare(0, 10, "--threads=") == 0){
+      pool = new TaskPool(atoi(arg.c_str() + 10));
+      t.set_task_pool(pool);
+      avl_only = true;
+    } else if(arg == "--lazy"){
+      t.set_lazy_delete(0.25);
+      avl_only = true;
+    } else if(arg.compare(0, 7, "--lazy=") == 0){
+      t.set_lazy_delete(atof(arg.c_str() + 7));
+      avl_only = true;
+    } else if(arg == "--relaxed"){
+      t.set_relaxed(2);
+      avl_only = true;
+    } else if(arg.compare(0, 10, "--relaxed=") == 0){
+      t.set_relaxed(atoi(arg.c_str() + 10));
+      avl_only = true;
+    } else if(arg.compare(0, 9, "--window=") == 0){
+      t.set_stats_window(strtoull(arg.c_str() + 9, NULL, 10));
+      avl_only = true;
+    } else if(arg == "--finger"){
+      t.set_finger(true);
+      avl_only = true;
+    } else if(arg == "--cache"){
+      t.set_cache_size(1024);
+      avl_only = true;
+    } else if(arg.compare(0, 8, "--cache=") == 0){
+      t.set_cache_size(atoi(arg.c_str() + 8));
+      avl_only = true;
+    } else if(arg.compare(0, 9, "--export=") == 0){
+      export_keys = atoi(arg.c_str() + 9);
+      avl_only = true;
+    } else
+      files.push_back(arg);
+  }
+  if(avl_only && engine != &avl){
+    cerr << "ERROR: --bulk, --cache, --export, --finger, --lazy, --relaxed, --serve, --threads, --wal and --window need --engine=avl. Exiting.." << endl;
+    return 0;
+  }
+  if(export_keys > 0 && !(socket_path.empty() && serve_path.empty())){
+    cerr << "ERROR: --export would send chunks to whichever client is next; it needs a file or stdin. Exiting.." << endl;
+    return 0;
+  }
+  if(files.empty() && socket_path.empty() && serve_path.empty()){
     cerr << "ERROR: No arguments found! Please try again with a file name. Exiting.." << endl;
     return 0;
   } else {
-    if(argc > 2){
-      cerr << "ERROR: Too many arguments found! First argument: " << argv[1] << " being used..." << endl;
+    if(files.size() > 1){
+      cerr << "ERROR: Too many arguments found! First argument: " << files[0] << " being used..." << endl;
     }
-    driver(argv[1]);
+    if(!convert_path.empty()){
+      ifstream in(files[0].c_str());
+      string log;
+      if(!in.is_open()){
+	cerr << "ERROR: Unable to open file" << endl;
+	return 0;
+      }
+      long commands = convert_commands(in, log, dictionary);
+      ofstream out(convert_path.c_str(), ios::binary);
+      if(!out.write(log.data(), log.size())){
+	cerr << "ERROR: cannot write " << convert_path << endl;
+	return 0;
+      }
+      cout << "converted " << commands << " commands to " << log.size() << " bytes" << endl;
+      return 0;
+    }
+    if(!wal_dir.empty()){
+      wal = new TreeLog<AvlTree<string> >(wal_dir, group, checkpoint);
+      if(!wal->recover(t, cerr))
+	return 0;
+    }
+    bool from_stdin = !files.empty() && files[0] == "-";
+    if(bulk && !from_stdin)
+      bulk_driver(files[0]);
+    else if(!files.empty() && !from_stdin)
+      driver(files[0]);    // with --socket or --serve, preloads the tree
+    if(!serve_path.empty()){
+      if(serve_driver(serve_path, uring) < 0)
+	return 0;
+    } else if((from_stdin || !socket_path.empty()) && stream_driver(socket_path, from_stdin) < 0)
+      return 0;
+    export_chunk(true);
+    if(wal != NULL)
+      wal->commit();
     exit(EXIT_FAILURE);
     return 0;
   }
@@ -46,32 +234,278 @@ int main(int argc, char* argv[] ){
 
 /**
  * Driver function to open the input file. 
- * Reads each line using the simple_tokenizer
- * Interprets each line using the eavl_driver
+ * Reads each line and hands it to run_line; a binary command log is
+ * replayed instead.
  * An error occurs if unable to open the file, which then exits.
  */
 void  driver(string input){
   ifstream file;
   string line;
-  string error_line;
+  if(is_command_log(input)){
+    replay(input);
+    return;
+  }
   file.open(input.c_str());
   if(file.is_open()){
-       
-    while(getline(file,line)){
-      vector<string> tokens = simple_tokenizer(line);
-      error_line = "(" + line + ") is not a valid line!";
-    
-      if(tokens.size() < 3){
-	if( tokens.size() == 1){
-	  eavl_driver(error_line, tokens[0]);
-	} else if (tokens.size() > 1){
-	  eavl_driver(error_line, tokens[0],tokens[1].c_str());      }    
-      }
-    }  file.close();
+    while(getline(file,line))
+      run_line(line);
+    file.close();
   } else 
     cerr << "ERROR: Unable to open file" << endl;
 }
 
+/**
+ * Runs one line of input.
+ * Tokenizes it with the simple_tokenizer and interprets it using the eavl_driver.
+ */
+void run_line(const string & line){
+  vector<string> tokens = simple_tokenizer(line);
+  string error_line = "(" + line + ") is not a valid line!";
+  if(tokens.size() < 3){
+#ifdef EAVL_STATS
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+#endif
+    bool ok = false;
+    if( tokens.size() == 1){
+      ok = eavl_driver(error_line, tokens[0], (char *)NULL);
+    } else if (tokens.size() > 1){
+      ok = eavl_driver(error_line, tokens[0],tokens[1].c_str());      }    
+#ifdef EAVL_STATS
+    if(ok)
+      latencies[tokens[0]].record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+#else
+    (void)ok;
+#endif
+  }
+  export_chunk(false);
+}
+
+/**
+ * With --export=N, prints the next N keys of a display in progress (all
+ * that are left if rest is set).
+ */
+void export_chunk(bool rest){
+  if(export_keys <= 0)
+    return;
+  auto print = [](const string & key, int){ cout << key << '\n'; };
+  while(t.export_next(export_keys, print) > 0 && rest)
+    ;
+}
+
+/**
+ * Replays a binary command log (eavlcmdlog.h), printing what the text
+ * commands it was made from print. Keys come straight from the mapped log,
+ * or by reference from its dictionary, and responses are buffered, so the
+ * cost is the tree operations. Raw lines go through run_line.
+ */
+void replay(const string & input){
+  CommandLog log;
+  if(!log.open(input, cerr))
+    return;
+  char op;
+  string_view key;
+  const string *word;
+  string buffer;
+  while(log.next(op, key, word)){
+    if(op == RAW_LINE){
+      cout.flush();    // keep cout and cerr in order
+      run_line(string(key));
+      continue;
+    }
+    if(word == NULL){
+      buffer.assign(key.data(), key.size());
+      word = &buffer;
+    }
+#ifdef EAVL_STATS
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+#endif
+    if(!run_command(op, *word)){
+      cerr << "ERROR: " << input << ": unknown command '" << op << "'" << endl;
+      return;
+    }
+#ifdef EAVL_STATS
+    latencies[op == 'i' ? "insert" : (op == 'r' ? "remove" : "find")]
+      .record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+#endif
+  }
+  cout.flush();
+  if(log.corrupt())
+    cerr << "ERROR: " << input << ": truncated command log" << endl;
+}
+
+/**
+ * Bulk driver (--bulk): reads the mapped input file and collects each run
+ * of consecutive insert lines, which run_inserts executes at once; every
+ * other line goes through run_line as the driver runs it.
+ */
+void bulk_driver(const string & input){
+  int fd = open(input.c_str(), O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0){
+    cerr << "ERROR: Unable to open file" << endl;
+    if(fd >= 0)
+      close(fd);
+    return;
+  }
+  void *map = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+  close(fd);
+  if(map == MAP_FAILED){
+    cerr << "ERROR: Unable to open file" << endl;
+    return;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  const char *p = (const char *)map, *end = p + st.st_size;
+  vector<string_view> run;
+  while(p < end){
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    const char *stop = nl != NULL ? nl : end;
+    string_view words[3];
+    int n = 0;
+    const char *q = p;
+    while(n < 3){
+      while(q < stop && isspace((unsigned char)*q))
+	q++;
+      if(q == stop)
+	break;
+      const char *w = q;
+      while(q < stop && !isspace((unsigned char)*q))
+	q++;
+      words[n++] = string_view(w, q - w);
+    }
+    if(n == 2 && words[0] == "insert"){
+      run.push_back(words[1]);
+      if(run.size() == BULK_MAX)
+	run_inserts(run);
+    } else if(n == 1 || n == 2){
+      run_inserts(run);
+      cout.flush();    // keep cout and cerr in order
+      run_line(string(p, stop));
+    }
+    p = stop + 1;
+  }
+  run_inserts(run);
+  cout.flush();
+  if(map != NULL)
+    munmap(map, st.st_size);
+}
+
+/**
+ * Inserts the keys of run in order and prints each one's new frequency,
+ * then empties run. A run long enough to be worth it (at least BULK_MIN
+ * keys and an eighth of the tree) is sorted by key and position, its
+ * duplicates counted and the distinct keys merged into the tree in one
+ * pass with AvlTree::merge_sorted; the frequency each line prints is the
+ * key's frequency before the run plus its occurrences up to that line.
+ * Shorter runs, and any with --wal, go through the tree one by one.
+ */
+void run_inserts(vector<string_view> & run){
+  if(run.empty())
+    return;
+  if(wal != NULL || run.size() < BULK_MIN || (unsigned long long)run.size() * 8 < (unsigned long long)t.size() + t.tombstone_count()){
+    for(unsigned int i = 0; i < run.size(); i++)
+      run_command('i', string(run[i]));
+    run.clear();
+    return;
+  }
+  vector<pair<string_view, unsigned int> > sorted(run.size());
+  for(unsigned int i = 0; i < run.size(); i++)
+    sorted[i] = make_pair(run[i], i);
+  parallel_sort(pool, sorted.begin(), sorted.end(), less<pair<string_view, unsigned int> >());
+  vector<pair<string, int> > items;
+  vector<unsigned int> first;    // where each distinct key starts in sorted
+  for(unsigned int i = 0; i < sorted.size(); i++){
+    if(i == 0 || sorted[i].first != sorted[i - 1].first){
+      items.push_back(make_pair(string(sorted[i].first), 0));
+      first.push_back(i);
+    }
+    items.back().second++;
+  }
+  vector<int> before;
+  t.merge_sorted(items, before);
+  vector<int> freq(run.size());
+  for(unsigned int k = 0; k < first.size(); k++){
+    unsigned int stop = k + 1 < first.size() ? first[k + 1] : sorted.size();
+    for(unsigned int i = first[k]; i < stop; i++)
+      freq[sorted[i].second] = before[k] + (i - first[k]) + 1;
+  }
+  for(unsigned int i = 0; i < run.size(); i++)
+    cout << run[i] << '\t' << freq[i] << '\n';
+  run.clear();
+}
+
+/**
+ * Runs an insert ('i'), remove ('r') or find ('f') of key, printing the
+ * same line eavl_driver prints, without flushing, then the next chunk of
+ * an --export in progress. Returns false for any other op.
+ */
+bool run_command(char op, const string & key){
+  int freq;
+  if(op == 'i'){
+    if(wal != NULL)
+      wal->record('i', key);
+    freq = engine->insert(key);
+    if(wal != NULL)
+      wal->applied(t);
+    cout << key << '\t' << freq << '\n';
+  } else if(op == 'r'){
+    if(wal != NULL)
+      wal->record('r', key);
+    freq = engine->remove(key);
+    if(wal != NULL)
+      wal->applied(t);
+    if(freq > -1)
+      cout << key << '\t' << freq << '\n';
+    else
+      cout << key << "\tnot found\n";
+  } else if(op == 'f'){
+    freq = 0;
+    int visit = engine->find(key, freq);
+    cout << key << '\t' << freq << '\t' << visit << '\n';
+  } else
+    return false;
+  export_chunk(false);
+  return true;
+}
+
+/**
+ * Streaming driver: runs lines from stdin (when from_stdin) and from the
+ * clients of socket_path (when set) as they arrive; see eavlstream.h.
+ * A socket client's quit closes that client instead of exiting.
+ * Returns the number of socket clients served, or -1 if the socket failed.
+ */
+int stream_driver(const string & socket_path, bool from_stdin){
+  auto handle = [](const string & line, bool from_socket){
+    if(from_socket && line.find("quit") != string::npos){
+      vector<string> tokens = simple_tokenizer(line);
+      if(tokens.size() == 1 && tokens[0] == "quit")
+	return false;
+    }
+    run_line(line);
+    return true;
+  };
+  CommandStream<decltype(handle)> stream(handle);
+  if(from_stdin)
+    stream.add_input(STDIN_FILENO);
+  if(!socket_path.empty() && !stream.listen_unix(socket_path, cerr))
+    return -1;
+  return stream.run();
+}
+
+/**
+ * Server mode: serves the tree to concurrent clients of socket_path until
+ * SIGINT / SIGTERM; see eavlserve.h. Returns the number of clients served,
+ * or -1 if the socket failed.
+ */
+int serve_driver(const string & socket_path, bool uring){
+  TreeServer<AvlTree<string> > server(t, pool, wal);
+  if(!server.listen_unix(socket_path, cerr))
+    return -1;
+  int served = server.run(uring, cerr);
+  if(served >= 0)
+    cerr << "served " << served << " client(s) with " << server.io() << endl;
+  return served;
+}
+
 /**
  * eavl_driver
  * Takes in a variable amount of arguments, being, the command to run to the avltree and the word to insert, find, or remove.
@@ -80,16 +514,29 @@ bool eavl_driver(string error_line, string cmd, ...){
   va_list args;
   int freq;
   va_start(args, cmd);
+  char* c = va_arg(args,char *);
   
+  if(c == NULL && (cmd == "insert" || cmd == "remove" || cmd == "find")){
+    cerr << error_line << endl;
+    va_end(args);
+    return false;
+  }
+
   if(cmd == "insert"){
-    char* c = va_arg(args,char *);
-    cout << c << "\t" << t.insert(c) << endl;
+    if(wal != NULL)
+      wal->record('i', c);
+    cout << c << "\t" << engine->insert(c) << endl;
+    if(wal != NULL)
+      wal->applied(t);
     va_end(args);
     return true;
   }else if(cmd == "remove"){
-    char* c = va_arg(args,char *);
     freq = -1;
-    freq = t.remove(c);
+    if(wal != NULL)
+      wal->record('r', c);
+    freq = engine->remove(c);
+    if(wal != NULL)
+      wal->applied(t);
     if(freq > -1){
       cout << c << "\t" << freq << endl;
     } else
@@ -97,22 +544,74 @@ bool eavl_driver(string error_line, string cmd, ...){
     va_end(args);
     return true;
   }else if(cmd == "find"){
-    char* c = va_arg(args,char *);
     freq = 0;
-    int visit = t.find(c,freq);			      
+    int visit = engine->find(c,freq);			      
     cout << c << "\t" << freq << "\t" << visit << endl;
     va_end(args);
     return true;
   }else if(cmd == "display"){
-    t.display(cout);
+    export_chunk(true);    // finish an earlier dump before starting another
+    if(export_keys > 0 && !t.is_empty())
+      t.export_begin();    // printed a chunk at a time by export_chunk
+    else
+      engine->display(cout);
     va_end(args);
     return true;
   }else if(cmd == "report"){
-    t.report();
+    engine->report();
     va_end(args);
     return true;
+  }else if(cmd == "memory"){
+    if(engine != &avl){
+      cerr << "ERROR: memory accounting needs --engine=avl" << endl;
+      va_end(args);
+      return false;
+    }
+    t.report_memory(cout);
+    va_end(args);
+    return true;
+  }else if(cmd == "check"){
+    if(engine != &avl){
+      cerr << "ERROR: check needs --engine=avl" << endl;
+      va_end(args);
+      return false;
+    }
+    cout << (t.check(cerr) ? "tree ok" : "tree BROKEN") << endl;
+    va_end(args);
+    return true;
+  }else if(cmd == "compact"){
+    if(engine != &avl){
+      cerr << "ERROR: compact needs --engine=avl" << endl;
+      va_end(args);
+      return false;
+    }
+    cout << "compacted = " << t.compact() << endl;
+    va_end(args);
+    return true;
+  }else if(cmd == "settle"){
+    if(engine != &avl){
+      cerr << "ERROR: settle needs --engine=avl" << endl;
+      va_end(args);
+      return false;
+    }
+    cout << "settled = " << t.settle() << endl;
+    va_end(args);
+    return true;
+  }else if(cmd == "stats"){
+#ifdef EAVL_STATS
+    print_stats(cout, c != NULL && string(c) == "--json");
+    va_end(args);
+    return true;
+#else
+    cerr << "ERROR: stats are not compiled in; rebuild with -DEAVL_STATS (make eavl_stats.out)" << endl;
+    va_end(args);
+    return false;
+#endif
   }else if(cmd =="quit"){
-    t.make_empty();
+    export_chunk(true);
+    if(wal != NULL)
+      wal->commit();
+    engine->make_empty();
     va_end(args);
     exit(EXIT_FAILURE);
   }else{
@@ -122,6 +621,34 @@ bool eavl_driver(string error_line, string cmd, ...){
   }
 }
 
+#ifdef EAVL_STATS
+/**
+ * Prints the tree's hot-path counters and the per-command latency histograms.
+ * With json set, the whole dump is a single JSON object on one line.
+ */
+void print_stats(ostream& os, bool json){
+  map<string, LatencyHistogram>::const_iterator it;
+  if(json){
+    os << "{\"tree\": ";
+    engine->stats().write_json(os);
+    os << ", \"latency\": {";
+    for(it = latencies.begin(); it != latencies.end(); ++it){
+      if(it != latencies.begin())
+	os << ", ";
+      os << "\"" << it->first << "\": ";
+      it->second.write_json(os);
+    }
+    os << "}}" << endl;
+  } else {
+    engine->stats().report(os);
+    for(it = latencies.begin(); it != latencies.end(); ++it){
+      os << it->first << " latency (ns) = " << it->second.count() << " ops, p50 " << it->second.percentile(50)
+	 << ", p99 " << it->second.percentile(99) << ", max " << it->second.max() << endl;
+    }
+  }
+}
+#endif
+
 /**
  * Returns a vector of all strings found in a line of input.
  * Simple tokenizer to break down each line of input - streamstream accounts for whitespace.
@@ -0,0 +1,219 @@
+//=============================================================
+// Name:  PAVLTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "pavltree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the persistent enhanced AVL Tree.
+// Rotations build new nodes instead of relinking old ones.
+//
+//============================================================
+
+#include "pavltree.h"
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable>
+PersistentAvlTree<Comparable> PersistentAvlTree<Comparable>::snapshot() const
+{
+  return PersistentAvlTree(*this);
+}
+
+template <typename Comparable>
+bool PersistentAvlTree<Comparable>::contains( const Comparable & x ) const
+{
+  const PNode *t = root.get();
+  while(t != NULL){
+    if(x < t->element)
+      t = t->left.get();
+    else if(t->element < x)
+      t = t->right.get();
+    else
+      return true;
+  }
+  return false;
+}
+
+template <typename Comparable>
+bool PersistentAvlTree<Comparable>::is_empty( ) const
+{
+  return !root;
+}
+
+template <typename Comparable>
+void PersistentAvlTree<Comparable>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+}
+
+template <typename Comparable>
+int PersistentAvlTree<Comparable>::height(){
+  return root ? root->height : 0;
+}
+
+template <typename Comparable>
+long long PersistentAvlTree<Comparable>::int_path_length(){
+  return int_path_length(root, 0);
+}
+
+template <typename Comparable>
+int PersistentAvlTree<Comparable>::size(){
+  return size_t;
+}
+
+template <typename Comparable>
+float PersistentAvlTree<Comparable>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+template <typename Comparable>
+void PersistentAvlTree<Comparable>::display(ostream& os){
+  if(is_empty())
+    os << "Empty tree" << endl;
+  else
+    print_tree(root, os);
+}
+
+template <typename Comparable>
+int PersistentAvlTree<Comparable>::find(const Comparable &x, int &freq){
+  finds++;
+  int visited = 0;
+  const PNode *t = root.get();
+  while(t != NULL){
+    if(t->element == x){
+      freq = t->freq;
+      break;
+    }else if(t->element > x){
+      t = t->left.get();
+    }else{
+      t = t->right.get();
+    }
+    visited++;
+  }
+  nodes_visited += visited;
+  return visited;
+}
+
+template <typename Comparable>
+void PersistentAvlTree<Comparable>::make_empty(){
+  root.reset();
+  size_t = 0;
+}
+
+template <typename Comparable>
+int PersistentAvlTree<Comparable>::insert(const Comparable &x){
+  int freq = 1;
+  root = insert(x, root, freq);
+  return freq;
+}
+
+template <typename Comparable>
+int PersistentAvlTree<Comparable>::remove(const Comparable &x){
+  int freq = -1;
+  root = remove(x, root, freq);
+  return freq;
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable>
+typename PersistentAvlTree<Comparable>::NodePtr
+PersistentAvlTree<Comparable>::insert(const Comparable &x, const NodePtr &t, int &freq){
+  if(!t){
+    size_t++;
+    freq = 1;
+    return make_node(x, 1, NodePtr(), NodePtr());
+  }
+  if(x < t->element)
+    return balance(t->element, t->freq, insert(x, t->left, freq), t->right);
+  if(t->element < x)
+    return balance(t->element, t->freq, t->left, insert(x, t->right, freq));
+  freq = t->freq + 1;
+  return make_node(t->element, freq, t->left, t->right);
+}
+
+template <typename Comparable>
+typename PersistentAvlTree<Comparable>::NodePtr
+PersistentAvlTree<Comparable>::remove(const Comparable &x, const NodePtr &t, int &freq){
+  if(!t){
+    freq = -1;
+    return t;
+  }
+  if(x < t->element){
+    NodePtr l = remove(x, t->left, freq);
+    return freq < 0 ? t : balance(t->element, t->freq, l, t->right);
+  }
+  if(t->element < x){
+    NodePtr r = remove(x, t->right, freq);
+    return freq < 0 ? t : balance(t->element, t->freq, t->left, r);
+  }
+  freq = t->freq - 1;
+  if(freq > 0)
+    return make_node(t->element, freq, t->left, t->right);
+  size_t--;
+  if(!t->left)
+    return t->right;
+  if(!t->right)
+    return t->left;
+  NodePtr min;
+  NodePtr r = remove_min(t->right, min);
+  return balance(min->element, min->freq, t->left, r);
+}
+
+template <typename Comparable>
+typename PersistentAvlTree<Comparable>::NodePtr
+PersistentAvlTree<Comparable>::remove_min(const NodePtr &t, NodePtr &min){
+  if(!t->left){
+    min = t;
+    return t->right;
+  }
+  return balance(t->element, t->freq, remove_min(t->left, min), t->right);
+}
+
+template <typename Comparable>
+typename PersistentAvlTree<Comparable>::NodePtr
+PersistentAvlTree<Comparable>::balance(const Comparable &ele, int freq, const NodePtr &lt, const NodePtr &rt){
+  if(height(lt) - height(rt) > ALLOWED_IMBALANCE){
+    if(height(lt->left) >= height(lt->right))      // case 1: single rotation
+      return make_node(lt->element, lt->freq, lt->left, make_node(ele, freq, lt->right, rt));
+    const NodePtr &k = lt->right;                  // case 2: double rotation
+    return make_node(k->element, k->freq,
+		     make_node(lt->element, lt->freq, lt->left, k->left),
+		     make_node(ele, freq, k->right, rt));
+  }
+  if(height(rt) - height(lt) > ALLOWED_IMBALANCE){
+    if(height(rt->right) >= height(rt->left))      // case 4: single rotation
+      return make_node(rt->element, rt->freq, make_node(ele, freq, lt, rt->left), rt->right);
+    const NodePtr &k = rt->left;                   // case 3: double rotation
+    return make_node(k->element, k->freq,
+		     make_node(ele, freq, lt, k->left),
+		     make_node(rt->element, rt->freq, k->right, rt->right));
+  }
+  return make_node(ele, freq, lt, rt);
+}
+
+template <typename Comparable>
+long long PersistentAvlTree<Comparable>::int_path_length(const NodePtr &t, int val){
+  if(!t)
+    return 0;
+  return val + int_path_length(t->left, val + 1) + int_path_length(t->right, val + 1);
+}
+
+template <typename Comparable>
+void PersistentAvlTree<Comparable>::print_tree(const NodePtr &t, ostream& os) const{
+  if(t){
+    print_tree(t->left, os);
+    os << t->element << endl;
+    print_tree(t->right, os);
+  }
+}
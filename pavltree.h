@@ -0,0 +1,169 @@
+//=============================================================
+// Name:  PAVLTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through pavltree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for a persistent (immutable, path-copying)
+// enhanced AVL Tree. Nodes are never changed once built; insert and remove
+// copy only the nodes on the search path and share every other subtree, so
+// a snapshot is just another reference to the current root. Functions are
+// implemented in pavltree.cpp.
+//
+//============================================================
+
+#ifndef PAVL_TREE_H_INCLUDED
+#define PAVL_TREE_H_INCLUDED
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+// PersistentAvlTree class
+//
+// CONSTRUCTION: zero parameter; copies are O(1) and share all nodes
+//
+// ******************PUBLIC OPERATIONS*********************
+// int insert( x )        --> Insert x, returns its frequency
+// int remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )    --> Returns nodes visited, sets freq
+// bool contains( x )     --> Return true if x is present
+// PersistentAvlTree snapshot( ) --> O(1) read-only version of the tree now
+// void report( )         --> Print size, height, path length, average visits
+// void display( os )     --> Print tree in sorted order
+// void make_empty( )     --> Remove all items
+//
+// Node reference counts are atomic, so a snapshot may be read (display,
+// report, find) from another thread while this tree keeps changing. Take
+// the snapshot in the thread that writes the tree.
+
+template <typename Comparable>
+class PersistentAvlTree
+{
+ public:
+ PersistentAvlTree( ):size_t(0),finds(0),nodes_visited(0){}
+
+  /**
+   * Shallow copy: shares every node with rhs, which is safe because nodes
+   * never change. O(1).
+   */
+ PersistentAvlTree( const PersistentAvlTree & rhs ):root(rhs.root),size_t(rhs.size_t),finds(0),nodes_visited(0){}
+
+  PersistentAvlTree & operator=( const PersistentAvlTree & rhs )
+    {
+      root = rhs.root;
+      size_t = rhs.size_t;
+      return *this;
+    }
+
+  /**
+   * Returns the current version of the tree in O(1). Later inserts and
+   * removes on this tree do not affect it.
+   */
+  PersistentAvlTree snapshot() const;
+
+  bool contains( const Comparable & x ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+  /**
+   * Displays the tree in order from lowest to highest.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if found.
+   */
+  int find(const Comparable &x, int &freq);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   * Copies the O(log n) nodes on the path to x.
+   */
+  int insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   * Copies the O(log n) nodes on the path to x.
+   */
+  int remove(const Comparable &x);
+
+ private:
+  struct PNode;
+  typedef shared_ptr<const PNode> NodePtr;
+
+  struct PNode
+  {
+    Comparable element;
+    int freq;
+    int height;
+    NodePtr left;
+    NodePtr right;
+
+  PNode(const Comparable &ele, int q, const NodePtr &lt, const NodePtr &rt)
+  :element(ele),freq(q),height(max_height(lt, rt) + 1),left(lt),right(rt){}
+  };
+
+  NodePtr root;
+  int size_t;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+
+  static const int ALLOWED_IMBALANCE = 1;
+
+  static int height(const NodePtr &t){
+    return t ? t->height : -1;
+  }
+
+  static int max_height(const NodePtr &l, const NodePtr &r){
+    return height(l) > height(r) ? height(l) : height(r);
+  }
+
+  static NodePtr make_node(const Comparable &ele, int freq, const NodePtr &lt, const NodePtr &rt){
+    return make_shared<const PNode>(ele, freq, lt, rt);
+  }
+
+  /**
+   * Returns a new root for subtree t with x inserted; freq gets x's new frequency.
+   */
+  NodePtr insert(const Comparable &x, const NodePtr &t, int &freq);
+
+  /**
+   * Returns a new root for subtree t with x decremented or removed; freq gets
+   * x's remaining frequency, or -1 if x is not in t (then t is returned).
+   */
+  NodePtr remove(const Comparable &x, const NodePtr &t, int &freq);
+
+  /**
+   * Returns subtree t without its smallest node, which is stored in min.
+   */
+  NodePtr remove_min(const NodePtr &t, NodePtr &min);
+
+  /**
+   * Builds the node (ele, freq, lt, rt), rotating as needed so the result
+   * is AVL balanced given that lt and rt differ in height by at most 2.
+   */
+  static NodePtr balance(const Comparable &ele, int freq, const NodePtr &lt, const NodePtr &rt);
+
+  long long int_path_length(const NodePtr &t, int val);
+
+  void print_tree(const NodePtr &t, ostream& os) const;
+};
+#endif
@@ -0,0 +1,399 @@
+//=============================================================
+// Name:  RBTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "rbtree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the red-black tree engine.
+// Insert and remove follow the bottom-up algorithms of Cormen et al.
+//
+//============================================================
+
+#include "rbtree.h"
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable>
+RbTree<Comparable>::RbTree( ):size_t(0),finds(0),nodes_visited(0)
+{
+  nil = new RbNode(Comparable(), NULL, NULL, NULL, false, 0);
+  nil->left = nil->right = nil->parent = nil;
+  root = nil;
+}
+
+template <typename Comparable>
+RbTree<Comparable>::~RbTree( )
+{
+  make_empty();
+  delete nil;
+}
+
+template <typename Comparable>
+bool RbTree<Comparable>::contains( const Comparable & x ) const
+{
+  return find_node(x) != nil;
+}
+
+template <typename Comparable>
+bool RbTree<Comparable>::is_empty( ) const
+{
+  return root == nil;
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+  EAVL_STAT(counters.report(cout));
+}
+
+template <typename Comparable>
+int RbTree<Comparable>::height(){
+  return is_empty() ? 0 : height(root);
+}
+
+template <typename Comparable>
+long long RbTree<Comparable>::int_path_length(){
+  return int_path_length(root, 0);
+}
+
+template <typename Comparable>
+int RbTree<Comparable>::size(){
+  return size_t;
+}
+
+template <typename Comparable>
+float RbTree<Comparable>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+#ifdef EAVL_STATS
+template <typename Comparable>
+const AvlStats & RbTree<Comparable>::stats() const{
+  return counters;
+}
+#endif
+
+template <typename Comparable>
+void RbTree<Comparable>::display(ostream& os){
+  if(is_empty())
+    os << "Empty tree" << endl;
+  else
+    print_tree(root, os);
+}
+
+template <typename Comparable>
+int RbTree<Comparable>::find(const Comparable &x, int &freq){
+  finds++;
+  EAVL_STAT(counters.finds++);
+  int visited = 0;
+  RbNode *t = root;
+  while(t != nil){
+    if(t->element == x){
+      freq = t->freq;
+      break;
+    }else if(t->element > x){
+      t = t->left;
+    }else{
+      t = t->right;
+    }
+    visited++;
+  }
+  nodes_visited += visited;
+  EAVL_STAT(counters.find_visits += visited);
+  return visited;
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::make_empty(){
+  make_empty(root);
+  root = nil;
+  size_t = 0;
+}
+
+template <typename Comparable>
+int RbTree<Comparable>::insert(const Comparable &x){
+  EAVL_STAT(counters.inserts++);
+  RbNode *p = nil;
+  RbNode *t = root;
+  while(t != nil){
+    EAVL_STAT(counters.insert_visits++);
+    p = t;
+    if(x < t->element)
+      t = t->left;
+    else if(t->element < x)
+      t = t->right;
+    else
+      return ++t->freq;
+  }
+  RbNode *z = new RbNode(x, nil, nil, p, true);
+  if(p == nil)
+    root = z;
+  else if(x < p->element)
+    p->left = z;
+  else
+    p->right = z;
+  size_t++;
+  insert_fixup(z);
+  return 1;
+}
+
+template <typename Comparable>
+int RbTree<Comparable>::remove(const Comparable &x){
+  EAVL_STAT(counters.removes++);
+  RbNode *t = root;
+  while(t != nil && !(t->element == x)){
+    EAVL_STAT(counters.remove_visits++);
+    t = x < t->element ? t->left : t->right;
+  }
+  if(t == nil)
+    return -1;
+  int freq = --t->freq;
+  if(freq < 1){
+    remove_node(t);
+    size_t--;
+  }
+  return freq;
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable>
+void RbTree<Comparable>::insert_fixup(RbNode *z){
+  while(z->parent->red){
+    RbNode *g = z->parent->parent;
+    if(z->parent == g->left){
+      RbNode *u = g->right;
+      if(u->red){                 // red uncle: recolor and move up
+	z->parent->red = false;
+	u->red = false;
+	g->red = true;
+	z = g;
+	EAVL_STAT(counters.height_changes++);
+      } else {
+	if(z == z->parent->right){
+	  z = z->parent;
+	  rotate_left(z);
+	  EAVL_STAT(counters.double_left++);
+	} else
+	  EAVL_STAT(counters.single_left++);
+	z->parent->red = false;
+	g->red = true;
+	rotate_right(g);
+      }
+    } else {
+      RbNode *u = g->left;
+      if(u->red){
+	z->parent->red = false;
+	u->red = false;
+	g->red = true;
+	z = g;
+	EAVL_STAT(counters.height_changes++);
+      } else {
+	if(z == z->parent->left){
+	  z = z->parent;
+	  rotate_right(z);
+	  EAVL_STAT(counters.double_right++);
+	} else
+	  EAVL_STAT(counters.single_right++);
+	z->parent->red = false;
+	g->red = true;
+	rotate_left(g);
+      }
+    }
+  }
+  root->red = false;
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::remove_node(RbNode *z){
+  RbNode *y = z;
+  RbNode *x;
+  bool removed_red = y->red;
+  if(z->left == nil){
+    x = z->right;
+    transplant(z, z->right);
+  } else if(z->right == nil){
+    x = z->left;
+    transplant(z, z->left);
+  } else {
+    // Relink the successor in z's place.
+    y = z->right;
+    while(y->left != nil){
+      EAVL_STAT(counters.remove_visits++);
+      y = y->left;
+    }
+    removed_red = y->red;
+    x = y->right;
+    if(y->parent == z)
+      x->parent = y;
+    else {
+      transplant(y, y->right);
+      y->right = z->right;
+      y->right->parent = y;
+    }
+    transplant(z, y);
+    y->left = z->left;
+    y->left->parent = y;
+    y->red = z->red;
+  }
+  delete z;
+  if(!removed_red)
+    remove_fixup(x);
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::remove_fixup(RbNode *x){
+  while(x != root && !x->red){
+    RbNode *p = x->parent;
+    if(x == p->left){
+      RbNode *w = p->right;
+      if(w->red){                 // red sibling: rotate it above p
+	w->red = false;
+	p->red = true;
+	rotate_left(p);
+	EAVL_STAT(counters.single_right++);
+	w = p->right;
+      }
+      if(!w->left->red && !w->right->red){
+	w->red = true;
+	x = p;
+	EAVL_STAT(counters.height_changes++);
+      } else {
+	if(!w->right->red){
+	  w->left->red = false;
+	  w->red = true;
+	  rotate_right(w);
+	  EAVL_STAT(counters.double_right++);
+	  w = p->right;
+	} else
+	  EAVL_STAT(counters.single_right++);
+	w->red = p->red;
+	p->red = false;
+	w->right->red = false;
+	rotate_left(p);
+	x = root;
+      }
+    } else {
+      RbNode *w = p->left;
+      if(w->red){
+	w->red = false;
+	p->red = true;
+	rotate_right(p);
+	EAVL_STAT(counters.single_left++);
+	w = p->left;
+      }
+      if(!w->left->red && !w->right->red){
+	w->red = true;
+	x = p;
+	EAVL_STAT(counters.height_changes++);
+      } else {
+	if(!w->left->red){
+	  w->right->red = false;
+	  w->red = true;
+	  rotate_left(w);
+	  EAVL_STAT(counters.double_left++);
+	  w = p->left;
+	} else
+	  EAVL_STAT(counters.single_left++);
+	w->red = p->red;
+	p->red = false;
+	w->left->red = false;
+	rotate_right(p);
+	x = root;
+      }
+    }
+  }
+  x->red = false;
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::transplant(RbNode *u, RbNode *v){
+  if(u->parent == nil)
+    root = v;
+  else if(u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  v->parent = u->parent;
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::rotate_left(RbNode *x){
+  RbNode *y = x->right;
+  x->right = y->left;
+  if(y->left != nil)
+    y->left->parent = x;
+  transplant(x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::rotate_right(RbNode *x){
+  RbNode *y = x->left;
+  x->left = y->right;
+  if(y->right != nil)
+    y->right->parent = x;
+  transplant(x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+template <typename Comparable>
+typename RbTree<Comparable>::RbNode * RbTree<Comparable>::find_node(const Comparable &x) const{
+  RbNode *t = root;
+  while(t != nil){
+    if(x < t->element)
+      t = t->left;
+    else if(t->element < x)
+      t = t->right;
+    else
+      break;
+  }
+  return t;
+}
+
+template <typename Comparable>
+int RbTree<Comparable>::height(RbNode *t) const{
+  if(t == nil)
+    return -1;
+  int lh = height(t->left);
+  int rh = height(t->right);
+  return (lh > rh ? lh : rh) + 1;
+}
+
+template <typename Comparable>
+long long RbTree<Comparable>::int_path_length(RbNode *t, int val){
+  if(t == nil)
+    return 0;
+  return val + int_path_length(t->left, val + 1) + int_path_length(t->right, val + 1);
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::print_tree(RbNode *t, ostream& os) const{
+  if(t != nil){
+    print_tree(t->left, os);
+    os << t->element << endl;
+    print_tree(t->right, os);
+  }
+}
+
+template <typename Comparable>
+void RbTree<Comparable>::make_empty(RbNode *t){
+  if(t != nil){
+    make_empty(t->left);
+    make_empty(t->right);
+    delete t;
+  }
+}
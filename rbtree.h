@@ -0,0 +1,143 @@
+//=============================================================
+// Name:  RBTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through rbtree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for a red-black tree with the enhanced AVL Tree
+// API and frequency counting. Rebalancing is mostly recoloring: an insert
+// does at most two rotations and a remove at most three, against O(log n)
+// for AVL removes. Functions are implemented in rbtree.cpp.
+//
+//============================================================
+
+#ifndef RB_TREE_H_INCLUDED
+#define RB_TREE_H_INCLUDED
+
+#include <iostream>
+#include "eavlstats.h"
+
+using namespace std;
+
+// RbTree class
+//
+// CONSTRUCTION: zero parameter
+//
+// ******************PUBLIC OPERATIONS*********************
+// int insert( x )        --> Insert x, returns its frequency
+// int remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )    --> Returns nodes visited, sets freq
+// bool contains( x )     --> Return true if x is present
+// void report( )         --> Print size, height, path length, average visits
+// void display( os )     --> Print tree in sorted order
+// void make_empty( )     --> Remove all items
+//
+// With EAVL_STATS, rotations are counted by the AVL case they correspond to
+// and height_changes counts recoloring steps.
+
+template <typename Comparable>
+class RbTree
+{
+ public:
+  RbTree( );
+
+  ~RbTree( );
+
+  bool contains( const Comparable & x ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+#ifdef EAVL_STATS
+  const AvlStats & stats() const;
+#endif
+
+  /**
+   * Displays the tree in order from lowest to highest.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if found.
+   */
+  int find(const Comparable &x, int &freq);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   */
+  int insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   */
+  int remove(const Comparable &x);
+
+ private:
+  struct RbNode
+  {
+    Comparable element;
+    RbNode *left;
+    RbNode *right;
+    RbNode *parent;
+    bool red;
+    int freq;
+
+  RbNode(const Comparable &ele, RbNode *lt, RbNode *rt, RbNode *p, bool r, int q = 1)
+  :element(ele),left(lt),right(rt),parent(p),red(r),freq(q){}
+  };
+
+  // Black sentinel standing in for every missing child and the root's parent.
+  RbNode *nil;
+  RbNode *root;
+  int size_t;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+#ifdef EAVL_STATS
+  AvlStats counters;
+#endif
+
+  void insert_fixup(RbNode *z);
+
+  /**
+   * Unlinks z (which has frequency 0) and deletes it.
+   */
+  void remove_node(RbNode *z);
+
+  void remove_fixup(RbNode *x);
+
+  // Puts v in u's place under u's parent.
+  void transplant(RbNode *u, RbNode *v);
+
+  void rotate_left(RbNode *x);
+
+  void rotate_right(RbNode *x);
+
+  RbNode * find_node(const Comparable &x) const;
+
+  int height(RbNode *t) const;
+
+  long long int_path_length(RbNode *t, int val);
+
+  void print_tree(RbNode *t, ostream& os) const;
+
+  void make_empty(RbNode *t);
+
+  RbTree( const RbTree & );
+  RbTree & operator=( const RbTree & );
+};
+#endif
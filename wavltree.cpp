@@ -0,0 +1,344 @@
+//=============================================================
+// Name:  WAVLTREE.cpp
+// Author(s): William Widmer
+// Created: March 2014
+// Build: #include "wavltree.cpp" (templates), see makefile
+// Version: 1.0
+// Description: Implementation file for the weak AVL tree engine. Like
+// AvlTree, insert and remove recurse down and repair ranks on the way back
+// up, one node per level.
+//
+//============================================================
+
+#include "wavltree.h"
+
+/**
+ *
+ * Public Methods
+ *
+ */
+template <typename Comparable>
+bool WavlTree<Comparable>::contains( const Comparable & x ) const
+{
+  WavlNode *t = root;
+  while(t != NULL){
+    if(x < t->element)
+      t = t->left;
+    else if(t->element < x)
+      t = t->right;
+    else
+      return true;
+  }
+  return false;
+}
+
+template <typename Comparable>
+bool WavlTree<Comparable>::is_empty( ) const
+{
+  return root == NULL;
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::report(){
+  cout << "size = " << size() << endl;
+  cout << "height = " << height() << endl;
+  cout << "internal path length = " << int_path_length() << endl;
+  cout << "average number of nodes visited = "<< avge_node_visits() << endl;
+  EAVL_STAT(counters.report(cout));
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::height(){
+  return root == NULL ? 0 : height(root);
+}
+
+template <typename Comparable>
+long long WavlTree<Comparable>::int_path_length(){
+  return int_path_length(root, 0);
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::size(){
+  return size_t;
+}
+
+template <typename Comparable>
+float WavlTree<Comparable>::avge_node_visits(){
+  if(finds > 0 && nodes_visited > 0)
+    return (float)((double)nodes_visited / finds);
+  else
+    return 0;
+}
+
+#ifdef EAVL_STATS
+template <typename Comparable>
+const AvlStats & WavlTree<Comparable>::stats() const{
+  return counters;
+}
+#endif
+
+template <typename Comparable>
+void WavlTree<Comparable>::display(ostream& os){
+  if(is_empty())
+    os << "Empty tree" << endl;
+  else
+    print_tree(root, os);
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::find(const Comparable &x, int &freq){
+  finds++;
+  EAVL_STAT(counters.finds++);
+  int visited = 0;
+  WavlNode *t = root;
+  while(t != NULL){
+    if(t->element == x){
+      freq = t->freq;
+      break;
+    }else if(t->element > x){
+      t = t->left;
+    }else{
+      t = t->right;
+    }
+    visited++;
+  }
+  nodes_visited += visited;
+  EAVL_STAT(counters.find_visits += visited);
+  return visited;
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::make_empty(){
+  make_empty(root);
+  size_t = 0;
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::insert(const Comparable &x){
+  EAVL_STAT(counters.inserts++);
+  return insert(x, root);
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::remove(const Comparable &x){
+  EAVL_STAT(counters.removes++);
+  return remove(x, root);
+}
+
+/**
+ * Private methods
+ *
+ */
+template <typename Comparable>
+int WavlTree<Comparable>::insert(const Comparable &x, WavlNode *&t){
+  if(t == NULL){
+    t = new WavlNode(x, NULL, NULL);
+    size_t++;
+    return 1;
+  }
+  EAVL_STAT(counters.insert_visits++);
+  int freq;
+  if(x < t->element)
+    freq = insert(x, t->left);
+  else if(t->element < x)
+    freq = insert(x, t->right);
+  else
+    return ++t->freq;
+  fix_after_insert(t);
+  return freq;
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::remove(const Comparable &x, WavlNode *&t){
+  if(t == NULL)
+    return -1;    // Item not found; do nothing
+  EAVL_STAT(counters.remove_visits++);
+  int freq;
+  if(x < t->element)
+    freq = remove(x, t->left);
+  else if(t->element < x)
+    freq = remove(x, t->right);
+  else {
+    freq = --t->freq;
+    if(freq < 1){
+      WavlNode *old_node = t;
+      if(t->left != NULL && t->right != NULL){
+	// Relink the successor node in t's place, keeping t's rank.
+	WavlNode *successor = detach_min(t->right);
+	successor->left = t->left;
+	successor->right = t->right;
+	successor->rank = t->rank;
+	t = successor;
+      } else
+	t = (t->left != NULL) ? t->left : t->right;
+      delete old_node;
+      size_t--;
+    }
+  }
+  if(freq == 0)
+    fix_after_remove(t);
+  return freq;
+}
+
+template <typename Comparable>
+typename WavlTree<Comparable>::WavlNode * WavlTree<Comparable>::detach_min(WavlNode *&t){
+  EAVL_STAT(counters.remove_visits++);
+  if(t->left == NULL){
+    WavlNode *min = t;
+    t = t->right;
+    return min;
+  }
+  WavlNode *min = detach_min(t->left);
+  fix_after_remove(t);
+  return min;
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::fix_after_insert(WavlNode *&t){
+  if(rank(t->left) == t->rank){              // left child is a 0-child
+    if(t->rank - rank(t->right) == 1){
+      t->rank++;                             // promote, check again one level up
+      EAVL_STAT(counters.height_changes++);
+    } else if(t->left->rank - rank(t->left->right) == 2){
+      EAVL_STAT(counters.single_left++);     // case 1
+      rotate_with_left_child(t);
+      t->right->rank--;
+    } else {
+      EAVL_STAT(counters.double_left++);     // case 2
+      rotate_with_right_child(t->left);
+      rotate_with_left_child(t);
+      t->rank++;
+      t->left->rank--;
+      t->right->rank--;
+    }
+  } else if(rank(t->right) == t->rank){      // mirror image
+    if(t->rank - rank(t->left) == 1){
+      t->rank++;
+      EAVL_STAT(counters.height_changes++);
+    } else if(t->right->rank - rank(t->right->left) == 2){
+      EAVL_STAT(counters.single_right++);    // case 4
+      rotate_with_right_child(t);
+      t->left->rank--;
+    } else {
+      EAVL_STAT(counters.double_right++);    // case 3
+      rotate_with_left_child(t->right);
+      rotate_with_right_child(t);
+      t->rank++;
+      t->left->rank--;
+      t->right->rank--;
+    }
+  }
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::fix_after_remove(WavlNode *&t){
+  if(t == NULL)
+    return;
+  if(t->left == NULL && t->right == NULL && t->rank == 1){
+    t->rank = 0;                             // 2,2 leaf
+    EAVL_STAT(counters.height_changes++);
+    return;
+  }
+  if(t->rank - rank(t->left) == 3){          // left child is a 3-child
+    WavlNode *y = t->right;
+    if(t->rank - y->rank == 2){
+      t->rank--;                             // demote, check again one level up
+      EAVL_STAT(counters.height_changes++);
+    } else if(y->rank - rank(y->left) == 2 && y->rank - rank(y->right) == 2){
+      t->rank--;
+      y->rank--;
+      EAVL_STAT(counters.height_changes += 2);
+    } else if(y->rank - rank(y->right) == 1){
+      EAVL_STAT(counters.single_right++);    // case 4
+      rotate_with_right_child(t);
+      t->rank++;
+      WavlNode *z = t->left;
+      z->rank--;
+      if(z->left == NULL && z->right == NULL)
+	z->rank = 0;
+    } else {
+      EAVL_STAT(counters.double_right++);    // case 3
+      rotate_with_left_child(t->right);
+      rotate_with_right_child(t);
+      t->rank += 2;
+      t->left->rank -= 2;
+      t->right->rank--;
+    }
+  } else if(t->rank - rank(t->right) == 3){  // mirror image
+    WavlNode *y = t->left;
+    if(t->rank - y->rank == 2){
+      t->rank--;
+      EAVL_STAT(counters.height_changes++);
+    } else if(y->rank - rank(y->left) == 2 && y->rank - rank(y->right) == 2){
+      t->rank--;
+      y->rank--;
+      EAVL_STAT(counters.height_changes += 2);
+    } else if(y->rank - rank(y->left) == 1){
+      EAVL_STAT(counters.single_left++);     // case 1
+      rotate_with_left_child(t);
+      t->rank++;
+      WavlNode *z = t->right;
+      z->rank--;
+      if(z->left == NULL && z->right == NULL)
+	z->rank = 0;
+    } else {
+      EAVL_STAT(counters.double_left++);     // case 2
+      rotate_with_right_child(t->left);
+      rotate_with_left_child(t);
+      t->rank += 2;
+      t->left->rank--;
+      t->right->rank -= 2;
+    }
+  }
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::rotate_with_left_child(WavlNode *&k2){
+  WavlNode *k1 = k2->left;
+  k2->left = k1->right;
+  k1->right = k2;
+  k2 = k1;
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::rotate_with_right_child(WavlNode *&k1){
+  WavlNode *k2 = k1->right;
+  k1->right = k2->left;
+  k2->left = k1;
+  k1 = k2;
+}
+
+template <typename Comparable>
+int WavlTree<Comparable>::height(WavlNode *t) const{
+  if(t == NULL)
+    return -1;
+  int lh = height(t->left);
+  int rh = height(t->right);
+  return (lh > rh ? lh : rh) + 1;
+}
+
+template <typename Comparable>
+long long WavlTree<Comparable>::int_path_length(WavlNode *t, int val){
+  if(t == NULL)
+    return 0;
+  return val + int_path_length(t->left, val + 1) + int_path_length(t->right, val + 1);
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::print_tree(WavlNode *t, ostream& os) const{
+  if(t != NULL){
+    print_tree(t->left, os);
+    os << t->element << endl;
+    print_tree(t->right, os);
+  }
+}
+
+template <typename Comparable>
+void WavlTree<Comparable>::make_empty(WavlNode *&t){
+  if(t != NULL){
+    make_empty(t->left);
+    make_empty(t->right);
+    delete t;
+  }
+  t = NULL;
+}
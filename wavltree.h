@@ -0,0 +1,161 @@
+//=============================================================
+// Name:  WAVLTREE.h
+// Author(s): William Widmer
+// Created: March 2014
+// Build: included through wavltree.cpp (like eavltree.h / eavltree.cpp)
+// Version: 1.0
+// Description: Header file for a weak AVL (WAVL) tree (Haeupler, Sen and
+// Tarjan) with the enhanced AVL Tree API and frequency counting. Nodes keep
+// a rank instead of a height; every rank difference is 1 or 2 and leaves
+// have rank 0. Inserts rebalance exactly like AVL, but a remove does at
+// most two rotations, and with inserts only the tree is an AVL tree.
+// Functions are implemented in wavltree.cpp.
+//
+//============================================================
+
+#ifndef WAVL_TREE_H_INCLUDED
+#define WAVL_TREE_H_INCLUDED
+
+#include <iostream>
+#include "eavlstats.h"
+
+using namespace std;
+
+// WavlTree class
+//
+// CONSTRUCTION: zero parameter
+//
+// ******************PUBLIC OPERATIONS*********************
+// int insert( x )        --> Insert x, returns its frequency
+// int remove( x )        --> Decrement x, returns its frequency or -1
+// int find( x, freq )    --> Returns nodes visited, sets freq
+// bool contains( x )     --> Return true if x is present
+// void report( )         --> Print size, height, path length, average visits
+// void display( os )     --> Print tree in sorted order
+// void make_empty( )     --> Remove all items
+//
+// With EAVL_STATS, rotations are counted by AVL case and height_changes
+// counts promotions and demotions.
+
+template <typename Comparable>
+class WavlTree
+{
+ public:
+ WavlTree( ):root(NULL),size_t(0),finds(0),nodes_visited(0){}
+
+  ~WavlTree( ){
+    make_empty();
+  }
+
+  bool contains( const Comparable & x ) const;
+
+  bool is_empty( ) const;
+
+  /**
+   * Report the size, height, internal path length, and average numbers of nodes visited.
+   * Format is "(attribute) = (number)"
+   */
+  void report();
+
+  /**
+   * Returns the height of the tree, found by traversal (ranks can exceed heights).
+   */
+  int height();
+
+  long long int_path_length();
+
+  int size();
+
+  float avge_node_visits();
+
+#ifdef EAVL_STATS
+  const AvlStats & stats() const;
+#endif
+
+  /**
+   * Displays the tree in order from lowest to highest.
+   */
+  void display(ostream& os);
+
+  /**
+   * Returns the number of nodes visited; freq is set to x's frequency if found.
+   */
+  int find(const Comparable &x, int &freq);
+
+  void make_empty();
+
+  /**
+   * Insert x into the tree; duplicates increase frequency.
+   */
+  int insert(const Comparable &x);
+
+  /**
+   * Remove x from the tree. Returns -1 if x is not found.
+   */
+  int remove(const Comparable &x);
+
+ private:
+  struct WavlNode
+  {
+    Comparable element;
+    WavlNode *left;
+    WavlNode *right;
+    int rank;
+    int freq;
+
+  WavlNode(const Comparable &ele, WavlNode *lt, WavlNode *rt, int r = 0, int q = 1)
+  :element(ele),left(lt),right(rt),rank(r),freq(q){}
+  };
+
+  WavlNode *root;
+  int size_t;
+  unsigned long long finds;
+  unsigned long long nodes_visited;
+#ifdef EAVL_STATS
+  AvlStats counters;
+#endif
+
+  /**
+   * Inserts x into subtree t and restores the rank rule at t: a child that
+   * reached t's rank either promotes t (the problem moves up) or is fixed
+   * by one single or double rotation. Returns x's frequency.
+   */
+  int insert(const Comparable &x, WavlNode *&t);
+
+  /**
+   * Removes x from subtree t, then fixes a 2,2 leaf or a 3-child at t by
+   * demotions (the problem moves up) or at most two rotations.
+   * Returns x's remaining frequency or -1 if x is not in t.
+   */
+  int remove(const Comparable &x, WavlNode *&t);
+
+  /**
+   * Unlinks the smallest node of subtree t, fixing ranks on the way back
+   * up, and returns it. t must not be NULL.
+   */
+  WavlNode * detach_min(WavlNode *&t);
+
+  void fix_after_insert(WavlNode *&t);
+
+  void fix_after_remove(WavlNode *&t);
+
+  static int rank(WavlNode *t){
+    return t == NULL ? -1 : t->rank;
+  }
+
+  void rotate_with_left_child(WavlNode *&k2);
+
+  void rotate_with_right_child(WavlNode *&k1);
+
+  int height(WavlNode *t) const;
+
+  long long int_path_length(WavlNode *t, int val);
+
+  void print_tree(WavlNode *t, ostream& os) const;
+
+  void make_empty(WavlNode *&t);
+
+  WavlTree( const WavlTree & );
+  WavlTree & operator=( const WavlTree & );
+};
+#endif